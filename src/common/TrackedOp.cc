@@ -24,8 +24,10 @@
 #include "common/perf_counters_collection.h"
 #endif
 
+#include <limits>
 #include <shared_mutex> // for std::shared_lock
 #include <sstream>
+#include <thread>
 
 #define dout_context cct
 #define dout_subsys ceph_subsys_optracker
@@ -189,10 +191,59 @@ void OpHistory::dump_ops(utime_t now, Formatter *f, set<string> filters, bool by
 
 struct ShardedTrackingData {
   ceph::mutex ops_in_flight_lock_sharded;
-  TrackedOp::tracked_op_list_t ops_in_flight_sharded;
+  TrackedOp::tracked_op_list_t ops_in_flight_sharded; ///< slots overflow
   std::atomic<uint64_t> ops_in_flight_count{0};
+
+  // Ops are registered by claiming a free slot with a CAS. Walkers bump
+  // `visitors` while they look at the slots; unregistering an op clears
+  // its slot and waits for the walkers to leave before the op may go
+  // away, so a walker never sees a dangling pointer.
+  std::array<std::atomic<TrackedOp*>, OPTRACKER_SHARD_SLOTS> slots = {};
+  std::atomic<uint32_t> slot_hint{0};
+  std::atomic<uint32_t> visitors{0};
+
+  static constexpr unsigned MAX_SLOT_PROBES = 8;
+
   explicit ShardedTrackingData(const char* lock_name)
     : ops_in_flight_lock_sharded(ceph::make_mutex(lock_name)) {}
+
+  bool try_claim_slot(TrackedOp *op) {
+    for (unsigned probe = 0; probe < MAX_SLOT_PROBES; ++probe) {
+      uint32_t idx = slot_hint.fetch_add(1, std::memory_order_relaxed) %
+	OPTRACKER_SHARD_SLOTS;
+      TrackedOp *expected = nullptr;
+      if (slots[idx].compare_exchange_strong(expected, op)) {
+	op->slot = idx;
+	return true;
+      }
+    }
+    return false;
+  }
+  void release_slot(TrackedOp *op) {
+    slots[op->slot].store(nullptr);
+    op->slot = -1;
+    while (visitors.load() > 0) {
+      std::this_thread::yield();
+    }
+  }
+
+  /// call f(TrackedOp&) for every op registered in this shard
+  template <typename Func>
+  void for_each_op(Func&& f) {
+    visitors.fetch_add(1);
+    for (auto& s : slots) {
+      if (TrackedOp *op = s.load(); op) {
+	f(*op);
+      }
+    }
+    {
+      std::lock_guard locker(ops_in_flight_lock_sharded);
+      for (auto& op : ops_in_flight_sharded) {
+	f(op);
+      }
+    }
+    visitors.fetch_sub(1);
+  }
 };
 
 OpTracker::OpTracker(CephContext *cct_, bool tracking, uint32_t num_shards):
@@ -286,12 +337,11 @@ bool OpTracker::dump_ops_in_flight(Formatter *f, bool print_only_blocked, set<st
   for (uint32_t i = 0; i < num_optracker_shards; i++) {
     ShardedTrackingData* sdata = sharded_in_flight_list[i];
     ceph_assert(NULL != sdata); 
-    std::lock_guard locker(sdata->ops_in_flight_lock_sharded);
-    for (auto& op : sdata->ops_in_flight_sharded) {
+    sdata->for_each_op([&](TrackedOp& op) {
       if (print_only_blocked && (now - op.get_initiated() <= complaint_time))
-        break;
+        return;
       if (!op.filter_out(filters))
-        continue;
+        return;
       
       if (!count_only) {
         f->open_object_section("op");
@@ -300,7 +350,7 @@ bool OpTracker::dump_ops_in_flight(Formatter *f, bool print_only_blocked, set<st
       }
 
       total_ops_in_flight++;
-    }
+    });
   }
 
   if (!count_only) {
@@ -342,12 +392,14 @@ bool OpTracker::register_inflight_op(TrackedOp *i)
   uint32_t shard_index = current_seq % num_optracker_shards;
   ShardedTrackingData* sdata = sharded_in_flight_list[shard_index];
   ceph_assert(NULL != sdata);
-  {
+  i->seq = current_seq;
+  uint32_t rate = sample_rate.load(std::memory_order_relaxed);
+  i->sampled = rate <= 1 || current_seq % rate == 0;
+  if (!sdata->try_claim_slot(i)) {
     std::lock_guard locker(sdata->ops_in_flight_lock_sharded);
     sdata->ops_in_flight_sharded.push_back(*i);
-    i->seq = current_seq;
-    sdata->ops_in_flight_count.fetch_add(1, std::memory_order_relaxed);
   }
+  sdata->ops_in_flight_count.fetch_add(1, std::memory_order_relaxed);
   return true;
 }
 
@@ -359,12 +411,14 @@ void OpTracker::unregister_inflight_op(TrackedOp* const i)
   uint32_t shard_index = i->seq % num_optracker_shards;
   ShardedTrackingData* sdata = sharded_in_flight_list[shard_index];
   ceph_assert(NULL != sdata);
-  {
+  if (i->slot >= 0) {
+    sdata->release_slot(i);
+  } else {
     std::lock_guard locker(sdata->ops_in_flight_lock_sharded);
     auto p = sdata->ops_in_flight_sharded.iterator_to(*i);
     sdata->ops_in_flight_sharded.erase(p);
-    sdata->ops_in_flight_count.fetch_sub(1, std::memory_order_relaxed);
   }
+  sdata->ops_in_flight_count.fetch_sub(1, std::memory_order_relaxed);
 }
 
 void OpTracker::record_history_op(TrackedOpRef&& i)
@@ -394,24 +448,24 @@ bool OpTracker::visit_ops_in_flight(utime_t* oldest_secs,
   std::shared_lock l{lock};
   for (const auto sdata : sharded_in_flight_list) {
     ceph_assert(sdata);
-    std::lock_guard locker(sdata->ops_in_flight_lock_sharded);
-    for (auto& op : sdata->ops_in_flight_sharded) {
+    sdata->for_each_op([&](TrackedOp& op) {
+      ops_in_flight.emplace_back(&op);
       if (!op.warn_interval_multiplier || op.is_continuous())
-	continue;
+	return;
 
       utime_t oldest_op_tmp = op.get_initiated();
       if (oldest_op_tmp < oldest_op) {
         oldest_op = oldest_op_tmp;
       }
-      break;
-    }
-    std::transform(std::begin(sdata->ops_in_flight_sharded),
-                   std::end(sdata->ops_in_flight_sharded),
-                   std::back_inserter(ops_in_flight),
-                   [] (TrackedOp& op) { return TrackedOpRef(&op); });
+    });
   }
   if (ops_in_flight.empty())
     return false;
+  // registration slots are not ordered; visitors expect the oldest first
+  std::sort(ops_in_flight.begin(), ops_in_flight.end(),
+	    [](const TrackedOpRef& a, const TrackedOpRef& b) {
+	      return a->get_initiated() < b->get_initiated();
+	    });
   *oldest_secs = now - oldest_op;
   dout(10) << "ops_in_flight.size: " << ops_in_flight.size()
            << "; oldest is " << *oldest_secs
@@ -524,13 +578,11 @@ void OpTracker::get_age_ms_histogram(pow2_hist_t *h)
   for (uint32_t iter = 0; iter < num_optracker_shards; iter++) {
     ShardedTrackingData* sdata = sharded_in_flight_list[iter];
     ceph_assert(NULL != sdata);
-    std::lock_guard locker(sdata->ops_in_flight_lock_sharded);
-
-    for (auto& i : sdata->ops_in_flight_sharded) {
+    sdata->for_each_op([&](TrackedOp& i) {
       utime_t age = now - i.get_initiated();
       uint32_t ms = (long)(age * 1000.0);
       h->add(ms);
-    }
+    });
   }
 }
 
@@ -543,6 +595,81 @@ void TrackedOp::Event::dump(ceph::Formatter *f) const {
   f->dump_string("event", str);
 }
 
+// Events recorded by unsampled ops. These are the ones every op goes
+// through; anything else (e.g. "waiting for ..." details) is "other".
+static constexpr std::string_view compact_event_names[] = {
+  "initiated",
+  "header_read",
+  "throttled",
+  "all_read",
+  "dispatched",
+  "queued_for_pg",
+  "reached_pg",
+  "started",
+  "sub_op_started",
+  "sub_op_committed",
+  "sub_op_commit_rec",
+  "op_commit",
+  "commit_sent",
+  "done",
+};
+
+uint8_t TrackedOp::CompactEvents::lookup(std::string_view name)
+{
+  for (unsigned i = 0; i < std::size(compact_event_names); ++i) {
+    if (compact_event_names[i] == name) {
+      return EVENT_FIRST_KNOWN + i;
+    }
+  }
+  return EVENT_OTHER;
+}
+
+const char *TrackedOp::CompactEvents::get_name(uint8_t id)
+{
+  if (id >= EVENT_FIRST_KNOWN &&
+      id < EVENT_FIRST_KNOWN + std::size(compact_event_names)) {
+    return compact_event_names[id - EVENT_FIRST_KNOWN].data();
+  }
+  return id == EVENT_OTHER ? "other" : "none";
+}
+
+void TrackedOp::CompactEvents::record(const utime_t& initiated,
+				      const utime_t& stamp,
+				      std::string_view name)
+{
+  uint8_t id = lookup(name);
+  unsigned i;
+  if (name == "done") {
+    i = MAX_EVENTS;
+  } else {
+    i = num.fetch_add(1, std::memory_order_relaxed);
+    if (i >= MAX_EVENTS) {
+      // out of room: keep the first events, they tell where the op started
+      num.store(MAX_EVENTS, std::memory_order_relaxed);
+      return;
+    }
+  }
+  double usec = stamp > initiated ? ((double)(stamp - initiated) * 1000000.0) : 0;
+  offsets[i] = (uint32_t)std::min<double>(usec, std::numeric_limits<uint32_t>::max());
+  ids[i].store(id, std::memory_order_release);
+}
+
+uint8_t TrackedOp::CompactEvents::last() const
+{
+  if (is_done()) {
+    return ids[MAX_EVENTS].load(std::memory_order_acquire);
+  }
+  unsigned n = std::min<unsigned>(num.load(std::memory_order_relaxed),
+				  MAX_EVENTS);
+  while (n > 0) {
+    uint8_t id = ids[--n].load(std::memory_order_acquire);
+    if (id != EVENT_NONE) {
+      return id;
+    }
+  }
+  return EVENT_NONE;
+}
+
 void TrackedOp::put() {
   again:
     auto nref_snap = nref.load();
@@ -604,10 +731,7 @@ void TrackedOp::mark_event(std::string_view event, utime_t stamp)
   if (!state)
     return;
 
-  {
-    std::lock_guard l(lock);
-    events.emplace_back(stamp, event);
-  }
+  record_event(stamp, event);
   dout(6) << " seq: " << seq
 	  << ", time: " << stamp
 	  << ", event: " << event
@@ -626,6 +750,10 @@ void TrackedOp::dump(utime_t now, Formatter *f, OpTracker::dumper lambda) const
   f->dump_float("age", now - get_initiated());
   f->dump_float("duration", get_duration());
   f->dump_bool("continuous", is_continuous());
+  if (!sampled) {
+    // the events are dumped by _dump() as usual, see for_each_event()
+    f->dump_bool("sampled", false);
+  }
   {
     f->open_object_section("type_data");
     lambda(*this, f);
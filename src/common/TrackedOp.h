@@ -24,12 +24,17 @@
 #include <boost/intrusive/list.hpp>
 #include <boost/intrusive_ptr.hpp>
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <list>
 #include <set>
 #include <vector>
 
 #define OPTRACKER_PREALLOC_EVENTS 20
+// lock-free registration slots per tracker shard; ops beyond that go to the
+// (mutex protected) overflow list of the shard
+#define OPTRACKER_SHARD_SLOTS 512
 
 struct pow2_hist_t;
 class TrackedOp;
@@ -119,6 +124,7 @@ class OpTracker {
   float complaint_time;
   int log_threshold;
   std::atomic<bool> tracking_enabled;
+  std::atomic<uint32_t> sample_rate = {1};
   ceph::shared_mutex lock = ceph::make_shared_mutex("OpTracker::lock");
 
 public:
@@ -143,6 +149,16 @@ public:
   void set_tracking(bool enable) {
     tracking_enabled = enable;
   }
+  /**
+   * keep the full event history of one in every @p rate ops; the others
+   * only record well known events in a compact, lock-free form
+   */
+  void set_sample_rate(uint32_t rate) {
+    sample_rate = std::max<uint32_t>(rate, 1);
+  }
+  uint32_t get_sample_rate() const {
+    return sample_rate;
+  }
   static void default_dumper(const TrackedOp& op, Formatter* f);
   bool dump_ops_in_flight(ceph::Formatter *f, bool print_only_blocked = false, std::set<std::string> filters = {""}, bool count_only = false, dumper lambda = default_dumper);
   bool dump_historic_ops(ceph::Formatter *f, bool by_duration = false, std::set<std::string> filters = {""});
@@ -226,6 +242,7 @@ class TrackedOp : public boost::intrusive::list_base_hook<> {
 public:
   friend class OpHistory;
   friend class OpTracker;
+  friend struct ShardedTrackingData;
 
   static const uint64_t FLAG_CONTINUOUS = (1<<1);
 
@@ -275,6 +292,58 @@ protected:
   std::vector<Event> events;    ///< std::list of events and their times
   mutable ceph::mutex lock = ceph::make_mutex("TrackedOp::lock"); ///< to protect the events list
   uint64_t seq = 0;        ///< a unique value std::set by the OpTracker
+  int32_t slot = -1;       ///< registration slot in the tracker shard, if any
+  bool sampled = true;     ///< false if only compact_events are recorded
+
+  /**
+   * Fixed-size record of the events of an unsampled op. Only events with
+   * a well known name are kept (others are recorded as "other"), stamped
+   * in microseconds relative to initiated_at. Writers claim entries with
+   * an atomic counter, so marking events never takes TrackedOp::lock.
+   */
+  struct CompactEvents {
+    static constexpr unsigned MAX_EVENTS = 15;
+    enum : uint8_t {
+      EVENT_NONE = 0,
+      EVENT_OTHER,
+      EVENT_FIRST_KNOWN,
+    };
+    std::atomic<uint8_t> num = {0};
+    std::array<std::atomic<uint8_t>, MAX_EVENTS + 1> ids = {}; ///< last is "done"
+    std::array<uint32_t, MAX_EVENTS + 1> offsets = {};         ///< usec
+
+    static uint8_t lookup(std::string_view name);
+    static const char *get_name(uint8_t id);
+
+    void record(const utime_t& initiated, const utime_t& stamp,
+                std::string_view name);
+    bool is_done() const {
+      return ids[MAX_EVENTS].load(std::memory_order_acquire) != EVENT_NONE;
+    }
+    utime_t get_stamp(const utime_t& initiated, unsigned i) const {
+      utime_t t = initiated;
+      t += (double)offsets[i] / 1000000.0;
+      return t;
+    }
+    /// id of the most recent event, or EVENT_NONE
+    uint8_t last() const;
+    /// call f(stamp, name) for each recorded event, "done" last
+    template <typename Func>
+    void for_each(const utime_t& initiated, Func&& f) const {
+      unsigned n = std::min<unsigned>(num.load(std::memory_order_relaxed),
+                                      MAX_EVENTS);
+      auto visit = [&](unsigned i) {
+        uint8_t id = ids[i].load(std::memory_order_acquire);
+        if (id != EVENT_NONE) {
+          f(get_stamp(initiated, i), std::string_view(get_name(id)));
+        }
+      };
+      for (unsigned i = 0; i < n; ++i) {
+        visit(i);
+      }
+      visit(MAX_EVENTS);
+    }
+  } compact_events;
 
   uint32_t warn_interval_multiplier = 1; //< limits output of a given op warning
 
@@ -297,7 +366,6 @@ protected:
     tracker(_tracker),
     initiated_at(initiated)
   {
-    events.reserve(OPTRACKER_PREALLOC_EVENTS);
   }
 
   /// output any type-specific data you want to get when dump() is called
@@ -344,7 +412,32 @@ public:
     return initiated_at;
   }
 
+  bool is_sampled() const {
+    return sampled;
+  }
+
+  /// call f(stamp, name) for each event of the op, oldest first; for
+  /// unsampled ops these are the compact events
+  template <typename Func>
+  void for_each_event(Func&& f) const {
+    if (!sampled) {
+      compact_events.for_each(initiated_at, f);
+      return;
+    }
+    std::lock_guard l(lock);
+    for (auto& e : events) {
+      f(e.stamp, std::string_view(e.str));
+    }
+  }
+
   double get_duration() const {
+    if (!sampled) {
+      if (compact_events.is_done())
+        return compact_events.get_stamp(initiated_at,
+                                        CompactEvents::MAX_EVENTS) -
+               get_initiated();
+      return ceph_clock_now() - get_initiated();
+    }
     std::lock_guard l(lock);
     if (!events.empty() && events.rbegin()->compare("done") == 0)
       return events.rbegin()->stamp - get_initiated();
@@ -367,7 +460,10 @@ public:
 
   void tracking_start() {
     if (tracker->register_inflight_op(this)) {
-      events.emplace_back(initiated_at, "initiated");
+      if (sampled) {
+        events.reserve(OPTRACKER_PREALLOC_EVENTS);
+      }
+      record_event(initiated_at, "initiated");
       state = STATE_LIVE;
     }
   }
@@ -381,8 +477,23 @@ public:
     o->put();
   }
 
+private:
+  void record_event(utime_t stamp, std::string_view event) {
+    if (sampled) {
+      std::lock_guard l(lock);
+      events.emplace_back(stamp, event);
+    } else {
+      compact_events.record(initiated_at, stamp, event);
+    }
+  }
+
 protected:
   virtual std::string _get_state_string() const {
+    if (!sampled) {
+      uint8_t id = compact_events.last();
+      return id == CompactEvents::EVENT_NONE ?
+        std::string() : std::string(CompactEvents::get_name(id));
+    }
     return events.empty() ? std::string() : std::string(events.rbegin()->str);
   }
 };
@@ -73,7 +73,7 @@ private:
     auto i = contents.find(key);
     if (i != contents.end()) {
       lru.splice(lru.begin(), lru, i->second);
-    } else {
+    } else if (max_size > 0) {
       ++size;
       lru.push_front(make_pair(key, val));
       contents[key] = lru.begin();
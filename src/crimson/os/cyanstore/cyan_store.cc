@@ -676,6 +676,12 @@ seastar::future<> CyanStore::Shard::do_transaction_no_callbacks(
         r = _remove_collection(cid);
       }
       break;
+      case Transaction::OP_DESTROY_COLLECTION:
+      {
+        coll_t cid = i.get_cid(op->cid);
+        r = _destroy_collection(cid);
+      }
+      break;
       case Transaction::OP_MERGE_COLLECTION:
       {
         coll_t cid = i.get_cid(op->cid);
@@ -1086,6 +1092,18 @@ int CyanStore::Shard::_remove_collection(const coll_t& cid)
   return 0;
 }
 
+int CyanStore::Shard::_destroy_collection(const coll_t& cid)
+{
+  logger().debug("{} cid={}", __func__, cid);
+  auto c = _get_collection(cid);
+  if (!c) {
+    return -ENOENT;
+  }
+  used_bytes -= c->used_bytes();
+  coll_map.erase(cid);
+  return 0;
+}
+
 boost::intrusive_ptr<Collection>
 CyanStore::Shard::_get_collection(const coll_t& cid)
 {
@@ -184,6 +184,7 @@ public:
     int _create_collection(const coll_t& cid, int bits);
     int _merge_collection(const coll_t& cid, const coll_t& dest_cid, int bits);
     int _remove_collection(const coll_t& cid);
+    int _destroy_collection(const coll_t& cid);
     boost::intrusive_ptr<Collection> _get_collection(const coll_t& cid);
 
   private:
@@ -1922,6 +1922,15 @@ SeaStore::Shard::_do_transaction_step(
       DEBUGT("op RMCOLL, cid={} ...", *ctx.transaction, cid);
       return _remove_collection(ctx, cid);
     }
+    case Transaction::OP_DESTROY_COLLECTION:
+    {
+      // removing the objects along with the collection is not supported,
+      // callers must remove them and use OP_RMCOLL
+      coll_t cid = i.get_cid(op->cid);
+      ERRORT("op DESTROY_COLLECTION, cid={} not supported",
+             *ctx.transaction, cid);
+      return crimson::ct_error::input_output_error::make();
+    }
     case Transaction::OP_MKCOLL:
     {
       coll_t cid = i.get_cid(op->cid);
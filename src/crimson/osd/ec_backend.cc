@@ -224,6 +224,7 @@ struct ECCrimsonOp : ECCommon::RMWPipeline::Op {
         break;
       case ceph::os::Transaction::OP_MKCOLL:
       case ceph::os::Transaction::OP_RMCOLL:
+      case ceph::os::Transaction::OP_DESTROY_COLLECTION:
       case ceph::os::Transaction::OP_COLL_REMOVE:
       case ceph::os::Transaction::OP_COLL_SETATTR:
       case ceph::os::Transaction::OP_COLL_RMATTR:
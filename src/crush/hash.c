@@ -2,6 +2,13 @@
 # include <linux/crush/hash.h>
 #else
 # include "hash.h"
+# if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#  include <immintrin.h>
+#  define CRUSH_HASH_AVX2
+# elif defined(__aarch64__) && defined(__ARM_NEON)
+#  include <arm_neon.h>
+#  define CRUSH_HASH_NEON
+# endif
 #endif
 
 /*
@@ -90,6 +97,99 @@ static __u32 crush_hash32_rjenkins1_5(__u32 a, __u32 b, __u32 c, __u32 d,
 }
 
 
+/*
+ * The same mix on vectors of 32-bit lanes, for hashing many values of b
+ * against one (a, c) pair.  Lanes are independent, so each one yields
+ * exactly what crush_hash32_rjenkins1_3 would.  V_* are defined for the
+ * instruction set in use just before each implementation.
+ */
+#define crush_hashmix_v(a, b, c) do {					\
+		a = V_SUB(a, b);  a = V_SUB(a, c);  a = V_XOR(a, V_SRL(c, 13)); \
+		b = V_SUB(b, c);  b = V_SUB(b, a);  b = V_XOR(b, V_SLL(a, 8));	\
+		c = V_SUB(c, a);  c = V_SUB(c, b);  c = V_XOR(c, V_SRL(b, 13)); \
+		a = V_SUB(a, b);  a = V_SUB(a, c);  a = V_XOR(a, V_SRL(c, 12)); \
+		b = V_SUB(b, c);  b = V_SUB(b, a);  b = V_XOR(b, V_SLL(a, 16)); \
+		c = V_SUB(c, a);  c = V_SUB(c, b);  c = V_XOR(c, V_SRL(b, 5));	\
+		a = V_SUB(a, b);  a = V_SUB(a, c);  a = V_XOR(a, V_SRL(c, 3));	\
+		b = V_SUB(b, c);  b = V_SUB(b, a);  b = V_XOR(b, V_SLL(a, 10)); \
+		c = V_SUB(c, a);  c = V_SUB(c, b);  c = V_XOR(c, V_SRL(b, 15)); \
+	} while (0)
+
+#if defined(CRUSH_HASH_AVX2)
+
+#define V_SUB(x, y) _mm256_sub_epi32(x, y)
+#define V_XOR(x, y) _mm256_xor_si256(x, y)
+#define V_SRL(x, n) _mm256_srli_epi32(x, n)
+#define V_SLL(x, n) _mm256_slli_epi32(x, n)
+
+/* returns the number of values hashed, a multiple of 8 */
+__attribute__((target("avx2")))
+static unsigned int crush_hash32_rjenkins1_3_avx2(__u32 a, const __u32 *b,
+						  __u32 c, __u32 *out,
+						  unsigned int n)
+{
+	const __m256i seed = _mm256_set1_epi32(crush_hash_seed ^ a ^ c);
+	unsigned int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m256i va = _mm256_set1_epi32(a);
+		__m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+		__m256i vc = _mm256_set1_epi32(c);
+		__m256i vx = _mm256_set1_epi32(231232);
+		__m256i vy = _mm256_set1_epi32(1232);
+		__m256i hash = V_XOR(seed, vb);
+
+		crush_hashmix_v(va, vb, hash);
+		crush_hashmix_v(vc, vx, hash);
+		crush_hashmix_v(vy, va, hash);
+		crush_hashmix_v(vb, vx, hash);
+		crush_hashmix_v(vy, vc, hash);
+		_mm256_storeu_si256((__m256i *)(out + i), hash);
+	}
+	return i;
+}
+
+#elif defined(CRUSH_HASH_NEON)
+
+#define V_SUB(x, y) vsubq_u32(x, y)
+#define V_XOR(x, y) veorq_u32(x, y)
+#define V_SRL(x, n) vshrq_n_u32(x, n)
+#define V_SLL(x, n) vshlq_n_u32(x, n)
+
+/* returns the number of values hashed, a multiple of 4 */
+static unsigned int crush_hash32_rjenkins1_3_neon(__u32 a, const __u32 *b,
+						  __u32 c, __u32 *out,
+						  unsigned int n)
+{
+	const uint32x4_t seed = vdupq_n_u32(crush_hash_seed ^ a ^ c);
+	unsigned int i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		uint32x4_t va = vdupq_n_u32(a);
+		uint32x4_t vb = vld1q_u32(b + i);
+		uint32x4_t vc = vdupq_n_u32(c);
+		uint32x4_t vx = vdupq_n_u32(231232);
+		uint32x4_t vy = vdupq_n_u32(1232);
+		uint32x4_t hash = V_XOR(seed, vb);
+
+		crush_hashmix_v(va, vb, hash);
+		crush_hashmix_v(vc, vx, hash);
+		crush_hashmix_v(vy, va, hash);
+		crush_hashmix_v(vb, vx, hash);
+		crush_hashmix_v(vy, vc, hash);
+		vst1q_u32(out + i, hash);
+	}
+	return i;
+}
+
+#endif
+
+#undef V_SUB
+#undef V_XOR
+#undef V_SRL
+#undef V_SLL
+
+
 __u32 crush_hash32(int type, __u32 a)
 {
 	switch (type) {
@@ -120,6 +220,28 @@ __u32 crush_hash32_3(int type, __u32 a, __u32 b, __u32 c)
 	}
 }
 
+void crush_hash32_3_n(int type, __u32 a, const __u32 *b, __u32 c,
+		      __u32 *out, unsigned int n)
+{
+	unsigned int i = 0;
+
+	switch (type) {
+	case CRUSH_HASH_RJENKINS1:
+#if defined(CRUSH_HASH_AVX2)
+		if (__builtin_cpu_supports("avx2"))
+			i = crush_hash32_rjenkins1_3_avx2(a, b, c, out, n);
+#elif defined(CRUSH_HASH_NEON)
+		i = crush_hash32_rjenkins1_3_neon(a, b, c, out, n);
+#endif
+		for (; i < n; i++)
+			out[i] = crush_hash32_rjenkins1_3(a, b[i], c);
+		break;
+	default:
+		for (; i < n; i++)
+			out[i] = 0;
+	}
+}
+
 __u32 crush_hash32_4(int type, __u32 a, __u32 b, __u32 c, __u32 d)
 {
 	switch (type) {
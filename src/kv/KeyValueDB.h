@@ -156,6 +156,16 @@ public:
       const std::string &end        ///< [in] The start bound of remove keys
       ) = 0;
 
+    /// Removes keys in [start, end) with a single range tombstone no matter
+    /// how many keys there are; for ranges known to hold many keys.
+    virtual void rm_range_keys_bulk(
+      const std::string &prefix,    ///< [in] Prefix by which to remove keys
+      const std::string &start,     ///< [in] The start bound of remove keys
+      const std::string &end        ///< [in] The end bound of remove keys
+      ) {
+      rm_range_keys(prefix, start, end);
+    }
+
     /// Merge value into key
     virtual void merge(
       const std::string &prefix,   ///< [in] Prefix/CF ==> MUST match some established merge operator
@@ -505,6 +515,14 @@ public:
     return -EOPNOTSUPP;
   }
 
+  /// Hint that keys under prefix share their first prefix_len bytes with
+  /// every key they are range-read together with, so that a prefix bloom
+  /// filter can be used. Must be done BEFORE the DB is opened.
+  virtual int set_prefix_bloom(const std::string& prefix,
+			       size_t prefix_len) {
+    return -EOPNOTSUPP;
+  }
+
   virtual void get_statistics(ceph::Formatter *f) {
     return;
   }
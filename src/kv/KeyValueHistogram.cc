@@ -76,3 +76,33 @@ void KeyValueHistogram::dump(Formatter* f)
   }
   f->close_section();
 }
+
+void KeyValueAccessStats::prefix_stats_t::dump(Formatter* f, double seconds) const
+{
+  f->dump_unsigned("sets", sets);
+  f->dump_unsigned("set_bytes", set_bytes);
+  f->dump_unsigned("rms", rms);
+  f->dump_unsigned("range_rms", range_rms);
+  f->dump_unsigned("merges", merges);
+  f->dump_unsigned("merge_bytes", merge_bytes);
+  f->dump_unsigned("gets", gets);
+  f->dump_unsigned("iterators", iterators);
+  if (seconds > 0) {
+    f->dump_float("write_bytes_per_sec", write_bytes() / seconds);
+    f->dump_float("deletes_per_sec", (rms + range_rms) / seconds);
+    f->dump_float("reads_per_sec", (gets + iterators) / seconds);
+  }
+}
+
+void KeyValueAccessStats::dump(Formatter* f, double seconds) const
+{
+  f->dump_float("seconds", seconds);
+  f->open_array_section("prefixes");
+  for (auto& [prefix, ps] : prefixes) {
+    f->open_object_section("prefix");
+    f->dump_string("prefix", prefix);
+    ps.dump(f, seconds);
+    f->close_section();
+  }
+  f->close_section();
+}
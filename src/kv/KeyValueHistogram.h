@@ -36,4 +36,53 @@ struct KeyValueHistogram {
   void dump(ceph::Formatter* f);
 };
 
+/**
+ *
+ * Per-prefix access rates of a Key Value DB
+ *
+ */
+struct KeyValueAccessStats {
+  struct prefix_stats_t {
+    uint64_t sets = 0;
+    uint64_t set_bytes = 0;    ///< key and value bytes written by sets
+    uint64_t rms = 0;          ///< single key removals
+    uint64_t range_rms = 0;    ///< prefix and range removals
+    uint64_t merges = 0;
+    uint64_t merge_bytes = 0;
+    uint64_t gets = 0;         ///< keys looked up
+    uint64_t iterators = 0;
+
+    uint64_t write_bytes() const {
+      return set_bytes + merge_bytes;
+    }
+    void add(const prefix_stats_t& o) {
+      sets += o.sets;
+      set_bytes += o.set_bytes;
+      rms += o.rms;
+      range_rms += o.range_rms;
+      merges += o.merges;
+      merge_bytes += o.merge_bytes;
+      gets += o.gets;
+      iterators += o.iterators;
+    }
+    void dump(ceph::Formatter* f, double seconds) const;
+  };
+
+  std::map<std::string, prefix_stats_t> prefixes;
+
+  bool empty() const {
+    return prefixes.empty();
+  }
+  void add(const KeyValueAccessStats& o) {
+    for (auto& [prefix, ps] : o.prefixes) {
+      prefixes[prefix].add(ps);
+    }
+  }
+  void clear() {
+    prefixes.clear();
+  }
+  /// dump totals and per second rates over the given interval
+  void dump(ceph::Formatter* f, double seconds) const;
+};
+
 #endif
@@ -1,12 +1,15 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:nil -*-
 // vim: ts=8 sw=2 sts=2 expandtab
 
+#include <algorithm>
+#include <cmath>
 #include <filesystem>
 #include <map>
 #include <memory>
 #include <set>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <tuple>
 #include <unordered_map>
 #include <errno.h>
@@ -33,6 +36,7 @@
 #include "common/PriorityCache.h"
 #include "common/strtol.h"
 #include "include/common_fwd.h"
+#include "include/intarith.h"
 #include "include/scope_guard.h"
 #include "include/str_list.h"
 #include "include/stringify.h"
@@ -196,6 +200,16 @@ int RocksDBStore::set_merge_operator(
   return 0;
 }
 
+int RocksDBStore::set_prefix_bloom(
+  const string& prefix,
+  size_t prefix_len)
+{
+  // like merge operators this is baked into the column family options
+  ceph_assert(db == nullptr);
+  prefix_blooms[prefix] = prefix_len;
+  return 0;
+}
+
 class CephRocksdbLogger : public rocksdb::Logger {
   CephContext *cct;
 public:
@@ -463,6 +477,23 @@ int RocksDBStore::install_cf_mergeop(
   return 0;
 }
 
+void RocksDBStore::install_cf_prefix_bloom(
+  const string &key_prefix,
+  rocksdb::ColumnFamilyOptions *cf_opt)
+{
+  ceph_assert(cf_opt != nullptr);
+  auto p = prefix_blooms.find(key_prefix);
+  // an explicit prefix_extractor in the sharding options wins
+  if (p == prefix_blooms.end() || cf_opt->prefix_extractor) {
+    return;
+  }
+  // capped, so that shorter keys (omap headers of other layouts) are still
+  // accepted as their own prefix
+  cf_opt->prefix_extractor.reset(rocksdb::NewCappedPrefixTransform(p->second));
+  dout(10) << __func__ << " column " << key_prefix << " prefix bloom on "
+	   << p->second << " bytes" << dendl;
+}
+
 int RocksDBStore::create_and_open(ostream &out,
 				  const std::string& cfs)
 {
@@ -953,6 +984,7 @@ int RocksDBStore::update_column_family_options(const std::string& base_name,
   if (base_name != rocksdb::kDefaultColumnFamilyName) {
     // default cf has its merge operator defined in load_rocksdb_options, should not override it
     install_cf_mergeop(base_name, cf_opt);
+    install_cf_prefix_bloom(base_name, cf_opt);
   }
   if (!block_cache_opt.empty()) {
     r = apply_block_cache_options(base_name, block_cache_opt, cf_opt);
@@ -1275,9 +1307,26 @@ int RocksDBStore::do_open(ostream &out,
   plb.add_time_avg(l_rocksdb_write_delay_time, "rocksdb_write_delay_time", "Rocksdb write delay time");
   plb.add_time_avg(l_rocksdb_write_pre_and_post_process_time, 
       "rocksdb_write_pre_and_post_time", "total time spent on writing a record, excluding write process");
+  plb.add_u64_counter(l_rocksdb_iter_pool_hit, "iter_pool_hit",
+      "Column family iterators served from the iterator pool");
+  plb.add_u64_counter(l_rocksdb_iter_pool_miss, "iter_pool_miss",
+      "Column family iterators newly created by rocksdb");
   logger = plb.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
 
+  iterator_pool_size = cct->_conf.get_val<uint64_t>("rocksdb_iterator_pool_size");
+  iterator_pool_max_age = ceph::make_timespan(
+    cct->_conf.get_val<double>("rocksdb_iterator_pool_max_age"));
+  if (iterator_pool_max_age == ceph::timespan::zero()) {
+    iterator_pool_size = 0;
+  }
+  if (iterator_pool_size) {
+    iterator_pool_stop = false;
+    iterator_pool_thread.create("rstore_iterpool");
+  }
+  access_stats_enabled = cct->_conf.get_val<bool>("rocksdb_access_stats");
+  access_stats_since = ceph_clock_now();
+
   if (compact_on_mount) {
     derr << "Compacting rocksdb store..." << dendl;
     compact();
@@ -1320,6 +1369,17 @@ void RocksDBStore::close()
     compact_queue_lock.unlock();
   }
 
+  if (iterator_pool_thread.is_started()) {
+    {
+      std::lock_guard l(iterator_pool_lock);
+      iterator_pool_stop = true;
+      iterator_pool_cond.notify_all();
+    }
+    iterator_pool_thread.join();
+  }
+  // pooled iterators must go before the column families and the db
+  clear_iterator_pool();
+
   if (logger) {
     cct->get_perfcounters_collection()->remove(logger);
     delete logger;
@@ -1567,6 +1627,11 @@ int RocksDBStore::submit_common(rocksdb::WriteOptions& woptions, KeyValueDB::Tra
   *_dout << " Rocksdb transaction: " << bat_txc.get_seen() << dendl;
   
   rocksdb::Status s = db->Write(woptions, &_t->bat);
+  if (_t->stats) {
+    auto& shard = get_access_stats_shard();
+    std::lock_guard l(shard.lock);
+    shard.stats.add(*_t->stats);
+  }
   if (!s.ok()) {
     RocksWBHandler rocks_txc(*this, true);
     _t->bat.Iterate(&rocks_txc);
@@ -1630,6 +1695,18 @@ RocksDBStore::RocksDBTransactionImpl::RocksDBTransactionImpl(RocksDBStore *_db)
   db = _db;
 }
 
+KeyValueAccessStats::prefix_stats_t*
+RocksDBStore::RocksDBTransactionImpl::account(const string& prefix)
+{
+  if (!db->access_stats_enabled) {
+    return nullptr;
+  }
+  if (!stats) {
+    stats = std::make_unique<KeyValueAccessStats>();
+  }
+  return &stats->prefixes[prefix];
+}
+
 void RocksDBStore::RocksDBTransactionImpl::put_bat(
   rocksdb::WriteBatch& bat,
   rocksdb::ColumnFamilyHandle *cf,
@@ -1665,6 +1742,10 @@ void RocksDBStore::RocksDBTransactionImpl::set(
   const string &k,
   const bufferlist &to_set_bl)
 {
+  if (auto ps = account(prefix); ps) {
+    ps->sets++;
+    ps->set_bytes += k.size() + to_set_bl.length();
+  }
   auto cf = db->get_cf_handle(prefix, k);
   if (cf) {
     put_bat(bat, cf, k, to_set_bl);
@@ -1679,6 +1760,10 @@ void RocksDBStore::RocksDBTransactionImpl::set(
   const char *k, size_t keylen,
   const bufferlist &to_set_bl)
 {
+  if (auto ps = account(prefix); ps) {
+    ps->sets++;
+    ps->set_bytes += keylen + to_set_bl.length();
+  }
   auto cf = db->get_cf_handle(prefix, k, keylen);
   if (cf) {
     string key(k, keylen);  // fixme?
@@ -1693,6 +1778,9 @@ void RocksDBStore::RocksDBTransactionImpl::set(
 void RocksDBStore::RocksDBTransactionImpl::rmkey(const string &prefix,
 					         const string &k)
 {
+  if (auto ps = account(prefix); ps) {
+    ps->rms++;
+  }
   auto cf = db->get_cf_handle(prefix, k);
   if (cf) {
     bat.Delete(cf, rocksdb::Slice(k));
@@ -1705,6 +1793,9 @@ void RocksDBStore::RocksDBTransactionImpl::rmkey(const string &prefix,
 					         const char *k,
 						 size_t keylen)
 {
+  if (auto ps = account(prefix); ps) {
+    ps->rms++;
+  }
   auto cf = db->get_cf_handle(prefix, k, keylen);
   if (cf) {
     bat.Delete(cf, rocksdb::Slice(k, keylen));
@@ -1718,6 +1809,9 @@ void RocksDBStore::RocksDBTransactionImpl::rmkey(const string &prefix,
 void RocksDBStore::RocksDBTransactionImpl::rm_single_key(const string &prefix,
 					                 const string &k)
 {
+  if (auto ps = account(prefix); ps) {
+    ps->rms++;
+  }
   auto cf = db->get_cf_handle(prefix, k);
   if (cf) {
     bat.SingleDelete(cf, k);
@@ -1728,6 +1822,9 @@ void RocksDBStore::RocksDBTransactionImpl::rm_single_key(const string &prefix,
 
 void RocksDBStore::RocksDBTransactionImpl::rmkeys_by_prefix(const string &prefix)
 {
+  if (auto ps = account(prefix); ps) {
+    ps->range_rms++;
+  }
   auto p_iter = db->cf_handles.find(prefix);
   if (p_iter == db->cf_handles.end()) {
     uint64_t cnt = db->get_delete_range_threshold();
@@ -1774,6 +1871,9 @@ void RocksDBStore::RocksDBTransactionImpl::rm_range_keys(const string &prefix,
                      << " enter prefix=" << prefix
                      << " start=" << pretty_binary_string(start)
 		     << " end=" << pretty_binary_string(end) << dendl;
+  if (auto ps = account(prefix); ps) {
+    ps->range_rms++;
+  }
   auto p_iter = db->cf_handles.find(prefix);
   uint64_t cnt = db->get_delete_range_threshold();
   if (p_iter == db->cf_handles.end()) {
@@ -1836,11 +1936,40 @@ void RocksDBStore::RocksDBTransactionImpl::rm_range_keys(const string &prefix,
   ldout(db->cct, 10) << __func__ << " end" << dendl;
 }
 
+void RocksDBStore::RocksDBTransactionImpl::rm_range_keys_bulk(
+  const string &prefix,
+  const string &start,
+  const string &end)
+{
+  ldout(db->cct, 10) << __func__
+                     << " prefix=" << prefix
+                     << " start=" << pretty_binary_string(start)
+		     << " end=" << pretty_binary_string(end) << dendl;
+  if (auto ps = account(prefix); ps) {
+    ps->range_rms++;
+  }
+  auto p_iter = db->cf_handles.find(prefix);
+  if (p_iter == db->cf_handles.end()) {
+    bat.DeleteRange(db->default_cf,
+		    rocksdb::Slice(combine_strings(prefix, start)),
+		    rocksdb::Slice(combine_strings(prefix, end)));
+  } else {
+    ceph_assert(p_iter->second.handles.size() >= 1);
+    for (auto cf : p_iter->second.handles) {
+      bat.DeleteRange(cf, rocksdb::Slice(start), rocksdb::Slice(end));
+    }
+  }
+}
+
 void RocksDBStore::RocksDBTransactionImpl::merge(
   const string &prefix,
   const string &k,
   const bufferlist &to_set_bl)
 {
+  if (auto ps = account(prefix); ps) {
+    ps->merges++;
+    ps->merge_bytes += k.size() + to_set_bl.length();
+  }
   auto cf = db->get_cf_handle(prefix, k);
   if (cf) {
     // bufferlist::c_str() is non-constant, so we can't call c_str()
@@ -1914,6 +2043,7 @@ int RocksDBStore::get(
   }
   utime_t lat = ceph_clock_now() - start;
   logger->tinc_with_max(l_rocksdb_get_latency, lat);
+  account_reads(prefix, keys.size(), 0);
   return 0;
 }
 
@@ -1949,6 +2079,7 @@ int RocksDBStore::get(
   }
   utime_t lat = ceph_clock_now() - start;
   logger->tinc_with_max(l_rocksdb_get_latency, lat);
+  account_reads(prefix, 1, 0);
   return r;
 }
 
@@ -1986,9 +2117,50 @@ int RocksDBStore::get(
   }
   utime_t lat = ceph_clock_now() - start;
   logger->tinc_with_max(l_rocksdb_get_latency, lat);
+  account_reads(prefix, 1, 0);
   return r;
 }
 
+void RocksDBStore::account_reads(const string& prefix,
+				 uint64_t gets,
+				 uint64_t iterators)
+{
+  if (!access_stats_enabled) {
+    return;
+  }
+  auto& shard = get_access_stats_shard();
+  std::lock_guard l(shard.lock);
+  auto& ps = shard.stats.prefixes[prefix];
+  ps.gets += gets;
+  ps.iterators += iterators;
+}
+
+RocksDBStore::access_stats_shard_t& RocksDBStore::get_access_stats_shard() const
+{
+  size_t h = std::hash<std::thread::id>{}(std::this_thread::get_id());
+  return access_stats_shards[h % ACCESS_STATS_SHARDS];
+}
+
+KeyValueAccessStats RocksDBStore::get_access_stats(bool reset, utime_t* since)
+{
+  KeyValueAccessStats stats;
+  std::lock_guard l(access_stats_lock);
+  for (auto& shard : access_stats_shards) {
+    std::lock_guard sl(shard.lock);
+    stats.add(shard.stats);
+    if (reset) {
+      shard.stats.clear();
+    }
+  }
+  if (since) {
+    *since = access_stats_since;
+  }
+  if (reset) {
+    access_stats_since = ceph_clock_now();
+  }
+  return stats;
+}
+
 int RocksDBStore::split_key(rocksdb::Slice in, string *prefix, string *key)
 {
   size_t prefix_len = 0;
@@ -2593,35 +2765,180 @@ string RocksDBStore::past_prefix(const string &prefix)
   return limit;
 }
 
+/**
+ * A rocksdb iterator together with the storage its iterate bounds point
+ * to. rocksdb keeps pointers to the bound slices and reads them on every
+ * seek, so a pooled iterator is handed out again with new bound values as
+ * long as it was created with the same set of bounds.
+ */
+struct RocksDBStore::PooledIterator {
+  rocksdb::ColumnFamilyHandle* cf;
+  bool has_lower;
+  bool has_upper;
+  rocksdb::Iterator* dbiter = nullptr;
+  std::string lower;
+  std::string upper;
+  rocksdb::Slice lower_slice;
+  rocksdb::Slice upper_slice;
+  ceph::mono_clock::time_point released;
+
+  PooledIterator(rocksdb::ColumnFamilyHandle* cf, bool has_lower,
+		 bool has_upper)
+    : cf(cf), has_lower(has_lower), has_upper(has_upper) {}
+  ~PooledIterator() {
+    delete dbiter;
+  }
+  iterator_pool_key_t key() const {
+    return {cf, has_lower, has_upper};
+  }
+  void set_bounds(const KeyValueDB::IteratorBounds& bounds) {
+    if (has_lower) {
+      lower = *bounds.lower_bound;
+      lower_slice = rocksdb::Slice(lower);
+    }
+    if (has_upper) {
+      upper = *bounds.upper_bound;
+      upper_slice = rocksdb::Slice(upper);
+    }
+  }
+};
+
+RocksDBStore::PooledIterator* RocksDBStore::get_pooled_iterator(
+  const std::string& prefix,
+  rocksdb::ColumnFamilyHandle* cf,
+  const IteratorBounds& bounds) const
+{
+  bool use_bounds = cct->_conf->osd_rocksdb_iterator_bounds_enabled;
+  bool has_lower = use_bounds && bounds.lower_bound.has_value();
+  bool has_upper = use_bounds && bounds.upper_bound.has_value();
+
+  PooledIterator* pi = nullptr;
+  if (iterator_pool_size) {
+    auto now = ceph::mono_clock::now();
+    std::vector<PooledIterator*> expired;
+    {
+      std::lock_guard l(iterator_pool_lock);
+      _expire_pooled_iterators(now, &expired);
+      auto p = iterator_pool.find({cf, has_lower, has_upper});
+      if (p != iterator_pool.end() && !p->second.empty()) {
+	pi = p->second.back();
+	p->second.pop_back();
+      }
+    }
+    for (auto i : expired) {
+      delete i;
+    }
+  }
+  if (pi) {
+    pi->set_bounds(bounds);
+    // move the implicit snapshot to the current sequence, as a freshly
+    // created iterator would see
+    if (pi->dbiter->Refresh().ok()) {
+      if (logger) {
+	logger->inc(l_rocksdb_iter_pool_hit);
+      }
+      return pi;
+    }
+    delete pi;
+  }
+
+  pi = new PooledIterator(cf, has_lower, has_upper);
+  pi->set_bounds(bounds);
+  auto options = rocksdb::ReadOptions();
+  if (has_lower) {
+    options.iterate_lower_bound = &pi->lower_slice;
+  }
+  if (has_upper) {
+    options.iterate_upper_bound = &pi->upper_slice;
+    // lets bounded seeks within one prefix consult the prefix bloom
+    options.auto_prefix_mode = prefix_blooms.count(prefix) > 0;
+  }
+  // otherwise a prefix extractor on the column family would make Seek()
+  // stay within the prefix of its target
+  options.total_order_seek = !options.auto_prefix_mode;
+  pi->dbiter = db->NewIterator(options, cf);
+  if (logger) {
+    logger->inc(l_rocksdb_iter_pool_miss);
+  }
+  return pi;
+}
+
+void RocksDBStore::put_pooled_iterator(PooledIterator* pi) const
+{
+  if (iterator_pool_size && pi->dbiter->status().ok()) {
+    pi->released = ceph::mono_clock::now();
+    std::lock_guard l(iterator_pool_lock);
+    auto& v = iterator_pool[pi->key()];
+    if (v.size() < iterator_pool_size) {
+      v.push_back(pi);
+      return;
+    }
+  }
+  delete pi;
+}
+
+// Called with iterator_pool_lock held. Idle iterators pin the memtables
+// and SST files they were created on, hand out the ones older than
+// iterator_pool_max_age for deletion outside the lock.
+void RocksDBStore::_expire_pooled_iterators(
+  ceph::mono_clock::time_point now,
+  std::vector<PooledIterator*>* expired) const
+{
+  for (auto& [key, v] : iterator_pool) {
+    // entries are in release order
+    auto fresh = std::find_if(v.begin(), v.end(), [&](PooledIterator* i) {
+      return now - i->released < iterator_pool_max_age;
+    });
+    expired->insert(expired->end(), v.begin(), fresh);
+    v.erase(v.begin(), fresh);
+  }
+}
+
+void RocksDBStore::iterator_pool_thread_entry()
+{
+  std::unique_lock l{iterator_pool_lock};
+  while (!iterator_pool_stop) {
+    iterator_pool_cond.wait_for(l, iterator_pool_max_age / 2);
+    std::vector<PooledIterator*> expired;
+    _expire_pooled_iterators(ceph::mono_clock::now(), &expired);
+    if (!expired.empty()) {
+      l.unlock();
+      for (auto i : expired) {
+	delete i;
+      }
+      l.lock();
+    }
+  }
+}
+
+void RocksDBStore::clear_iterator_pool()
+{
+  std::lock_guard l(iterator_pool_lock);
+  for (auto& p : iterator_pool) {
+    for (auto pi : p.second) {
+      delete pi;
+    }
+  }
+  iterator_pool.clear();
+}
+
 class CFIteratorImpl : public KeyValueDB::IteratorImpl {
 protected:
   string prefix;
+  const RocksDBStore* db;
+  RocksDBStore::PooledIterator* pi;
   rocksdb::Iterator *dbiter;
-  const KeyValueDB::IteratorBounds bounds;
-  const rocksdb::Slice iterate_lower_bound;
-  const rocksdb::Slice iterate_upper_bound;
 public:
   explicit CFIteratorImpl(const RocksDBStore* db,
                           const std::string& p,
                           rocksdb::ColumnFamilyHandle* cf,
-                          KeyValueDB::IteratorBounds bounds_)
-    : prefix(p), bounds(std::move(bounds_)),
-      iterate_lower_bound(make_slice(bounds.lower_bound)),
-      iterate_upper_bound(make_slice(bounds.upper_bound))
-      {
-      auto options = rocksdb::ReadOptions();
-      if (db->cct->_conf->osd_rocksdb_iterator_bounds_enabled) {
-        if (bounds.lower_bound) {
-          options.iterate_lower_bound = &iterate_lower_bound;
-        }
-        if (bounds.upper_bound) {
-          options.iterate_upper_bound = &iterate_upper_bound;
-        }
-      }
-      dbiter = db->db->NewIterator(options, cf);
-  }
+                          KeyValueDB::IteratorBounds bounds)
+    : prefix(p), db(db),
+      pi(db->get_pooled_iterator(p, cf, bounds)),
+      dbiter(pi->dbiter)
+  {}
   ~CFIteratorImpl() {
-    delete dbiter;
+    db->put_pooled_iterator(pi);
   }
 
   int seek_to_first() override {
@@ -3203,6 +3520,7 @@ public:
   {
     iters.reserve(shards.size());
     auto options = rocksdb::ReadOptions();
+    options.total_order_seek = true;
     if (db->cct->_conf->osd_rocksdb_iterator_bounds_enabled) {
       if (bounds.lower_bound) {
         options.iterate_lower_bound = &iterate_lower_bound;
@@ -3395,6 +3713,7 @@ public:
 
 KeyValueDB::Iterator RocksDBStore::get_iterator(const std::string& prefix, IteratorOpts opts, IteratorBounds bounds)
 {
+  account_reads(prefix, 0, 1);
   auto cf_it = cf_handles.find(prefix);
   if (cf_it != cf_handles.end()) {
     rocksdb::ColumnFamilyHandle* cf = nullptr;
@@ -3733,8 +4052,11 @@ int RocksDBStore::reshard(const std::string& new_sharding, const RocksDBStore::r
 			    const std::string& fixed_prefix)
   {
     dout(5) << " column=" << (void*)handle << " prefix=" << fixed_prefix << dendl;
+    // keys are moved across prefixes, ignore any prefix extractor
+    rocksdb::ReadOptions ropts;
+    ropts.total_order_seek = true;
     std::unique_ptr<rocksdb::Iterator> it{
-      db->NewIterator(rocksdb::ReadOptions(), handle)};
+      db->NewIterator(ropts, handle)};
     ceph_assert(it);
 
     rocksdb::WriteBatch bat;
@@ -3748,7 +4070,7 @@ int RocksDBStore::reshard(const std::string& new_sharding, const RocksDBStore::r
 	bytes_per_iterator = 0;
 	keys_per_iterator = 0;
 	std::string raw_key_str = raw_key.ToString();
-	it.reset(db->NewIterator(rocksdb::ReadOptions(), handle));
+	it.reset(db->NewIterator(ropts, handle));
 	ceph_assert(it);
 	it->Seek(raw_key_str);
 	ceph_assert(it->Valid());
@@ -3875,6 +4197,245 @@ bool RocksDBStore::get_sharding(std::string& sharding) {
   return result;
 }
 
+std::string RocksDBStore::sharding_def_to_string(
+  const std::vector<ColumnFamily>& sharding_def)
+{
+  std::string text;
+  for (const auto& cf : sharding_def) {
+    if (!text.empty()) {
+      text += ' ';
+    }
+    text += cf.name;
+    bool has_range = cf.hash_l != 0 ||
+      cf.hash_h != std::numeric_limits<uint32_t>::max();
+    if (cf.shard_cnt != 1 || has_range) {
+      text += '(' + std::to_string(cf.shard_cnt);
+      if (has_range) {
+	text += ',' + std::to_string(cf.hash_l) + '-';
+	if (cf.hash_h != std::numeric_limits<uint32_t>::max()) {
+	  text += std::to_string(cf.hash_h);
+	}
+      }
+      text += ')';
+    }
+    if (!cf.options.empty()) {
+      text += '=' + cf.options;
+    }
+  }
+  return text;
+}
+
+double RocksDBStore::estimate_write_amp(const sharding_model_t& model,
+					uint64_t live_bytes,
+					size_t shard_cnt,
+					double churn)
+{
+  // every byte goes to the WAL and is flushed from the memtable once
+  double wa = 2;
+  double shard_bytes = double(live_bytes) / std::max<size_t>(shard_cnt, 1);
+  double levels = 1;
+  if (shard_bytes > model.level_base && model.level_multiplier > 1) {
+    levels += std::ceil(std::log(shard_bytes / model.level_base) /
+			std::log(model.level_multiplier));
+  }
+  // a byte that survives compaction is rewritten about (multiplier + 1) / 2
+  // times for each level it moves down; keys deleted soon after being
+  // written (churn) mostly die before leaving L0.
+  wa += (1 - std::clamp(churn, 0.0, 1.0)) * levels *
+    (model.level_multiplier + 1) / 2;
+  return wa;
+}
+
+namespace {
+struct column_load_t {
+  size_t shard_cnt = 1;
+  uint64_t live_bytes = 0;
+  uint64_t write_bytes = 0;
+  uint64_t sets = 0;
+  uint64_t deletes = 0;
+  std::vector<std::string> prefixes;
+};
+}
+
+// Returns the write weighted write amplification of the whole db.
+static double dump_sharding_write_amp(
+  const RocksDBStore::sharding_model_t& model,
+  const std::vector<RocksDBStore::ColumnFamily>& sharding_def,
+  const std::map<std::string, KeyValueAccessStats::prefix_stats_t>& stats,
+  const std::map<std::string, uint64_t>& live_bytes,
+  Formatter* f)
+{
+  std::map<std::string, column_load_t> columns;
+  columns[rocksdb::kDefaultColumnFamilyName];
+  for (const auto& cf : sharding_def) {
+    columns[cf.name].shard_cnt = cf.shard_cnt;
+  }
+  auto column_of = [&](const std::string& prefix) -> column_load_t& {
+    auto p = columns.find(prefix);
+    if (p == columns.end() || prefix == rocksdb::kDefaultColumnFamilyName) {
+      return columns[rocksdb::kDefaultColumnFamilyName];
+    }
+    return p->second;
+  };
+  for (const auto& [prefix, ps] : stats) {
+    auto& c = column_of(prefix);
+    c.prefixes.push_back(prefix);
+    c.write_bytes += ps.write_bytes();
+    c.sets += ps.sets + ps.merges;
+    c.deletes += ps.rms + ps.range_rms;
+  }
+  for (const auto& [prefix, bytes] : live_bytes) {
+    column_of(prefix).live_bytes += bytes;
+  }
+
+  double weighted = 0;
+  uint64_t written = 0;
+  if (f) {
+    f->dump_string("sharding", RocksDBStore::sharding_def_to_string(sharding_def));
+    f->open_array_section("columns");
+  }
+  for (const auto& [name, c] : columns) {
+    double churn = c.sets ? double(c.deletes) / c.sets : 0;
+    double wa = RocksDBStore::estimate_write_amp(model, c.live_bytes,
+						 c.shard_cnt, churn);
+    weighted += wa * c.write_bytes;
+    written += c.write_bytes;
+    if (f) {
+      f->open_object_section("column");
+      f->dump_string("name", name);
+      f->dump_unsigned("shards", c.shard_cnt);
+      f->open_array_section("prefixes");
+      for (const auto& p : c.prefixes) {
+	f->dump_string("prefix", p);
+      }
+      f->close_section();
+      f->dump_unsigned("live_bytes", c.live_bytes);
+      f->dump_unsigned("write_bytes", c.write_bytes);
+      f->dump_float("churn", std::min(churn, 1.0));
+      f->dump_float("write_amp", wa);
+      f->close_section();
+    }
+  }
+  double total = written ? weighted / written : 0;
+  if (f) {
+    f->close_section();
+    f->dump_float("write_amp", total);
+  }
+  return total;
+}
+
+std::vector<RocksDBStore::ColumnFamily> RocksDBStore::plan_sharding(
+  const std::vector<ColumnFamily>& current,
+  const std::map<std::string, KeyValueAccessStats::prefix_stats_t>& stats,
+  const std::map<std::string, uint64_t>& live_bytes,
+  const sharding_model_t& model,
+  Formatter* f)
+{
+  auto shards_for = [&](uint64_t live) {
+    return std::clamp<size_t>(div_round_up(live, model.shard_target_bytes),
+			      1, std::max<size_t>(model.max_shards, 1));
+  };
+  auto live_of = [&](const std::string& prefix) -> uint64_t {
+    auto p = live_bytes.find(prefix);
+    return p == live_bytes.end() ? 0 : p->second;
+  };
+  uint64_t total_write = 0;
+  for (const auto& [prefix, ps] : stats) {
+    total_write += ps.write_bytes();
+  }
+
+  std::vector<ColumnFamily> proposed = current;
+  for (const auto& [prefix, ps] : stats) {
+    if (total_write == 0 ||
+	double(ps.write_bytes()) / total_write < model.hot_write_share) {
+      continue;
+    }
+    // the empty prefix is the whole key space, and names with separators
+    // of the sharding definition cannot be column names
+    if (prefix.empty() ||
+	prefix == rocksdb::kDefaultColumnFamilyName ||
+	prefix.find_first_of(" ()=-") != std::string::npos) {
+      continue;
+    }
+    auto p = std::find_if(proposed.begin(), proposed.end(),
+      [&](const ColumnFamily& cf) { return cf.name == prefix; });
+    if (p == proposed.end()) {
+      proposed.emplace_back(prefix, shards_for(live_of(prefix)), "",
+			    0, std::numeric_limits<uint32_t>::max());
+    }
+  }
+  // never merge or shrink, only split columns whose shards grew too large
+  for (auto& cf : proposed) {
+    uint64_t live = live_of(cf.name);
+    if (live > 2 * model.shard_target_bytes * cf.shard_cnt) {
+      cf.shard_cnt = std::max(cf.shard_cnt, shards_for(live));
+    }
+  }
+
+  if (f) {
+    f->open_object_section("current");
+    double before = dump_sharding_write_amp(model, current, stats, live_bytes, f);
+    f->close_section();
+    f->open_object_section("proposed");
+    double after = dump_sharding_write_amp(model, proposed, stats, live_bytes, f);
+    f->close_section();
+    f->dump_float("write_amp_change", after - before);
+  }
+  return proposed;
+}
+
+int RocksDBStore::advise_sharding(Formatter* f,
+				  double hot_write_share,
+				  bool reset,
+				  std::string* proposed_sharding)
+{
+  if (!access_stats_enabled) {
+    return -EOPNOTSUPP;
+  }
+  utime_t since;
+  KeyValueAccessStats stats = get_access_stats(reset, &since);
+  std::vector<ColumnFamily> current;
+  std::string current_text;
+  if (get_sharding(current_text) &&
+      !parse_sharding_def(current_text, current)) {
+    derr << __func__ << " cannot parse stored sharding: "
+	 << current_text << dendl;
+    return -EIO;
+  }
+
+  std::map<std::string, uint64_t> live_bytes;
+  for (const auto& [prefix, ps] : stats.prefixes) {
+    live_bytes[prefix] = estimate_prefix_size(prefix, "");
+  }
+  for (const auto& cf : current) {
+    if (!live_bytes.count(cf.name)) {
+      live_bytes[cf.name] = estimate_prefix_size(cf.name, "");
+    }
+  }
+
+  sharding_model_t model;
+  rocksdb::Options opts = db->GetOptions(default_cf);
+  model.level_base = opts.max_bytes_for_level_base;
+  model.level_multiplier = opts.max_bytes_for_level_multiplier;
+  model.hot_write_share = hot_write_share;
+  model.shard_target_bytes =
+    cct->_conf.get_val<Option::size_t>("rocksdb_sharding_advise_shard_target");
+  model.max_shards =
+    cct->_conf.get_val<uint64_t>("rocksdb_sharding_advise_max_shards");
+
+  f->open_object_section("access_stats");
+  stats.dump(f, (double)(ceph_clock_now() - since));
+  f->close_section();
+  auto proposed = plan_sharding(current, stats.prefixes, live_bytes, model, f);
+  std::string proposed_text = sharding_def_to_string(proposed);
+  bool changed = proposed_text != sharding_def_to_string(current);
+  f->dump_bool("changed", changed);
+  if (proposed_sharding) {
+    *proposed_sharding = changed ? proposed_text : std::string();
+  }
+  return 0;
+}
+
 // Find a key that is lexicographically between low and high.
 // Try to select "midpoint".
 // If high is a direct successor to low, return "".
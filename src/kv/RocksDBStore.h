@@ -10,10 +10,13 @@
 #include "include/types.h"
 #include "include/buffer_fwd.h"
 #include "KeyValueDB.h"
+#include "KeyValueHistogram.h"
+#include <array>
 #include <set>
 #include <map>
 #include <string>
 #include <memory>
+#include <tuple>
 #include <boost/scoped_ptr.hpp>
 #include "rocksdb/write_batch.h"
 #include "rocksdb/perf_context.h"
@@ -49,6 +52,8 @@ enum {
   l_rocksdb_write_memtable_time,
   l_rocksdb_write_delay_time,
   l_rocksdb_write_pre_and_post_process_time,
+  l_rocksdb_iter_pool_hit,
+  l_rocksdb_iter_pool_miss,
   l_rocksdb_last,
 };
 
@@ -136,6 +141,56 @@ private:
   typedef decltype(cf_handles)::iterator cf_handles_iterator;
   std::unordered_map<uint32_t, std::string> cf_ids_to_prefix;
   std::unordered_map<std::string, rocksdb::BlockBasedTableOptions> cf_bbt_opts;
+  /// column family name -> length of the key prefix fed to the bloom filter
+  std::map<std::string, size_t> prefix_blooms;
+
+  /// rocksdb iterators kept for reuse by CFIteratorImpl, keyed by cf and
+  /// by which iterate bounds they were created with
+  struct PooledIterator;
+  friend struct PooledIterator;
+  using iterator_pool_key_t =
+    std::tuple<rocksdb::ColumnFamilyHandle*, bool, bool>;
+  size_t iterator_pool_size = 0;
+  ceph::timespan iterator_pool_max_age;
+  mutable ceph::mutex iterator_pool_lock =
+    ceph::make_mutex("RocksDBStore::iterator_pool_lock");
+  mutable std::map<iterator_pool_key_t, std::vector<PooledIterator*>> iterator_pool;
+  PooledIterator* get_pooled_iterator(const std::string& prefix,
+				      rocksdb::ColumnFamilyHandle* cf,
+				      const IteratorBounds& bounds) const;
+  void put_pooled_iterator(PooledIterator* pi) const;
+  void _expire_pooled_iterators(ceph::mono_clock::time_point now,
+				std::vector<PooledIterator*>* expired) const;
+  void clear_iterator_pool();
+  // drops idle pooled iterators even when no new ones are asked for
+  ceph::condition_variable iterator_pool_cond;
+  bool iterator_pool_stop = false;
+  class IteratorPoolThread : public Thread {
+    RocksDBStore *db;
+  public:
+    explicit IteratorPoolThread(RocksDBStore *d) : db(d) {}
+    void *entry() override {
+      db->iterator_pool_thread_entry();
+      return NULL;
+    }
+  } iterator_pool_thread{this};
+  void iterator_pool_thread_entry();
+
+  /// per-prefix access accounting, see rocksdb_access_stats
+  bool access_stats_enabled = false;
+  /// accounting is spread over shards picked by thread, so that concurrent
+  /// readers do not serialize on one lock
+  struct access_stats_shard_t {
+    ceph::mutex lock = ceph::make_mutex("RocksDBStore::access_stats_shard");
+    KeyValueAccessStats stats;
+  };
+  static constexpr size_t ACCESS_STATS_SHARDS = 16;
+  mutable std::array<access_stats_shard_t, ACCESS_STATS_SHARDS> access_stats_shards;
+  ceph::mutex access_stats_lock =
+    ceph::make_mutex("RocksDBStore::access_stats_lock");  ///< guards since
+  utime_t access_stats_since;
+  access_stats_shard_t& get_access_stats_shard() const;
+  void account_reads(const std::string& prefix, uint64_t gets, uint64_t iterators);
   
   void add_column_family(const std::string& cf_name, uint32_t hash_l, uint32_t hash_h,
 			 size_t shard_idx, rocksdb::ColumnFamilyHandle *handle);
@@ -148,6 +203,7 @@ private:
 
   int submit_common(rocksdb::WriteOptions& woptions, KeyValueDB::Transaction t);
   int install_cf_mergeop(const std::string &cf_name, rocksdb::ColumnFamilyOptions *cf_opt);
+  void install_cf_prefix_bloom(const std::string &cf_name, rocksdb::ColumnFamilyOptions *cf_opt);
   int create_db_dir();
   int do_open(std::ostream &out, bool create_if_missing, bool open_readonly,
 	      const std::string& cfs="");
@@ -158,6 +214,34 @@ public:
 				std::vector<ColumnFamily>& sharding_def,
 				char const* *error_position = nullptr,
 				std::string *error_msg = nullptr);
+  /// inverse of parse_sharding_def
+  static std::string sharding_def_to_string(const std::vector<ColumnFamily>& sharding_def);
+
+  /// parameters of the leveled compaction model used to plan sharding
+  struct sharding_model_t {
+    uint64_t level_base = 256ull << 20;  ///< max_bytes_for_level_base
+    double level_multiplier = 10;        ///< max_bytes_for_level_multiplier
+    double hot_write_share = 0.1;        ///< share of written bytes that earns a prefix its own column
+    uint64_t shard_target_bytes = 1ull << 30; ///< live bytes per shard to aim for
+    size_t max_shards = 8;
+  };
+  /// expected bytes written to disk per byte written to a column family
+  static double estimate_write_amp(const sharding_model_t& model,
+				   uint64_t live_bytes,
+				   size_t shard_cnt,
+				   double churn);
+  /**
+   * Propose a sharding that isolates prefixes with a large share of the
+   * written bytes and splits oversized columns. Existing columns are kept,
+   * so that the result is always a valid target for reshard(). Per column
+   * write amplification before and after is dumped to f, if given.
+   */
+  static std::vector<ColumnFamily> plan_sharding(
+    const std::vector<ColumnFamily>& current,
+    const std::map<std::string, KeyValueAccessStats::prefix_stats_t>& stats,
+    const std::map<std::string, uint64_t>& live_bytes,
+    const sharding_model_t& model,
+    ceph::Formatter* f);
   const rocksdb::Comparator* get_comparator() const {
     return comparator;
   }
@@ -321,9 +405,12 @@ public:
   public:
     rocksdb::WriteBatch bat;
     RocksDBStore *db;
+    /// per-prefix writes of this transaction, if db->access_stats_enabled
+    std::unique_ptr<KeyValueAccessStats> stats;
 
     explicit RocksDBTransactionImpl(RocksDBStore *_db);
   private:
+    KeyValueAccessStats::prefix_stats_t* account(const std::string& prefix);
     void put_bat(
       rocksdb::WriteBatch& bat,
       rocksdb::ColumnFamilyHandle *cf,
@@ -364,6 +451,10 @@ public:
       const std::string &prefix,
       const std::string &start,
       const std::string &end) override;
+    void rm_range_keys_bulk(
+      const std::string &prefix,
+      const std::string &start,
+      const std::string &end) override;
     void merge(
       const std::string& prefix,
       const std::string& k,
@@ -403,6 +494,8 @@ public:
                                            const KeyValueDB::IteratorOpts opts)
       {
         rocksdb::ReadOptions options = rocksdb::ReadOptions();
+        // whole-space walks cross prefixes, ignore any prefix extractor
+        options.total_order_seek = true;
         if (opts & ITERATOR_NOCACHE)
           options.fill_cache=false;
         dbiter = db->db->NewIterator(options, cf);
@@ -465,6 +558,9 @@ public:
   int set_merge_operator(
     const std::string& prefix,
     std::shared_ptr<KeyValueDB::MergeOperator> mop) override;
+  int set_prefix_bloom(
+    const std::string& prefix,
+    size_t prefix_len) override;
   std::string assoc_name; ///< Name of associative operator
 
   uint64_t get_estimated_size(std::map<std::string,uint64_t> &extra) override {
@@ -590,6 +686,12 @@ public:
   };
   int reshard(const std::string& new_sharding, const resharding_ctrl* ctrl = nullptr);
   bool get_sharding(std::string& sharding);
+  /// dump access stats and a dry-run sharding plan; reset restarts accounting.
+  /// proposed_sharding is left empty if the current sharding should be kept.
+  int advise_sharding(ceph::Formatter* f, double hot_write_share, bool reset,
+		      std::string* proposed_sharding = nullptr);
+  /// access stats summed over all shards; reset restarts accounting
+  KeyValueAccessStats get_access_stats(bool reset, utime_t* since = nullptr);
   void util_divide_key_range(
     const std::string& prefix,        // Table to operate on.
     const std::string& starting_key,  // Included if exists.
@@ -546,9 +546,9 @@ void MDRequestImpl::_dump(Formatter *f, bool has_mds_lock) const
 
   {
     f->open_array_section("events");
-    for (auto& i : events) {
-      f->dump_object("event", i);
-    }
+    for_each_event([f](const utime_t& stamp, std::string_view event) {
+      f->dump_object("event", Event(stamp, event));
+    });
     f->close_section(); // events
   }
 
@@ -114,18 +114,21 @@ private:
   void _dump(ceph::Formatter *f) const override {
     {
       f->open_array_section("events");
-      std::lock_guard l(lock);
-    for (auto i = events.begin(); i != events.end(); ++i) {
+      std::vector<Event> evs;
+      for_each_event([&evs](const utime_t& stamp, std::string_view event) {
+        evs.emplace_back(stamp, event);
+      });
+    for (auto i = evs.begin(); i != evs.end(); ++i) {
       f->open_object_section("event");
       f->dump_string("event", i->str);
       f->dump_stream("time") << i->stamp;
 
       auto i_next = i + 1;
 
-      if (i_next < events.end()) {
+      if (i_next < evs.end()) {
 	f->dump_float("duration", i_next->stamp - i->stamp);
       } else {
-	f->dump_float("duration", events.rbegin()->stamp - get_initiated());
+	f->dump_float("duration", evs.rbegin()->stamp - get_initiated());
       }
 
       f->close_section();
@@ -861,6 +861,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     osdmap.encode(full_bl, f | CEPH_FEATURE_RESERVED);
     tx_size += full_bl.length();
 
+    bool reloaded = false;
     bufferlist orig_full_bl;
     get_version_full(osdmap.epoch, orig_full_bl);
     dout(20) << __func__ << " mon is running version: " << ceph_version_to_str() << dendl;
@@ -891,6 +892,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
 
 	osdmap = OSDMap();
 	osdmap.decode(orig_full_bl);
+	reloaded = true;
 
 	dout(20) << __func__ << " canonical full osdmap:\n";
 	JSONFormatter jf(true);
@@ -906,6 +908,13 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     }
     put_version_latest_full(t, osdmap.epoch);
 
+    // the pg mapping can catch up with just what the incremental changed,
+    // unless we had to fall back to the canonical full map.
+    if (!reloaded &&
+	g_conf().get_val<bool>("mon_osd_mapping_incremental")) {
+      mapping.note_incremental(inc);
+    }
+
     // share
     dout(1) << osdmap << dendl;
 
@@ -1092,7 +1101,12 @@ void OSDMonitor::start_mapping()
     mapping_job = mapping.start_update(osdmap, mapper,
 				       g_conf()->mon_osd_mapping_pgs_per_chunk);
     dout(10) << __func__ << " started mapping job " << mapping_job.get()
-	     << " at " << fin->start << dendl;
+	     << " at " << fin->start;
+    if (mapping_job->incremental) {
+      *_dout << ", remapping " << mapping_job->pools.size() << " pools and "
+	     << mapping_job->pgs.size() << " pgs since e" << mapping.get_epoch();
+    }
+    *_dout << dendl;
     mapping_job->set_finish_event(fin);
   } else {
     dout(10) << __func__ << " no pools, no mapping job" << dendl;
@@ -3092,7 +3106,7 @@ bool OSDMonitor::prepare_mark_me_down(MonOpRequestRef op)
   pending_inc.new_state[target_osd] = CEPH_OSD_UP;
   if (m->down_and_dead) {
     if (!pending_inc.new_xinfo.count(target_osd)) {
-      pending_inc.new_xinfo[target_osd] = osdmap.osd_xinfo[target_osd];
+      pending_inc.new_xinfo[target_osd] = osdmap.get_xinfo(target_osd);
     }
     pending_inc.new_xinfo[target_osd].dead_epoch = m->get_epoch();
   }
@@ -3141,7 +3155,7 @@ bool OSDMonitor::prepare_mark_me_dead(MonOpRequestRef op)
   mon.clog->info() << "osd." << target_osd << " marked itself dead as of e"
 		    << m->get_epoch();
   if (!pending_inc.new_xinfo.count(target_osd)) {
-    pending_inc.new_xinfo[target_osd] = osdmap.osd_xinfo[target_osd];
+    pending_inc.new_xinfo[target_osd] = osdmap.get_xinfo(target_osd);
   }
   pending_inc.new_xinfo[target_osd].dead_epoch = m->get_epoch();
   wait_for_commit(
@@ -3380,7 +3394,7 @@ void OSDMonitor::force_failure(int target_osd, int by)
   dout(1) << " we're forcing failure of osd." << target_osd << dendl;
   pending_inc.new_state[target_osd] = CEPH_OSD_UP;
   if (!pending_inc.new_xinfo.count(target_osd)) {
-    pending_inc.new_xinfo[target_osd] = osdmap.osd_xinfo[target_osd];
+    pending_inc.new_xinfo[target_osd] = osdmap.get_xinfo(target_osd);
   }
   pending_inc.new_xinfo[target_osd].dead_epoch = pending_inc.epoch;
 
@@ -3512,7 +3526,7 @@ bool OSDMonitor::grace_interval_threshold_exceeded(int last_failed_interval)
 void OSDMonitor::set_default_laggy_params(int target_osd)
 {
   if (pending_inc.new_xinfo.count(target_osd) == 0) {
-    pending_inc.new_xinfo[target_osd] = osdmap.osd_xinfo[target_osd];
+    pending_inc.new_xinfo[target_osd] = osdmap.get_xinfo(target_osd);
   }
   osd_xinfo_t& xi = pending_inc.new_xinfo[target_osd];
   xi.down_stamp = pending_inc.modified;
@@ -3756,7 +3770,7 @@ bool OSDMonitor::prepare_boot(MonOpRequestRef op)
     }
 
     if (pending_inc.new_xinfo.count(from) == 0)
-      pending_inc.new_xinfo[from] = osdmap.osd_xinfo[from];
+      pending_inc.new_xinfo[from] = osdmap.get_xinfo(from);
     osd_xinfo_t& xi = pending_inc.new_xinfo[from];
     if (m->boot_epoch == 0) {
       xi.laggy_probability *= (1.0 - g_conf()->mon_osd_laggy_weight);
@@ -4585,10 +4599,10 @@ bool OSDMonitor::prepare_beacon(MonOpRequestRef op)
     }
   }
 
-  if (osdmap.osd_xinfo[from].last_purged_snaps_scrub <
+  if (osdmap.get_xinfo(from).last_purged_snaps_scrub <
       beacon->last_purged_snaps_scrub) {
     if (pending_inc.new_xinfo.count(from) == 0) {
-      pending_inc.new_xinfo[from] = osdmap.osd_xinfo[from];
+      pending_inc.new_xinfo[from] = osdmap.get_xinfo(from);
     }
     pending_inc.new_xinfo[from].last_purged_snaps_scrub =
       beacon->last_purged_snaps_scrub;
@@ -5382,7 +5396,7 @@ void OSDMonitor::tick()
 
 	  // remember previous weight
 	  if (pending_inc.new_xinfo.count(o) == 0)
-	    pending_inc.new_xinfo[o] = osdmap.osd_xinfo[o];
+	    pending_inc.new_xinfo[o] = osdmap.get_xinfo(o);
 	  pending_inc.new_xinfo[o].old_weight = osdmap.osd_weight[o];
 
 	  do_propose = true;
@@ -12586,7 +12600,7 @@ bool OSDMonitor::prepare_command_impl(MonOpRequestRef op,
 	  }
 	  if (definitely_dead) {
 	    if (!pending_inc.new_xinfo.count(osd)) {
-	      pending_inc.new_xinfo[osd] = osdmap.osd_xinfo[osd];
+	      pending_inc.new_xinfo[osd] = osdmap.get_xinfo(osd);
 	    }
 	    if (pending_inc.new_xinfo[osd].dead_epoch < pending_inc.epoch) {
 	      any = true;
@@ -12601,7 +12615,7 @@ bool OSDMonitor::prepare_command_impl(MonOpRequestRef op,
 	    pending_inc.new_weight[osd] = CEPH_OSD_OUT;
 	    if (osdmap.osd_weight[osd]) {
 	      if (pending_inc.new_xinfo.count(osd) == 0) {
-	        pending_inc.new_xinfo[osd] = osdmap.osd_xinfo[osd];
+	        pending_inc.new_xinfo[osd] = osdmap.get_xinfo(osd);
 	      }
 	      pending_inc.new_xinfo[osd].old_weight = osdmap.osd_weight[osd];
 	    }
@@ -12625,10 +12639,10 @@ bool OSDMonitor::prepare_command_impl(MonOpRequestRef op,
             if (verbose)
 	      ss << "osd." << osd << " is already in. ";
 	  } else {
-	    if (osdmap.osd_xinfo[osd].old_weight > 0) {
-	      pending_inc.new_weight[osd] = osdmap.osd_xinfo[osd].old_weight;
+	    if (osdmap.get_xinfo(osd).old_weight > 0) {
+	      pending_inc.new_weight[osd] = osdmap.get_xinfo(osd).old_weight;
 	      if (pending_inc.new_xinfo.count(osd) == 0) {
-	        pending_inc.new_xinfo[osd] = osdmap.osd_xinfo[osd];
+	        pending_inc.new_xinfo[osd] = osdmap.get_xinfo(osd);
 	      }
 	      pending_inc.new_xinfo[osd].old_weight = 0;
 	    } else {
@@ -15573,7 +15587,7 @@ int OSDMonitor::_prepare_remove_pool(
     }
   }
   // remove any pg_upmap mappings for this pool
-  for (auto& p : osdmap.pg_upmap) {
+  for (auto& p : *osdmap.pg_upmap) {
     if (p.first.pool() == pool) {
       dout(10) << __func__ << " " << pool
                << " removing obsolete pg_upmap "
@@ -15596,7 +15610,7 @@ int OSDMonitor::_prepare_remove_pool(
     }
   }
   // remove any pg_upmap_items mappings for this pool
-  for (auto& p : osdmap.pg_upmap_items) {
+  for (auto& p : *osdmap.pg_upmap_items) {
     if (p.first.pool() == pool) {
       dout(10) << __func__ << " " << pool
                << " removing obsolete pg_upmap_items " << p.first
@@ -15619,7 +15633,7 @@ int OSDMonitor::_prepare_remove_pool(
     }
   }
   // remove any old pg_upmap_primary mapping for this pool
-  for (auto& p : osdmap.pg_upmap_primaries) {
+  for (auto& p : *osdmap.pg_upmap_primaries) {
     if (p.first.pool() == pool) {
       dout(10) << __func__ << " " << pool
                << " removing obsolete pg_upmap_primaries " << p.first
@@ -15629,7 +15643,7 @@ int OSDMonitor::_prepare_remove_pool(
   }
 
   // remove any pending pg_upmap_primary mapping for this pool
-  for (auto& p : osdmap.pg_upmap_primaries) {
+  for (auto& p : *osdmap.pg_upmap_primaries) {
     if (p.first.pool() == pool) {
       dout(10) << __func__ << " " << pool
                << " removing pending pg_upmap_primaries " << p.first
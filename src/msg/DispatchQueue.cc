@@ -76,6 +76,18 @@ void DispatchQueue::fast_dispatch(const ref_t<Message>& m)
   post_dispatch(m, msize);
 }
 
+void DispatchQueue::fast_dispatch_batch(const std::vector<ref_t<Message>>& ms)
+{
+  uint64_t msize = 0;
+  for (const auto& m : ms) {
+    msize += pre_dispatch(m);
+  }
+  msgr->ms_fast_dispatch_batch(ms);
+  dispatch_throttle_release(msize);
+  ldout(cct,20) << "done calling dispatch on " << ms.size() << " messages"
+		<< dendl;
+}
+
 void DispatchQueue::fast_preprocess(const ref_t<Message>& m)
 {
   msgr->ms_fast_preprocess(m);
@@ -203,6 +203,7 @@ class DispatchQueue {
   void fast_dispatch(Message* m) {
     return fast_dispatch(ceph::ref_t<Message>(m, false)); /* consume ref */
   }
+  void fast_dispatch_batch(const std::vector<ceph::ref_t<Message>>& ms);
   void fast_preprocess(const ceph::ref_t<Message>& m);
   void enqueue(const ceph::ref_t<Message>& m, int priority, uint64_t id);
   void enqueue(Message* m, int priority, uint64_t id) {
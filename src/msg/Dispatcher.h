@@ -24,6 +24,7 @@
 #include "msg/MessageRef.h"
 
 #include <variant>
+#include <vector>
 
 class Messenger;
 class Connection;
@@ -93,6 +94,22 @@ public:
     return ms_fast_dispatch(MessageRef(m).detach()); /* XXX N.B. always consumes ref */
   }
 
+  /**
+   * Fast dispatch several Messages which were received back to back on
+   * one Connection, in receipt order. Dispatchers which can share some
+   * per-message cost (such as waking up their worker threads) across
+   * the batch may override this; see ms_can_fast_dispatch() for the
+   * requirements.
+   *
+   * @param ms The Messages to fast dispatch, all of which this
+   * Dispatcher can fast dispatch.
+   */
+  virtual void ms_fast_dispatch_batch(const std::vector<MessageRef>& ms) {
+    for (const auto& m : ms) {
+      ms_fast_dispatch2(m);
+    }
+  }
+
   /**
    * Let the Dispatcher preview a Message before it is dispatched. This
    * function is called on *every* Message, prior to the fast/regular dispatch
@@ -733,6 +733,41 @@ public:
   void ms_fast_dispatch(Message *m) {
     return ms_fast_dispatch(ceph::ref_t<Message>(m, false)); /* consume ref */
   }
+  /**
+   * Deliver Messages received back to back on a Connection via "fast
+   * dispatch". Consecutive Messages handled by the same Dispatcher are
+   * handed to it together, see Dispatcher::ms_fast_dispatch_batch().
+   *
+   * @param ms The Messages we are fast dispatching, in receipt order.
+   * If none of our Dispatchers can handle one of them, ceph_abort().
+   */
+  void ms_fast_dispatch_batch(const std::vector<ceph::ref_t<Message>>& ms) {
+    const utime_t now = ceph_clock_now();
+    std::vector<ceph::ref_t<Message>> run;
+    Dispatcher *run_dispatcher = nullptr;
+    for (const auto& m : ms) {
+      m->set_dispatch_stamp(now);
+      Dispatcher *d = nullptr;
+      for ([[maybe_unused]] const auto& [priority, dispatcher] : fast_dispatchers) {
+        if (dispatcher->ms_can_fast_dispatch2(m)) {
+          d = dispatcher;
+          break;
+        }
+      }
+      if (!d) {
+        ceph_abort();
+      }
+      if (d != run_dispatcher && !run.empty()) {
+        run_dispatcher->ms_fast_dispatch_batch(run);
+        run.clear();
+      }
+      run_dispatcher = d;
+      run.push_back(m);
+    }
+    if (!run.empty()) {
+      run_dispatcher->ms_fast_dispatch_batch(run);
+    }
+  }
   /**
    *
    */
@@ -133,6 +133,8 @@ AsyncConnection::AsyncConnection(CephContext *cct, AsyncMessenger *m, DispatchQu
     last_active(ceph::coarse_mono_clock::now()),
     connect_timeout_us(cct->_conf->ms_connection_ready_timeout*1000*1000),
     inactive_timeout_us(cct->_conf->ms_connection_idle_timeout*1000*1000),
+    fast_dispatch_batch_max(std::max<uint64_t>(
+      cct->_conf.get_val<uint64_t>("ms_fast_dispatch_batch"), 1)),
     msgr2(m2), state_offset(0),
     worker(w), center(&w->center),read_buffer(nullptr)
 {
@@ -308,6 +310,9 @@ ssize_t AsyncConnection::read_bulk(char *buf, unsigned len)
                               << cs.fd() << dendl;
     return -1;
   }
+  io_bytes.store(io_bytes.load(std::memory_order_relaxed) + nread,
+                 std::memory_order_relaxed);
+  worker->io_bytes += nread;
   return nread;
 }
 
@@ -341,6 +346,7 @@ ssize_t AsyncConnection::_try_send(bool more)
   // network block would make ::send return EAGAIN, that would make here looks
   // like do not call cs.send() and r = 0
   ssize_t r = 0;
+  const uint64_t queued = outgoing_bl.length();
   if (likely(!inject_network_congestion())) {
     r = cs.send(outgoing_bl, more);
   }
@@ -348,6 +354,11 @@ ssize_t AsyncConnection::_try_send(bool more)
     ldout(async_msgr->cct, 1) << __func__ << " send error: " << cpp_strerror(r) << dendl;
     return r;
   }
+  if (const uint64_t sent = queued - outgoing_bl.length(); sent > 0) {
+    io_bytes.store(io_bytes.load(std::memory_order_relaxed) + sent,
+                   std::memory_order_relaxed);
+    worker->io_bytes += sent;
+  }
 
   ldout(async_msgr->cct, 10) << __func__ << " sent bytes " << r
                              << " remaining bytes " << outgoing_bl.length() << dendl;
@@ -368,6 +379,24 @@ ssize_t AsyncConnection::_try_send(bool more)
   return outgoing_bl.length();
 }
 
+// Hand the messages read so far to the dispatchers in one go. Called
+// without `lock`, in the connection's thread.
+void AsyncConnection::fast_dispatch_pending()
+{
+  if (pending_fast_dispatch.empty()) {
+    return;
+  }
+  const auto start = ceph::mono_clock::now();
+  if (pending_fast_dispatch.size() == 1) {
+    dispatch_queue->fast_dispatch(pending_fast_dispatch.front());
+  } else {
+    dispatch_queue->fast_dispatch_batch(pending_fast_dispatch);
+  }
+  pending_fast_dispatch.clear();
+  recv_start_time = ceph::mono_clock::now();
+  logger->tinc(l_msgr_running_fast_dispatch_time, recv_start_time - start);
+}
+
 void AsyncConnection::inject_delay() {
   if (async_msgr->cct->_conf->ms_inject_internal_delays) {
     ldout(async_msgr->cct, 10) << __func__ << " sleep for " <<
@@ -383,8 +412,39 @@ bool AsyncConnection::inject_network_congestion() const {
 	  rand() % async_msgr->cct->_conf->ms_inject_network_congestion != 0);
 }
 
+// Queue a reset behind the messages read so far. Called with `lock` held,
+// which is dropped while dispatching them.
+void AsyncConnection::queue_reset_locked()
+{
+  if (!center->in_thread()) {
+    // a process() round may still be dispatching what it read, queue the
+    // reset from our thread once that round is over
+    center->submit_to(center->get_id(), [conn = AsyncConnectionRef(this)] {
+      conn->dispatch_queue->queue_reset(conn.get());
+    }, true);
+    return;
+  }
+  if (!pending_fast_dispatch.empty()) {
+    lock.unlock();
+    fast_dispatch_pending();
+    lock.lock();
+  }
+  dispatch_queue->queue_reset(this);
+}
+
 void AsyncConnection::process() {
-  std::lock_guard<std::mutex> l(lock);
+  {
+    std::lock_guard<std::mutex> l(lock);
+    _process();
+  }
+  // whatever is left of what this round read
+  fast_dispatch_pending();
+}
+
+void AsyncConnection::_process() {
+  if (forward_if_migrated(read_handler)) {
+    return;
+  }
   last_active = ceph::coarse_mono_clock::now();
   recv_start_time = ceph::mono_clock::now();
 
@@ -737,11 +797,20 @@ void AsyncConnection::mark_down()
 void AsyncConnection::handle_write()
 {
   ldout(async_msgr->cct, 10) << __func__ << dendl;
+  {
+    std::lock_guard<std::mutex> l(lock);
+    if (forward_if_migrated(write_handler)) {
+      return;
+    }
+  }
   protocol->write_event();
 }
 
 void AsyncConnection::handle_write_callback() {
   std::lock_guard<std::mutex> l(lock);
+  if (forward_if_migrated(write_callback_handler)) {
+    return;
+  }
   last_active = ceph::coarse_mono_clock::now();
   recv_start_time = ceph::mono_clock::now();
   write_lock.lock();
@@ -775,6 +844,94 @@ void AsyncConnection::cleanup() {
   }
 }
 
+void AsyncConnection::migrate(Worker *new_worker)
+{
+  std::lock_guard<std::mutex> l(lock);
+  if (worker == new_worker || state != STATE_CONNECTION_ESTABLISHED) {
+    return;
+  }
+  ldout(async_msgr->cct, 10) << __func__ << " to worker " << new_worker->id
+                             << dendl;
+  // file and time events may only be touched in their center's thread
+  center->submit_to(center->get_id(),
+                    [conn = AsyncConnectionRef(this), new_worker] {
+                      conn->_migrate(new_worker);
+                    }, true);
+}
+
+void AsyncConnection::_migrate(Worker *new_worker)
+{
+  std::lock_guard<std::mutex> l(lock);
+  std::lock_guard<std::mutex> wl(write_lock);
+  // the connection may have moved, faulted or started waiting on a
+  // (backoff, throttle or delay) timer since it was asked to move
+  if (!center->in_thread() || worker == new_worker ||
+      state != STATE_CONNECTION_ESTABLISHED || !protocol->is_connected() ||
+      !cs || !register_time_events.empty() || delay_state) {
+    ldout(async_msgr->cct, 10) << __func__ << " not moving to worker "
+                               << new_worker->id << dendl;
+    return;
+  }
+  ldout(async_msgr->cct, 5) << __func__ << " from worker " << worker->id
+                            << " to worker " << new_worker->id << dendl;
+
+  center->delete_file_event(cs.fd(), EVENT_READABLE | EVENT_WRITABLE);
+  if (last_tick_id) {
+    center->delete_time_event(last_tick_id);
+    last_tick_id = 0;
+  }
+  logger->dec(l_msgr_active_connections);
+  logger->inc(l_msgr_connections_moved_out);
+  worker->references--;
+  new_worker->references++;
+  worker = new_worker;
+  center = &new_worker->center;
+  logger = new_worker->get_perf_counter();
+  labeled_logger = new_worker->get_labeled_perf_counter();
+  cs.set_worker(new_worker);
+  logger->inc(l_msgr_active_connections);
+  logger->inc(l_msgr_connections_moved_in);
+
+  // events still queued in the old center are passed on to the new one,
+  // see forward_if_migrated()
+  center->submit_to(center->get_id(), [conn = AsyncConnectionRef(this)] {
+    conn->_migrated();
+  }, true);
+}
+
+void AsyncConnection::_migrated()
+{
+  std::lock_guard<std::mutex> l(lock);
+  if (!center->in_thread() || state != STATE_CONNECTION_ESTABLISHED || !cs) {
+    // moved on again, or faulted in the meantime
+    return;
+  }
+  ldout(async_msgr->cct, 10) << __func__ << dendl;
+  center->create_file_event(cs.fd(), EVENT_READABLE, read_handler);
+  if (open_write) {
+    center->create_file_event(cs.fd(), EVENT_WRITABLE, write_handler);
+  }
+  if (!last_tick_id) {
+    last_tick_id = center->create_time_event(inactive_timeout_us,
+                                             tick_handler);
+  }
+  // nobody polled the socket while it was on its way
+  center->dispatch_event_external(read_handler);
+}
+
+// must hold `lock`
+bool AsyncConnection::forward_if_migrated(EventCallbackRef e)
+{
+  if (center->in_thread()) {
+    return false;
+  }
+  // queued in the center of the worker we were moved away from
+  ldout(async_msgr->cct, 20) << __func__ << " to worker " << worker->id
+                             << dendl;
+  center->dispatch_event_external(e);
+  return true;
+}
+
 void AsyncConnection::wakeup_from(uint64_t id)
 {
   lock.lock();
@@ -875,5 +1032,6 @@ void AsyncConnection::dump(Formatter *f, bool tcp_info) {
   }
   f->close_section();  // protocol
   f->dump_int("worker_id", worker ? worker->id : -1);
+  f->dump_unsigned("io_bytes", io_bytes.load(std::memory_order_relaxed));
   f->close_section();  // async_connection
 }
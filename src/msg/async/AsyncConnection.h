@@ -150,6 +150,29 @@ public:
     unregistered = true;
   }
 
+  /**
+   * Move an established connection to another worker
+   *
+   * The socket's events are handed over asynchronously, in the thread of
+   * the current worker. Connections which aren't established (or are
+   * waiting on a timer) at that point are left alone.
+   */
+  void migrate(Worker *new_worker);
+  Worker *get_worker() {
+    std::lock_guard<std::mutex> l(lock);
+    return worker;
+  }
+  uint64_t get_io_bytes() const {
+    return io_bytes.load(std::memory_order_relaxed);
+  }
+  /// bytes read or written since the previous call, see "rebalance"
+  uint64_t take_io_bytes() {
+    uint64_t bytes = io_bytes.load(std::memory_order_relaxed);
+    uint64_t delta = bytes - io_bytes_taken;
+    io_bytes_taken = bytes;
+    return delta;
+  }
+
  private:
   enum {
     STATE_NONE,
@@ -205,8 +228,15 @@ private:
   ceph::coarse_mono_clock::time_point last_active;
   ceph::mono_clock::time_point recv_start_time;
   uint64_t last_tick_id = 0;
+  // only updated in the worker's thread, but read by AsyncMessenger
+  std::atomic<uint64_t> io_bytes = {0};
+  uint64_t io_bytes_taken = 0;  ///< only used by AsyncMessenger::rebalance()
   const uint64_t connect_timeout_us;
   const uint64_t inactive_timeout_us;
+  // fast dispatchable messages read by the current process() call, see
+  // fast_dispatch_pending(). only used in own thread
+  std::vector<ceph::ref_t<Message>> pending_fast_dispatch;
+  const unsigned fast_dispatch_batch_max;
 
   // Tis section are temp variables used by state transition
 
@@ -234,10 +264,16 @@ private:
   void handle_write();
   void handle_write_callback();
   void process();
+  void _process();
+  void fast_dispatch_pending();
+  void queue_reset_locked();
   void wakeup_from(uint64_t id);
   void tick(uint64_t id);
   void stop(bool queue_reset);
   void cleanup();
+  void _migrate(Worker *new_worker);
+  void _migrated();
+  bool forward_if_migrated(EventCallbackRef e);
   PerfCounters *get_perf_counter() {
     return logger;
   }
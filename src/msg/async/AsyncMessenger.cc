@@ -281,6 +281,16 @@ class C_handle_reap : public EventCallback {
   }
 };
 
+class C_handle_rebalance : public EventCallback {
+  AsyncMessenger *msgr;
+
+  public:
+  explicit C_handle_rebalance(AsyncMessenger *m): msgr(m) {}
+  void do_request(uint64_t id) override {
+    msgr->rebalance();
+  }
+};
+
 /*******************
  * Admin Socket Hook
  */
@@ -325,19 +335,39 @@ int AsyncMessengerSocketHook::call(
         return -ENOENT;
       }
     } else {
-      f->open_object_section("status");
-      f->open_array_section("messengers");
-      for (const auto& [name, _] : m_msgrs) {
+      dump_messengers(f);
+      return 0;
+    }
+  } else if (command == "messenger workers") {
+    std::string name;
+    if (common::cmd_getval(cmdmap, "msgr", name)) {
+      if (auto it = m_msgrs.find(name); it != m_msgrs.end()) {
+        f->open_object_section("status");
         f->dump_string("name", name);
+        it->second->dump_workers(f);
+        f->close_section();  // status
+        return 0;
+      } else {
+        return -ENOENT;
       }
-      f->close_section();
-      f->close_section();
+    } else {
+      dump_messengers(f);
       return 0;
     }
   }
   return -ENOSYS;
 }
 
+void AsyncMessengerSocketHook::dump_messengers(Formatter* f) const {
+  f->open_object_section("status");
+  f->open_array_section("messengers");
+  for (const auto& [name, _] : m_msgrs) {
+    f->dump_string("name", name);
+  }
+  f->close_section();
+  f->close_section();
+}
+
 bool AsyncMessengerSocketHook::add_messenger(
     const std::string& name, AsyncMessenger& msgr) {
   const auto result = m_msgrs.try_emplace(name, &msgr);
@@ -388,6 +418,7 @@ AsyncMessenger::AsyncMessenger(CephContext *cct, entity_name_t name,
 					 local_worker, true, true);
   init_local_connection();
   reap_handler = new C_handle_reap(this);
+  rebalance_handler = new C_handle_rebalance(this);
   unsigned processor_num = 1;
   if (stack->support_local_listen_table())
     processor_num = stack->get_num_worker();
@@ -404,6 +435,14 @@ AsyncMessenger::AsyncMessenger(CephContext *cct, entity_name_t name,
                         << AsyncMessengerSocketHook::COMMAND << "\" failed with"
                         << asok_ret << dendl;
         }
+        const int workers_ret = cct->get_admin_socket()->register_command(
+            AsyncMessengerSocketHook::WORKERS_COMMAND, hook,
+            "dump messenger worker load and connection placement");
+        if (workers_ret != 0) {
+          ldout(cct, 0) << __func__ << " messenger asok command \""
+                        << AsyncMessengerSocketHook::WORKERS_COMMAND
+                        << "\" failed with" << workers_ret << dendl;
+        }
         return hook;
       },
       [&](AdminSocketHook* ptr) {
@@ -456,6 +495,7 @@ AsyncMessenger::~AsyncMessenger()
 	}
       });
   delete reap_handler;
+  delete rebalance_handler;
   ceph_assert(!did_bind); // either we didn't bind or we shut down the Processor
   for (auto &&p : processors)
     delete p;
@@ -478,12 +518,29 @@ void AsyncMessenger::ready()
   for (auto &&p : processors)
     p->start();
   dispatch_queue.start();
+
+  const auto rebalance_interval =
+    cct->_conf.get_val<double>("ms_async_rebalance_interval");
+  if (rebalance_interval > 0 && stack->get_num_worker() > 1 &&
+      stack->support_connection_migration()) {
+    local_worker->center.submit_to(
+      local_worker->center.get_id(), [this, rebalance_interval] {
+        rebalance_timer_id = local_worker->center.create_time_event(
+          rebalance_interval * 1000000, rebalance_handler);
+      }, true);
+  }
 }
 
 int AsyncMessenger::shutdown()
 {
   ldout(cct,10) << __func__ << " " << get_myaddrs() << dendl;
 
+  local_worker->center.submit_to(local_worker->center.get_id(), [this] {
+    if (rebalance_timer_id) {
+      local_worker->center.delete_time_event(rebalance_timer_id);
+      rebalance_timer_id = 0;
+    }
+  }, false);
   stack->drain();
   // done!  clean up.
   for (auto &&p : processors)
@@ -579,6 +636,67 @@ void AsyncMessenger::dump(
   }
 }
 
+std::vector<AsyncConnectionRef>
+AsyncMessenger::get_all_conns(bool accepting) const
+{
+  // AsyncConnection::lock must not be taken under our lock, the protocols
+  // call back into us with it held
+  std::vector<AsyncConnectionRef> all;
+  std::lock_guard l{lock};
+  all.reserve(conns.size() + anon_conns.size() +
+              (accepting ? accepting_conns.size() : 0));
+  for (const auto& [e, c] : conns) {
+    all.push_back(c);
+  }
+  all.insert(all.end(), anon_conns.begin(), anon_conns.end());
+  if (accepting) {
+    all.insert(all.end(), accepting_conns.begin(), accepting_conns.end());
+  }
+  return all;
+}
+
+void AsyncMessenger::dump_workers(Formatter* f) const
+{
+  std::map<const Worker*, std::vector<AsyncConnectionRef>> placement;
+  for (const auto& c : get_all_conns(true)) {
+    placement[c->get_worker()].push_back(c);
+  }
+
+  f->dump_float("rebalance_interval",
+                cct->_conf.get_val<double>("ms_async_rebalance_interval"));
+  f->open_array_section("workers");
+  for (unsigned i = 0; i < stack->get_num_worker(); ++i) {
+    const Worker* w = stack->get_worker(i);
+    const PerfCounters* logger = w->perf_logger;
+    f->open_object_section("worker");
+    f->dump_unsigned("id", w->id);
+    f->dump_unsigned("references", w->references);
+    f->dump_float("busy_seconds",
+                  logger->tget(l_msgr_running_total_time));
+    f->dump_unsigned("events", logger->get(l_msgr_running_events));
+    f->dump_unsigned("io_bytes", w->io_bytes);
+    f->dump_unsigned("connections_moved_in",
+                     logger->get(l_msgr_connections_moved_in));
+    f->dump_unsigned("connections_moved_out",
+                     logger->get(l_msgr_connections_moved_out));
+    f->open_array_section("connections");
+    if (auto p = placement.find(w); p != placement.end()) {
+      for (const auto& c : p->second) {
+        f->open_object_section("connection");
+        f->dump_object("peer_addrs", c->get_peer_addrs());
+        f->dump_string("peer_type",
+                       ceph_entity_type_name(c->get_peer_type()));
+        f->dump_int("peer_id", c->get_peer_id());
+        f->dump_unsigned("io_bytes", c->get_io_bytes());
+        f->close_section();  // connection
+      }
+    }
+    f->close_section();  // connections
+    f->close_section();  // worker
+  }
+  f->close_section();  // workers
+}
+
 int AsyncMessenger::bind(const entity_addr_t &bind_addr,
                          std::optional<entity_addrvec_t> public_addrs)
 {
@@ -1216,3 +1334,80 @@ void AsyncMessenger::reap_dead()
     deleted_conns.clear();
   }
 }
+
+void AsyncMessenger::rebalance()
+{
+  ceph_assert(local_worker->center.in_thread());
+  rebalance_timer_id = 0;
+
+  const unsigned num_workers = stack->get_num_worker();
+  std::vector<worker_load_t> loads(num_workers);
+  for (unsigned i = 0; i < num_workers; ++i) {
+    const Worker* w = stack->get_worker(i);
+    loads[i].busy = w->perf_logger->tget(l_msgr_running_total_time);
+    loads[i].io_bytes = w->io_bytes;
+  }
+  if (worker_loads.size() != num_workers) {
+    // first round, nothing to compare with yet
+    worker_loads.swap(loads);
+  } else {
+    // what happened since the previous round
+    std::vector<worker_load_t> deltas(num_workers);
+    unsigned busiest = 0;
+    unsigned idlest = 0;
+    for (unsigned i = 0; i < num_workers; ++i) {
+      deltas[i].busy = loads[i].busy - worker_loads[i].busy;
+      deltas[i].io_bytes = loads[i].io_bytes - worker_loads[i].io_bytes;
+      if (deltas[i].busy > deltas[busiest].busy) {
+        busiest = i;
+      }
+      if (deltas[i].busy < deltas[idlest].busy) {
+        idlest = i;
+      }
+    }
+    worker_loads.swap(loads);
+
+    const auto& from = deltas[busiest];
+    const auto& to = deltas[idlest];
+    const double min_imbalance =
+      cct->_conf.get_val<double>("ms_async_rebalance_interval") *
+      cct->_conf.get_val<double>("ms_async_rebalance_min_imbalance");
+    const bool imbalanced =
+      from.busy - to.busy > min_imbalance && from.io_bytes > 0;
+    const Worker* from_worker = stack->get_worker(busiest);
+
+    // estimate how much of the busiest worker's time a connection takes
+    // by its share of the bytes the worker moved, and pick the one which
+    // lowers the busiest of the two workers the most.
+    AsyncConnectionRef best;
+    double best_busy = from.busy;
+    auto consider = [&](const AsyncConnectionRef& c) {
+      // always taken so that the next round sees this round's bytes only
+      const uint64_t bytes = c->take_io_bytes();
+      if (!imbalanced || !bytes || c->get_worker() != from_worker) {
+        return;
+      }
+      const double busy =
+        from.busy * std::min(bytes, from.io_bytes) / from.io_bytes;
+      const double after = std::max(from.busy - busy, to.busy + busy);
+      if (after < best_busy) {
+        best = c;
+        best_busy = after;
+      }
+    };
+    for (const auto& c : get_all_conns(false)) {
+      consider(c);
+    }
+    if (best) {
+      ldout(cct, 5) << __func__ << " worker " << busiest << " busy "
+                    << from.busy << "s, worker " << idlest << " busy "
+                    << to.busy << "s, moving " << best << " "
+                    << best->get_peer_addrs() << dendl;
+      best->migrate(stack->get_worker(idlest));
+    }
+  }
+
+  rebalance_timer_id = local_worker->center.create_time_event(
+    cct->_conf.get_val<double>("ms_async_rebalance_interval") * 1000000,
+    rebalance_handler);
+}
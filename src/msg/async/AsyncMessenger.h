@@ -69,6 +69,8 @@ class Processor {
 class AsyncMessengerSocketHook : public AdminSocketHook {
   std::map<std::string, AsyncMessenger*> m_msgrs;
 
+  void dump_messengers(Formatter* f) const;
+
  public:
   static constexpr std::string_view COMMAND =
       "messenger dump "
@@ -77,6 +79,9 @@ class AsyncMessengerSocketHook : public AdminSocketHook {
       "strings=all|listen_sockets|connections|anon_conns|accepting_conns|deleted_conns,"
       "n=N,req=false "
       "name=tcp_info,type=CephBool,req=false";
+  static constexpr std::string_view WORKERS_COMMAND =
+      "messenger workers "
+      "name=msgr,type=CephString,req=false";
   AsyncMessengerSocketHook(AsyncMessenger& m, const std::string& name);
   int call(
       std::string_view command, const cmdmap_t& cmdmap, const bufferlist&,
@@ -165,6 +170,8 @@ public:
   void dump(
       Formatter* f, std::function<bool(const std::string&)> filter =
       [](const std::string&) { return true; }) const override;
+  /// dump the load of each worker and which connections it runs
+  void dump_workers(Formatter* f) const;
 
   /** @} // Startup/Shutdown */
 
@@ -329,6 +336,15 @@ private:
 
   EventCallbackRef reap_handler;
 
+  /// worker load as of the previous rebalance round
+  struct worker_load_t {
+    double busy = 0;  ///< seconds spent processing events
+    uint64_t io_bytes = 0;
+  };
+  std::vector<worker_load_t> worker_loads;
+  EventCallbackRef rebalance_handler;
+  uint64_t rebalance_timer_id = 0;  ///< only used in local_worker's thread
+
   /// internal cluster protocol version, if any, for talking to entities of the same type.
   int cluster_protocol = 0;
 
@@ -448,6 +464,21 @@ public:
    */
   void reap_dead();
 
+  /**
+   * Move one connection off the busiest worker if it was busier than
+   * the least busy worker by ms_async_rebalance_min_imbalance. Runs in
+   * local_worker's thread every ms_async_rebalance_interval.
+   *
+   * See "worker_loads"
+   */
+  void rebalance();
+
+  /**
+   * Snapshot of the registered connections, and of the ones being
+   * accepted if @p accepting, taken under `lock`
+   */
+  std::vector<AsyncConnectionRef> get_all_conns(bool accepting) const;
+
   /**
    * @} // AsyncMessenger Internals
    */
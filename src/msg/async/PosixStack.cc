@@ -21,7 +21,13 @@
 #include <arpa/inet.h>
 #include <errno.h>
 
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#include <linux/errqueue.h>
+#define HAVE_MSG_ZEROCOPY
+#endif
+
 #include <algorithm>
+#include <deque>
 
 #include "PosixStack.h"
 
@@ -30,6 +36,7 @@
 #include "common/errno.h"
 #include "common/strtol.h"
 #include "common/dout.h"
+#include "common/perf_counters.h"
 #include "msg/Messenger.h"
 #include "include/compat.h"
 #include "include/sock_compat.h"
@@ -44,10 +51,97 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   entity_addr_t sa;
   bool connected;
 
+#ifdef HAVE_MSG_ZEROCOPY
+  // The kernel numbers the sendmsg() calls made with MSG_ZEROCOPY and
+  // reports ranges of them as complete on the socket error queue; until
+  // then it may still read from our buffers, so we keep them referenced.
+  struct ZeroCopySend {
+    uint32_t first_seq;
+    uint32_t calls;
+    uint32_t pending;   ///< calls not reported complete yet
+    ceph::buffer::list bl;
+  };
+  CephContext *cct;
+  PerfCounters *logger;
+  uint64_t zc_min_bytes = 0;   ///< 0 if zero-copy sends are disabled
+  uint64_t zc_max_pinned = 0;
+  uint32_t zc_next_seq = 0;
+  uint64_t zc_pinned_bytes = 0;
+  std::deque<ZeroCopySend> zc_sends;
+
+  void complete_zerocopy(uint32_t lo, uint32_t hi) {
+    int64_t n = static_cast<int64_t>(hi - lo) + 1;
+    for (auto& zs : zc_sends) {
+      int64_t start = static_cast<int32_t>(zs.first_seq - lo);
+      int64_t overlap = std::min<int64_t>(start + zs.calls, n) -
+	std::max<int64_t>(start, 0);
+      if (overlap > 0) {
+	ceph_assert(overlap <= zs.pending);
+	zs.pending -= overlap;
+      }
+    }
+  }
+
+  void reap_zerocopy() {
+    while (true) {
+      char control[CMSG_SPACE(sizeof(struct sock_extended_err)) +
+		   CMSG_SPACE(sizeof(struct sockaddr_in6))];
+      struct msghdr msg = {};
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      if (::recvmsg(_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+	break;  // nothing (more) to reap
+      }
+      for (auto cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+	if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+	    !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+	  continue;
+	}
+	auto serr = reinterpret_cast<const struct sock_extended_err*>(
+	  CMSG_DATA(cm));
+	if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+	  continue;
+	}
+	if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+	  // e.g. loopback, or a device that cannot gather: copying up
+	  // front is cheaper than pinning
+	  if (zc_min_bytes) {
+	    ldout(cct, 10) << __func__ << " kernel copied zero-copy send to "
+			   << sa << ", disabling" << dendl;
+	    zc_min_bytes = 0;
+	  }
+	  logger->inc(l_msgr_send_zerocopy_copied);
+	}
+	complete_zerocopy(serr->ee_info, serr->ee_data);
+      }
+    }
+    while (!zc_sends.empty() && zc_sends.front().pending == 0) {
+      zc_pinned_bytes -= zc_sends.front().bl.length();
+      zc_sends.pop_front();
+    }
+  }
+#endif
+
  public:
   explicit PosixConnectedSocketImpl(ceph::NetHandler &h, const entity_addr_t &sa,
-				    int f, bool connected)
-      : handler(h), _fd(f), sa(sa), connected(connected) {}
+				    int f, bool connected, Worker *w)
+      : handler(h), _fd(f), sa(sa), connected(connected) {
+#ifdef HAVE_MSG_ZEROCOPY
+    cct = w->cct;
+    logger = w->get_perf_counter();
+    zc_min_bytes = cct->_conf.get_val<Option::size_t>("ms_tcp_zerocopy_min_bytes");
+    zc_max_pinned = cct->_conf.get_val<Option::size_t>(
+      "ms_tcp_zerocopy_max_pinned_bytes");
+    if (zc_min_bytes) {
+      int one = 1;
+      if (::setsockopt(_fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) < 0) {
+	ldout(cct, 5) << __func__ << " unable to enable SO_ZEROCOPY: "
+		      << cpp_strerror(ceph_sock_errno()) << dendl;
+	zc_min_bytes = 0;
+      }
+    }
+#endif
+  }
 
   int is_connected() override {
     if (connected)
@@ -65,6 +159,12 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
 
   ssize_t read(char *buf, size_t len) override {
+#ifdef HAVE_MSG_ZEROCOPY
+    // completions are signalled as an error, which wakes up the reader
+    if (!zc_sends.empty()) {
+      reap_zerocopy();
+    }
+#endif
     #ifdef _WIN32
     ssize_t r = ::recv(_fd, buf, len, 0);
     #else
@@ -78,13 +178,14 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   // return the sent length
   // < 0 means error occurred
   #ifndef _WIN32
-  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more)
+  ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more,
+		     int flags = 0)
   {
     size_t sent = 0;
     while (1) {
       MSGR_SIGPIPE_STOPPER;
       ssize_t r;
-      r = ::sendmsg(fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+      r = ::sendmsg(fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0) | flags);
       if (r < 0) {
         int err = ceph_sock_errno();
         if (err == EINTR) {
@@ -92,8 +193,22 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
         } else if (err == EAGAIN) {
           break;
         }
+#ifdef HAVE_MSG_ZEROCOPY
+        if (err == ENOBUFS && (flags & MSG_ZEROCOPY)) {
+          // out of option memory to track the send, copy it instead
+          logger->inc(l_msgr_send_zerocopy_fallbacks);
+          flags &= ~MSG_ZEROCOPY;
+          continue;
+        }
+#endif
         return -err;
       }
+#ifdef HAVE_MSG_ZEROCOPY
+      if (flags & MSG_ZEROCOPY) {
+        ++zc_next_seq;
+        logger->inc(l_msgr_send_zerocopy_bytes, r);
+      }
+#endif
 
       sent += r;
       if (len == sent) break;
@@ -115,6 +230,20 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
 
   ssize_t send(ceph::buffer::list &bl, bool more) override {
+    int flags = 0;
+#ifdef HAVE_MSG_ZEROCOPY
+    if (!zc_sends.empty()) {
+      reap_zerocopy();
+    }
+    if (zc_min_bytes && bl.length() >= zc_min_bytes) {
+      if (zc_pinned_bytes + bl.length() <= zc_max_pinned) {
+	flags = MSG_ZEROCOPY;
+      } else {
+	logger->inc(l_msgr_send_zerocopy_fallbacks);
+      }
+    }
+    uint32_t first_seq = zc_next_seq;
+#endif
     size_t sent_bytes = 0;
     auto pb = std::cbegin(bl.buffers());
     uint64_t left_pbrs = bl.get_num_buffers();
@@ -134,7 +263,7 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
 	msglen += pb->length();
 	++pb;
       }
-      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more);
+      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more, flags);
       if (r < 0)
         return r;
 
@@ -151,8 +280,17 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
         bl.splice(sent_bytes, bl.length()-sent_bytes, &swapped);
         bl.swap(swapped);
       } else {
-        bl.clear();
+        swapped.swap(bl);
+      }
+#ifdef HAVE_MSG_ZEROCOPY
+      // swapped holds what was sent now
+      if (zc_next_seq != first_seq) {
+        uint32_t calls = zc_next_seq - first_seq;
+        zc_pinned_bytes += swapped.length();
+        zc_sends.push_back(
+          ZeroCopySend{first_seq, calls, calls, std::move(swapped)});
       }
+#endif
     }
 
     return static_cast<ssize_t>(sent_bytes);
@@ -205,11 +343,18 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
     ::shutdown(_fd, SHUT_RDWR);
   }
   void close() override {
+    // buffers of zero-copy sends still in flight are released along with
+    // us; the data of a connection being torn down does not matter anymore
     compat_closesocket(_fd);
   }
   void set_priority(int sd, int prio, int domain) override {
     handler.set_priority(sd, prio, domain);
   }
+  void set_worker(Worker *w) override {
+#ifdef HAVE_MSG_ZEROCOPY
+    logger = w->get_perf_counter();
+#endif
+  }
   int fd() const override {
     return _fd;
   }
@@ -263,7 +408,7 @@ int PosixServerSocketImpl::accept(ConnectedSocket *sock, const SocketOptions &op
   out->set_sockaddr((sockaddr*)&ss);
   handler.set_priority(sd, opt.priority, out->get_family());
 
-  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(handler, *out, sd, true));
+  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(handler, *out, sd, true, w));
   *sock = ConnectedSocket(std::move(csi));
   return 0;
 }
@@ -332,7 +477,7 @@ int PosixWorker::connect(const entity_addr_t &addr, const SocketOptions &opts, C
 
   net.set_priority(sd, opts.priority, addr.get_family());
   *socket = ConnectedSocket(
-      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(net, addr, sd, !opts.nonblock)));
+      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(net, addr, sd, !opts.nonblock, this)));
   return 0;
 }
 
@@ -79,7 +79,7 @@ if(connection->interceptor) { \
     return _fault(); \
   } else if (a == Interceptor::ACTION::STOP) { \
     stop(); \
-    connection->dispatch_queue->queue_reset(connection); \
+    queue_reset(); \
     return nullptr; \
   }}}
   
@@ -148,6 +148,12 @@ void ProtocolV2::discard_out_queue() {
   write_in_progress = false;
 }
 
+void ProtocolV2::queue_reset() {
+  // messages read earlier in this process() round are still pending
+  // fast dispatch, deliver them before the reset
+  connection->queue_reset_locked();
+}
+
 void ProtocolV2::reset_session() {
   ldout(cct, 1) << __func__ << dendl;
 
@@ -331,7 +337,7 @@ CtPtr ProtocolV2::_fault() {
       !(state >= START_CONNECT && state <= SESSION_RECONNECTING)) {
     ldout(cct, 2) << __func__ << " on lossy channel, failing" << dendl;
     stop();
-    connection->dispatch_queue->queue_reset(connection);
+    queue_reset();
     return nullptr;
   }
 
@@ -347,7 +353,7 @@ CtPtr ProtocolV2::_fault() {
                    << " accept state just closed" << dendl;
     connection->write_lock.unlock();
     stop();
-    connection->dispatch_queue->queue_reset(connection);
+    queue_reset();
     return nullptr;
   }
 
@@ -1518,6 +1524,8 @@ CtPtr ProtocolV2::handle_message() {
   state = READY;
 
   ceph::mono_time fast_dispatch_time;
+  bool can_fast_dispatch;
+  bool reused = false;
 
   if (connection->is_blackhole()) {
     ldout(cct, 10) << __func__ << " blackhole " << *message << dendl;
@@ -1537,6 +1545,19 @@ CtPtr ProtocolV2::handle_message() {
   fast_dispatch_time = ceph::mono_clock::now();
   connection->logger->tinc(l_msgr_running_recv_time,
 			   fast_dispatch_time - connection->recv_start_time);
+  connection->recv_start_time = fast_dispatch_time;
+  can_fast_dispatch = messenger->ms_can_fast_dispatch(message);
+  if (!connection->pending_fast_dispatch.empty() &&
+      (connection->delay_state || !can_fast_dispatch)) {
+    // don't let this one overtake the messages read before it
+    connection->lock.unlock();
+    connection->fast_dispatch_pending();
+    connection->lock.lock();
+    // we might have been reused by another connection meanwhile. this
+    // message already counts in in_seq and may have been acked, so it is
+    // still queued below before we bail out
+    reused = state != READY;
+  }
   if (connection->delay_state) {
     double delay_period = 0;
     if (rand() % 10000 < cct->_conf->ms_inject_delay_probability * 10000.0) {
@@ -1547,23 +1568,30 @@ CtPtr ProtocolV2::handle_message() {
                     << " " << *message << dendl;
     }
     connection->delay_state->queue(delay_period, message);
-  } else if (messenger->ms_can_fast_dispatch(message)) {
-    connection->lock.unlock();
-    connection->dispatch_queue->fast_dispatch(message);
-    connection->recv_start_time = ceph::mono_clock::now();
-    connection->logger->tinc(l_msgr_running_fast_dispatch_time,
-                             connection->recv_start_time - fast_dispatch_time);
-    connection->lock.lock();
-    // we might have been reused by another connection
-    // let's check if that is the case
-    if (state != READY) {
-      // yes, that was the case, let's do nothing
-      return nullptr;
+  } else if (can_fast_dispatch) {
+    // dispatched together with the messages which follow it without the
+    // socket running dry, at the latest when AsyncConnection::process()
+    // returns
+    connection->pending_fast_dispatch.emplace_back(message, false);
+    if (connection->pending_fast_dispatch.size() >=
+        connection->fast_dispatch_batch_max) {
+      connection->lock.unlock();
+      connection->fast_dispatch_pending();
+      connection->lock.lock();
+      // we might have been reused by another connection
+      // let's check if that is the case
+      if (state != READY) {
+        // yes, that was the case, let's do nothing
+        return nullptr;
+      }
     }
   } else {
     connection->dispatch_queue->enqueue(message, message->get_priority(),
                                         connection->conn_id);
   }
+  if (reused) {
+    return nullptr;
+  }
 
   handle_message_ack(current_header.ack_seq);
 
@@ -54,6 +54,9 @@ std::function<void ()> NetworkStack::add_thread(Worker* w)
           // TODO do something?
         }
         w->perf_logger->tinc(l_msgr_running_total_time, dur);
+        if (r > 0) {
+          w->perf_logger->inc(l_msgr_running_events, r);
+        }
       }
       w->reset();
       w->destroy();
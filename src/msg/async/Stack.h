@@ -47,6 +47,8 @@ class ConnectedSocketImpl {
   virtual void close() = 0;
   virtual int fd() const = 0;
   virtual void set_priority(int sd, int prio, int domain) = 0;
+  /// the connection owning the socket moved to another worker
+  virtual void set_worker(Worker *w) {}
 };
 
 class ConnectedSocket;
@@ -142,6 +144,10 @@ class ConnectedSocket {
     _csi->set_priority(sd, prio, domain);
   }
 
+  void set_worker(Worker *w) {
+    _csi->set_worker(w);
+  }
+
   explicit operator bool() const {
     return _csi.get();
   }
@@ -225,6 +231,14 @@ enum {
   l_msgr_recv_encrypted_bytes,
   l_msgr_send_encrypted_bytes,
 
+  l_msgr_send_zerocopy_bytes,
+  l_msgr_send_zerocopy_copied,
+  l_msgr_send_zerocopy_fallbacks,
+
+  l_msgr_running_events,
+  l_msgr_connections_moved_in,
+  l_msgr_connections_moved_out,
+
   l_msgr_last,
 };
 
@@ -251,6 +265,8 @@ class Worker {
   unsigned id;
 
   std::atomic_uint references;
+  /// bytes read from and written to the sockets of this worker
+  std::atomic<uint64_t> io_bytes = {0};
   EventCenter center;
 
   Worker(const Worker&) = delete;
@@ -283,6 +299,14 @@ class Worker {
     plb.add_u64_counter(l_msgr_recv_encrypted_bytes, "msgr_recv_encrypted_bytes", "Network received encrypted bytes", NULL, 0, unit_t(UNIT_BYTES));
     plb.add_u64_counter(l_msgr_send_encrypted_bytes, "msgr_send_encrypted_bytes", "Network sent encrypted bytes", NULL, 0, unit_t(UNIT_BYTES));
 
+    plb.add_u64_counter(l_msgr_send_zerocopy_bytes, "msgr_send_zerocopy_bytes", "Network bytes sent with MSG_ZEROCOPY", NULL, 0, unit_t(UNIT_BYTES));
+    plb.add_u64_counter(l_msgr_send_zerocopy_copied, "msgr_send_zerocopy_copied", "Zero-copy sends the kernel copied anyway");
+    plb.add_u64_counter(l_msgr_send_zerocopy_fallbacks, "msgr_send_zerocopy_fallbacks", "Sends copied because too much data was pinned");
+
+    plb.add_u64_counter(l_msgr_running_events, "msgr_running_events", "Events processed by the worker thread");
+    plb.add_u64_counter(l_msgr_connections_moved_in, "msgr_connections_moved_in", "Connections moved to this worker to balance load");
+    plb.add_u64_counter(l_msgr_connections_moved_out, "msgr_connections_moved_out", "Connections moved away from this worker to balance load");
+
     perf_logger = plb.create_perf_counters();
     cct->get_perfcounters_collection()->add(perf_logger);
 
@@ -391,6 +415,9 @@ class NetworkStack {
   // need to let each thread do binding port.
   virtual bool support_local_listen_table() const { return false; }
   virtual bool nonblock_connect_need_writable_event() const { return true; }
+  // whether an established connection's socket may be handed over to
+  // another worker, i.e. it isn't tied to the worker that created it.
+  virtual bool support_connection_migration() const { return false; }
 
   void start();
   void stop();
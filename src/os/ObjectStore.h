@@ -51,6 +51,9 @@ namespace ceph {
 
 class Logger;
 class ContextQueue;
+namespace PriorityCache {
+  struct PriCache;
+}
 
 static inline void encode(const std::map<std::string,ceph::buffer::ptr> *attrset, ceph::buffer::list &bl) {
   using ceph::encode;
@@ -289,6 +292,19 @@ public:
 
   virtual void set_cache_shards(unsigned num) { }
 
+  /**
+   * hand a cache of the caller to the store's cache autotuner
+   *
+   * @return true if the store sizes @p cache from now on, false if it
+   *         does not autotune its caches
+   */
+  virtual bool register_priority_cache(
+    const std::string& name,
+    std::shared_ptr<PriorityCache::PriCache> cache) {
+    return false;
+  }
+  virtual void unregister_priority_cache(const std::string& name) { }
+
   /**
    * Returns 0 if the hobject is valid, -error otherwise
    *
@@ -307,6 +307,14 @@ void Transaction::dump(ceph::Formatter *f)
       }
       break;
 
+    case Transaction::OP_DESTROY_COLLECTION:
+      {
+        coll_t cid = i.get_cid(op->cid);
+	f->dump_string("op_name", "destroycoll");
+	f->dump_stream("collection") << cid;
+      }
+      break;
+
     case Transaction::OP_COLL_ADD:
       {
         coll_t ocid = i.get_cid(op->cid);
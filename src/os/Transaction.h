@@ -154,6 +154,7 @@ public:
 
     OP_MERGE_COLLECTION = 43, // cid, destination
     OP_TOUCH_TEMP = 44, // cid, temp_oid, target_oid
+    OP_DESTROY_COLLECTION = 45, // cid
   };
 
   // Transaction hint type
@@ -453,6 +454,7 @@ public:
 
     case OP_MKCOLL:
     case OP_RMCOLL:
+    case OP_DESTROY_COLLECTION:
     case OP_COLL_SETATTR:
     case OP_COLL_RMATTR:
     case OP_COLL_SETATTRS:
@@ -1111,6 +1113,13 @@ public:
     _op->cid = _get_coll_id(cid);
     data.ops = data.ops + 1;
   }
+  /// remove the collection together with all objects it still holds
+  void destroy_collection(const coll_t& cid) {
+    Op* _op = _get_next_op();
+    _op->op = OP_DESTROY_COLLECTION;
+    _op->cid = _get_coll_id(cid);
+    data.ops = data.ops + 1;
+  }
   void collection_move(const coll_t& cid, const coll_t &oldcid, const ghobject_t& oid)
     __attribute__ ((deprecated)) {
 	// NOTE: we encode this as a fixed combo of ADD + REMOVE.  they
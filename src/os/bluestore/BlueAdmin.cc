@@ -19,6 +19,7 @@
 using ceph::bufferlist;
 using ceph::Formatter;
 using ceph::common::cmd_getval;
+using ceph::common::cmd_getval_or;
 
 BlueStore::SocketHook::SocketHook(BlueStore& store)
   : store(store)
@@ -82,6 +83,19 @@ BlueStore::SocketHook::SocketHook(BlueStore& store)
       this,
       "print RocksDB sharding");
     ceph_assert(r == 0);
+    r = admin_socket->register_command(
+      "bluestore db sharding advise "
+      "name=hot_share,type=CephFloat,range=0.0|1.0,req=false "
+      "name=reset,type=CephBool,req=false",
+      this,
+      "print per prefix access rates and a proposed RocksDB sharding "
+      "with its expected write amplification");
+    ceph_assert(r == 0);
+    r = admin_socket->register_command(
+      "bluestore scan progress",
+      this,
+      "print progress of running fsck and allocation recovery scans");
+    ceph_assert(r == 0);
     r = admin_socket->register_command("bluestore bluefs-bdev-expand",
                                        this,
                                        "Instruct BlueFS to check the size of its block devices"
@@ -225,6 +239,17 @@ int BlueStore::SocketHook::call(
       ss << "Failed to get sharding" << std::endl;
     }
     return r;
+  } else if (command == "bluestore db sharding advise") {
+    double hot_share = cmd_getval_or<double>(cmdmap, "hot_share", 0.1);
+    bool reset = cmd_getval_or<bool>(cmdmap, "reset", false);
+    r = store.advise_db_sharding(f, hot_share, reset);
+    if (r == -EOPNOTSUPP) {
+      ss << "access accounting is off, set rocksdb_access_stats and restart"
+         << std::endl;
+    } else if (r < 0) {
+      ss << "Failed to plan sharding: " << cpp_strerror(r) << std::endl;
+    }
+    return r;
   } else if (command == "bluestore runtime frag score") {
     std::shared_lock l(store.coll_lock);
     std::string coll;
@@ -296,6 +321,16 @@ int BlueStore::SocketHook::call(
       }
     }
     return 0;
+  } else if (command == "bluestore scan progress") {
+    f->open_object_section("scan_progress");
+    f->open_object_section("fsck");
+    store.fsck_progress.dump(f);
+    f->close_section();
+    f->open_object_section("allocation_recovery");
+    store.alloc_recovery_progress.dump(f);
+    f->close_section();
+    f->close_section();
+    return 0;
   } else if (command == "bluestore bluefs-bdev-expand"){
     std::stringstream result;
     int ret = store.expand_devices(result);
@@ -479,6 +479,31 @@ void BlueFS::_init_logger()
                 "Average allocation latency for primary/shared device",
                 "bsal",
                 PerfCountersBuilder::PRIO_USEFUL);
+  b.add_u64_counter(l_bluefs_log_group_flushes, "log_group_flushes",
+                    "Log flushes done on behalf of fsync callers");
+  b.add_u64_counter(l_bluefs_log_group_joined, "log_group_joined",
+                    "Fsync callers whose log seq was synced by another thread");
+  b.add_time_avg(l_bluefs_log_flush_wait_lat, "log_flush_wait_lat",
+                 "Average time fsync callers wait to get their log seq synced");
+
+  PerfHistogramCommon::axis_config_d log_flush_hist_x_axis_config{
+    "Wait time (usec)",
+    PerfHistogramCommon::SCALE_LOG2, ///< Latency in logarithmic scale
+    0,                               ///< Start at 0
+    10000,                           ///< Quantization unit is 10usec
+    16,                              ///< Enough to cover ~300ms waits
+  };
+  PerfHistogramCommon::axis_config_d log_flush_hist_y_axis_config{
+    "Flush size (bytes)",
+    PerfHistogramCommon::SCALE_LOG2, ///< Flush size in logarithmic scale
+    0,                               ///< Start at 0
+    4096,                            ///< Quantization unit is 4K block
+    12,                              ///< Enough to cover 8M flushes
+  };
+  b.add_u64_counter_histogram(
+    l_bluefs_log_flush_hist, "log_flush_histogram",
+    log_flush_hist_x_axis_config, log_flush_hist_y_axis_config,
+    "Histogram of log flush wait time vs. flushed log bytes");
 
   logger = b.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
@@ -1947,6 +1972,11 @@ int BlueFS::_replay(bool noop, bool to_stdout)
     dirty.seq_live = log_seq + 1;
     log.t.seq = log.seq_live;
     dirty.seq_stable = log_seq;
+    {
+      std::lock_guard gl(log.group.lock);
+      log.group.seq_in_flight = log_seq;
+      log.group.seq_synced = log_seq;
+    }
 
     for (const auto &[filename, file] : nodes.file_map) {
       if (file->envelope_mode()) {
@@ -3814,7 +3844,7 @@ void BlueFS::_extend_log(uint64_t amount) {
   }
 }
 
-void BlueFS::_flush_and_sync_log_core()
+uint64_t BlueFS::_flush_and_sync_log_core()
 {
   ceph_assert(ceph_mutex_is_locked(log.lock));
   dout(10) << __func__ << " " << log.t << dendl;
@@ -3845,6 +3875,7 @@ void BlueFS::_flush_and_sync_log_core()
 
   uint64_t new_data = _flush_special(log.writer);
   vselector->add_usage(log.writer->file->vselector_hint, new_data);
+  return bl.length();
 }
 
 // Clears dirty.files up to (including) seq_stable.
@@ -3902,9 +3933,45 @@ void BlueFS::_release_pending_allocations(vector<interval_set<uint64_t>>& to_rel
   }
 }
 
+bool BlueFS::_log_seq_synced(uint64_t want_seq, mono_clock::time_point t0)
+{
+  {
+    std::lock_guard gl(log.group.lock);
+    if (want_seq > log.group.seq_synced) {
+      return false;
+    }
+  }
+  dout(10) << __func__ << " want_seq " << want_seq
+           << " synced by another thread, done" << dendl;
+  logger->inc(l_bluefs_log_group_joined);
+  logger->tinc(l_bluefs_log_flush_wait_lat, mono_clock::now() - t0);
+  return true;
+}
+
 int BlueFS::_flush_and_sync_log_LD(uint64_t want_seq)
 {
+  auto t0 = mono_clock::now();
+  if (want_seq) {
+    // join the in-flight flush if it carries our seq
+    std::unique_lock gl(log.group.lock);
+    if (want_seq <= log.group.seq_in_flight) {
+      log.group.cond.wait(gl, [&] {
+        return want_seq <= log.group.seq_synced;
+      });
+    }
+    gl.unlock();
+    if (_log_seq_synced(want_seq, t0)) {
+      return 0;
+    }
+  }
+
   log.lock.lock();
+  // a flush that ran while we waited for log.lock may have carried our seq;
+  // dirty.seq_stable is only advanced after log.lock is dropped
+  if (want_seq && _log_seq_synced(want_seq, t0)) {
+    log.lock.unlock();
+    return 0;
+  }
   dirty.lock.lock();
   if (want_seq && want_seq <= dirty.seq_stable) {
     dout(10) << __func__ << " want_seq " << want_seq << " <= seq_stable "
@@ -3920,14 +3987,31 @@ int BlueFS::_flush_and_sync_log_LD(uint64_t want_seq)
   vector<interval_set<uint64_t>> to_release(dirty.pending_release.size());
   to_release.swap(dirty.pending_release);
   dirty.lock.unlock();
+  {
+    std::lock_guard gl(log.group.lock);
+    log.group.seq_in_flight = seq;
+  }
+  auto t_wait = mono_clock::now() - t0;
 
   _maybe_extend_log();
-  _flush_and_sync_log_core();
+  uint64_t flushed = _flush_and_sync_log_core();
   _flush_bdev(log.writer);
   logger->set(l_bluefs_log_bytes, log.writer->file->fnode.size);
+  {
+    std::lock_guard gl(log.group.lock);
+    log.group.seq_synced = std::max(log.group.seq_synced, seq);
+  }
+  log.group.cond.notify_all();
   //now log.lock is no longer needed
   log.lock.unlock();
 
+  if (want_seq) {
+    logger->inc(l_bluefs_log_group_flushes);
+    logger->tinc(l_bluefs_log_flush_wait_lat, mono_clock::now() - t0);
+    logger->hinc(l_bluefs_log_flush_hist,
+                 std::chrono::nanoseconds(t_wait).count(), flushed);
+  }
+
   _clear_dirty_set_stable_D(seq);
   _release_pending_allocations(to_release);
 
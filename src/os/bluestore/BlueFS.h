@@ -88,6 +88,10 @@ enum {
   l_bluefs_wal_alloc_lat,
   l_bluefs_db_alloc_lat,
   l_bluefs_slow_alloc_lat,
+  l_bluefs_log_group_flushes,
+  l_bluefs_log_group_joined,
+  l_bluefs_log_flush_wait_lat,
+  l_bluefs_log_flush_hist,
   l_bluefs_last,
 };
 
@@ -621,6 +625,14 @@ private:
     FileWriter *writer = nullptr;
     bluefs_transaction_t t;
     bool uses_envelope_mode = false; // true if any file is in envelope mode
+    // group commit: _flush_and_sync_log_LD callers whose seq is already
+    // being written by another thread wait for it instead of for log.lock
+    struct {
+      ceph::mutex lock = ceph::make_mutex("BlueFS::log.group.lock");
+      ceph::condition_variable cond;
+      uint64_t seq_in_flight = 0; //seq that is being flushed by the leader
+      uint64_t seq_synced = 0;    //seq that is on disk; seq_stable may lag
+    } group;
   } log;
 
   struct {
@@ -728,9 +740,10 @@ private:
   void _clear_dirty_set_stable_D(uint64_t seq_stable);
   void _release_pending_allocations(std::vector<interval_set<uint64_t>>& to_release);
 
-  void _flush_and_sync_log_core();
+  uint64_t _flush_and_sync_log_core();
   int _flush_and_sync_log_jump_D(uint64_t jump_to);
   int _flush_and_sync_log_LD(uint64_t want_seq = 0);
+  bool _log_seq_synced(uint64_t want_seq, ceph::mono_clock::time_point t0);
 
   uint64_t _estimate_transaction_size(bluefs_transaction_t* t);
   uint64_t _make_initial_transaction(uint64_t start_seq,
@@ -349,6 +349,36 @@ static void get_coll_range(const coll_t& cid, int bits,
   temp_end->generation = 0;
 }
 
+// Key ranges holding the onodes and extent shards (PREFIX_OBJ, temp and
+// regular section) and the per-pg omap (PREFIX_PERPG_OMAP) of every
+// object of a pg collection.  The omap keys have no shard, so for an EC
+// pg the omap range also covers the other shards held by this OSD.
+static void get_pg_key_ranges(const spg_t& pgid, int bits,
+  vector<pair<string, string>> *obj_ranges,
+  pair<string, string> *perpg_omap_range)
+{
+  uint32_t start_hash = hobject_t::_reverse_bits(pgid.ps());
+  uint64_t end_hash = (uint64_t)start_hash + (1ull << (32 - bits));
+  // the last pg of a pool ends where the next pool starts
+  bool last = end_hash > std::numeric_limits<uint32_t>::max();
+  for (int64_t pool : { (int64_t)pgid.pool(), -2ll - (int64_t)pgid.pool() }) {
+    string start, end;
+    _key_encode_shard(pgid.shard, &start);
+    end = start;
+    _key_encode_u64(pool + 0x8000000000000000ull, &start);
+    _key_encode_u32(start_hash, &start);
+    _key_encode_u64(pool + (last ? 1 : 0) + 0x8000000000000000ull, &end);
+    _key_encode_u32(last ? 0 : (uint32_t)end_hash, &end);
+    obj_ranges->emplace_back(std::move(start), std::move(end));
+  }
+  perpg_omap_range->first.clear();
+  perpg_omap_range->second.clear();
+  _key_encode_u64(pgid.pool(), &perpg_omap_range->first);
+  _key_encode_u32(start_hash, &perpg_omap_range->first);
+  _key_encode_u64(pgid.pool() + (last ? 1 : 0), &perpg_omap_range->second);
+  _key_encode_u32(last ? 0 : (uint32_t)end_hash, &perpg_omap_range->second);
+}
+
 static void get_shared_blob_key(uint64_t sbid, string *key)
 {
   key->clear();
@@ -594,6 +624,7 @@ void _dump_extent_map(CephContext *cct, const BlueStore::ExtentMap &em)
     dout(LogLevelV) << __func__ << "  shard " << *s.shard_info
 		    << (s.loaded ? " (loaded)" : "")
 		    << (s.dirty ? " (dirty)" : "")
+		    << (s.encoded.length() ? " (encoded)" : "")
 		    << dendl;
   }
   for (auto& e : em.extent_map) {
@@ -1145,13 +1176,17 @@ struct LruOnodeCacheShard : public BlueStore::OnodeCacheShard {
 	  dout(20) << __func__ << " " << this << " " << o->oid << " unpinned"
                    << dendl;
         } else {
-	  ceph_assert(num);
-	  --num;
-	  o->clear_cached();
-	  dout(20) << __func__ << " " << this << " " << o->oid << " removed"
-                   << dendl;
-          // remove will also decrement nref
-          o->c->onode_space._remove(o->oid);
+	  // make sure a lockless lookup can't pin it behind our back
+	  o->c->onode_space._unpublish(o);
+	  if (o->pin_nref == 1) {
+	    ceph_assert(num);
+	    --num;
+	    o->clear_cached();
+	    dout(20) << __func__ << " " << this << " " << o->oid << " removed"
+		     << dendl;
+	    // remove will also decrement nref
+	    o->c->onode_space._remove(o->oid);
+	  }
         }
       } else if (o->exists) {
         // move onode within LRU
@@ -1186,8 +1221,17 @@ struct LruOnodeCacheShard : public BlueStore::OnodeCacheShard {
                << o->nref << " " << o->cached << dendl;
 
       *(o->cache_age_bin) -= 1;
+      // make sure a lockless lookup can't pin it behind our back
+      o->c->onode_space._unpublish(o);
       if (o->pin_nref > 1) {
         dout(20) << __func__ << " " << this << " " << " " << " " << o->oid << dendl;
+      } else if (o->compact()) {
+        // give it a second chance in its compact form
+        dout(20) << __func__ << " " << this << " " << o->oid << " compacted"
+                 << dendl;
+        lru.push_front(*o);
+        o->cache_age_bin = age_bins.front();
+        *(o->cache_age_bin) += 1;
       } else {
 	ceph_assert(num);
         --num;
@@ -2061,6 +2105,86 @@ void BlueStore::TransContext::finish_writing()
 #undef dout_prefix
 #define dout_prefix *_dout << "bluestore.OnodeSpace(" << this << " in " << cache << ") "
 
+BlueStore::OnodeSpace::OnodeSpace(OnodeCacheShard *c)
+  : cache(c)
+{
+  uint64_t slots =
+    c->cct->_conf.get_val<uint64_t>("bluestore_onode_lockless_lookup_slots");
+  if (slots) {
+    fast_slots = decltype(fast_slots)(std::bit_ceil(slots));
+  }
+}
+
+int BlueStore::OnodeSpace::_rcu_read_lock()
+{
+  while (true) {
+    auto e = rcu_epoch.load();
+    int idx = e & 1;
+    ++rcu_readers[idx];
+    // a writer may have flipped the epoch before we registered; if so
+    // it might not account for us, retry against the new epoch.
+    if (rcu_epoch.load() == e) {
+      return idx;
+    }
+    --rcu_readers[idx];
+  }
+}
+
+void BlueStore::OnodeSpace::_unpublish(Onode* o)
+{
+  if (fast_slots.empty()) {
+    return;
+  }
+  Onode* expected = o;
+  _fast_slot(o->oid).compare_exchange_strong(expected, nullptr);
+}
+
+void BlueStore::OnodeSpace::_unpublish_all()
+{
+  if (fast_slots.empty()) {
+    return;
+  }
+  for (auto& slot : fast_slots) {
+    slot.store(nullptr);
+  }
+}
+
+void BlueStore::OnodeSpace::_retire(Onode* o)
+{
+  ceph_assert(ceph_mutex_is_locked(cache->lock)); // serializes writers
+  if (fast_slots.empty()) {
+    return;
+  }
+  // a reader may still be about to pin it, keep it around until then
+  ++o->nref;
+  retired.push_back(o);
+  _reclaim();
+}
+
+void BlueStore::OnodeSpace::_reclaim()
+{
+  // readers that may have seen retired_prev registered before the last
+  // flip, against the counter that is no longer handed out
+  if (!retired_prev.empty() &&
+      rcu_readers[(rcu_epoch.load() - 1) & 1].load() == 0) {
+    _free_retired(retired_prev);
+  }
+  if (retired_prev.empty() && !retired.empty()) {
+    retired_prev.swap(retired);
+    rcu_epoch.fetch_add(1);
+  }
+}
+
+void BlueStore::OnodeSpace::_free_retired(std::vector<Onode*>& v)
+{
+  for (auto o : v) {
+    if (--o->nref == 0) {
+      delete o;
+    }
+  }
+  v.clear();
+}
+
 BlueStore::OnodeRef BlueStore::OnodeSpace::add_onode(const ghobject_t& oid,
   OnodeRef& o)
 {
@@ -2075,20 +2199,58 @@ BlueStore::OnodeRef BlueStore::OnodeSpace::add_onode(const ghobject_t& oid,
   }
   ldout(cache->cct, 20) << __func__ << " " << oid << " " << o << dendl;
   cache->_add(o.get(), 1);
+  _publish(o.get());
   cache->_trim_some();
   return o;
 }
 
 void BlueStore::OnodeSpace::_remove(const ghobject_t& oid)
 {
+  // caller must have _unpublish()ed the onode
   ldout(cache->cct, 20) << __func__ << " " << oid << " " << dendl;
-  onode_map.erase(oid);
+  auto p = onode_map.find(oid);
+  if (p != onode_map.end()) {
+    _retire(p->second.get());
+    onode_map.erase(p);
+  }
+}
+
+BlueStore::OnodeRef BlueStore::OnodeSpace::_lookup_lockless(
+  const ghobject_t& oid)
+{
+  OnodeRef o;
+  if (fast_slots.empty()) {
+    return o;
+  }
+  bool stale = false;
+  int idx = _rcu_read_lock();
+  Onode* p = _fast_slot(oid).load();
+  if (p && p->oid == oid) {
+    // p is not freed before we drop out of the read side, see _retire().
+    // Pin it first and keep it only if it is still published: trim
+    // unpublishes before checking the pin count, so one of us sees the
+    // other.
+    o = p;
+    stale = _fast_slot(oid).load() != p;
+  }
+  _rcu_read_unlock(idx);
+  if (stale) {
+    o.reset();  // may take cache->lock to unpin
+  }
+  return o;
 }
 
 BlueStore::OnodeRef BlueStore::OnodeSpace::lookup(const ghobject_t& oid)
 {
   ldout(cache->cct, 30) << __func__ << dendl;
-  OnodeRef o;
+  OnodeRef o = _lookup_lockless(oid);
+  if (o) {
+    ldout(cache->cct, 30) << __func__ << " " << oid << " lockless hit " << o
+			  << dendl;
+    cache->logger->inc(l_bluestore_onode_hits);
+    cache->logger->inc(l_bluestore_onode_lockless_hits);
+    return o;
+  }
 
   {
     std::lock_guard l(cache->lock);
@@ -2104,6 +2266,7 @@ BlueStore::OnodeRef BlueStore::OnodeSpace::lookup(const ghobject_t& oid)
       // This will pin onode and implicitly touch the cache when Onode
       // eventually will become unpinned
       o = p->second;
+      _publish(o.get());
 
       cache->logger->inc(l_bluestore_onode_hits);
     }
@@ -2116,8 +2279,10 @@ void BlueStore::OnodeSpace::clear()
 {
   std::lock_guard l(cache->lock);
   ldout(cache->cct, 10) << __func__ << " " << onode_map.size()<< dendl;
+  _unpublish_all();
   for (auto &p : onode_map) {
     cache->_rm(p.second.get());
+    _retire(p.second.get());
   }
   onode_map.clear();
 }
@@ -2145,10 +2310,13 @@ void BlueStore::OnodeSpace::rename(
   if (pn != onode_map.end()) {
     ldout(cache->cct, 30) << __func__ << "  removing target " << pn->second
 			  << dendl;
+    _unpublish(pn->second.get());
     cache->_rm(pn->second.get());
+    _retire(pn->second.get());
     onode_map.erase(pn);
   }
   OnodeRef o = po->second;
+  _unpublish(o.get());
 
   // install a non-existent onode at old location
   oldo.reset(new Onode(o->c, old_oid, o->key));
@@ -3522,6 +3690,14 @@ void BlueStore::ExtentMap::update(KeyValueDB::Transaction t,
 	       << it.shard->shard_info->offset << std::dec << dendl;
       it.shard->dirty = false;
       it.shard->shard_info->bytes = it.bl.length();
+      if (onode->c->store->onode_compact_cache) {
+	it.shard->encoded = it.bl;
+	if (it.shard->encoded.get_num_buffers() > 1) {
+	  it.shard->encoded.rebuild();
+	}
+	it.shard->encoded.reassign_to_mempool(
+	  mempool::mempool_bluestore_inline_bl);
+      }
       generate_extent_shard_key_and_apply(
 	onode->key,
 	it.shard->shard_info->offset,
@@ -4357,7 +4533,13 @@ void BlueStore::ExtentMap::maybe_load_shard(
   while (start <= last) {
     ceph_assert((size_t)start < shards.size());
     auto p = &shards[start];
-    if (!p->loaded) {
+    if (!p->loaded && p->encoded.length()) {
+      // decode on demand from the cached encoded form
+      ceph_assert(p->dirty == false);
+      p->extents = decode_some(p->encoded);
+      p->loaded = true;
+      onode->c->store->logger->inc(l_bluestore_onode_shard_compact_hits);
+    } else if (!p->loaded) {
       BLUE_SCOPE(maybe_load_shard);
       dout(30) << __func__ << " opening shard 0x" << std::hex
 	       << p->shard_info->offset << std::dec << dendl;
@@ -4383,6 +4565,10 @@ void BlueStore::ExtentMap::maybe_load_shard(
 	       << " (" << v.length() << " bytes)" << dendl;
       ceph_assert(p->dirty == false);
       ceph_assert(v.length() == p->shard_info->bytes);
+      if (onode->c->store->onode_compact_cache) {
+	p->encoded = std::move(v);
+	p->encoded.reassign_to_mempool(mempool::mempool_bluestore_inline_bl);
+      }
       onode->c->store->logger->inc(l_bluestore_onode_shard_misses);
     } else {
       onode->c->store->logger->inc(l_bluestore_onode_shard_hits);
@@ -4391,6 +4577,29 @@ void BlueStore::ExtentMap::maybe_load_shard(
   }
 }
 
+unsigned BlueStore::ExtentMap::compact_clean_shards()
+{
+  unsigned n = 0;
+  for (size_t i = 0; i < shards.size(); ++i) {
+    auto& s = shards[i];
+    if (!s.loaded || s.dirty || s.encoded.length() == 0) {
+      continue;
+    }
+    uint32_t end = i + 1 < shards.size() ?
+      shards[i + 1].shard_info->offset : OBJECT_MAX_SIZE;
+    // extents never cross shard boundaries, spanning blobs stay put
+    Extent dummy(s.shard_info->offset);
+    auto p = extent_map.lower_bound(dummy);
+    while (p != extent_map.end() && p->logical_offset < end) {
+      rm(p++);
+    }
+    s.loaded = false;
+    ++n;
+  }
+  dout(20) << __func__ << " unloaded " << n << " shards" << dendl;
+  return n;
+}
+
 void BlueStore::ExtentMap::dirty_range(
   uint32_t offset,
   uint32_t length)
@@ -4424,6 +4633,7 @@ void BlueStore::ExtentMap::dirty_range(
       dout(20) << __func__ << " mark shard 0x" << std::hex
 	       << p->shard_info->offset << std::dec << " dirty" << dendl;
       p->dirty = true;
+      p->encoded.clear();
     }
     ++start;
   }
@@ -4925,6 +5135,18 @@ void BlueStore::Onode::put()
   }
 }
 
+bool BlueStore::Onode::compact()
+{
+  if (!c->store->onode_compact_cache || flushing_count.load()) {
+    return false;
+  }
+  unsigned n = extent_map.compact_clean_shards();
+  if (n) {
+    c->store->logger->inc(l_bluestore_onode_shard_compacted, n);
+  }
+  return n > 0;
+}
+
 void BlueStore::Onode::decode_raw(
   BlueStore::Onode* on,
   const bufferlist& v,
@@ -5467,6 +5689,7 @@ void BlueStore::Collection::split_cache(
       // ensuring that nref is always >= 2 and hence onode is pinned
       OnodeRef o_pin = o;
 
+      onode_space._unpublish(o.get());
       p = onode_space.onode_map.erase(p);
       dest->onode_space.onode_map[o->oid] = o;
       if (o->cached) {
@@ -5575,6 +5798,9 @@ void *BlueStore::MempoolThread::entry()
     if (binned_kv_onode_cache != nullptr) {
       pcm->insert("kv_onode", binned_kv_onode_cache, true);
     }
+    for (auto& [name, cache] : external_caches) {
+      pcm->insert(name, cache, true);
+    }
   }
 
   utime_t next_balance = ceph_clock_now();
@@ -5833,7 +6059,8 @@ BlueStore::BlueStore(CephContext *cct,
     kv_finalize_thread(this),
     min_alloc_size(_min_alloc_size),
     min_alloc_size_order(std::countr_zero(_min_alloc_size)),
-    mempool_thread(this)
+    mempool_thread(this),
+    defrag_thread(this)
 {
   _init_logger();
   cct->_conf.add_observer(this);
@@ -6436,6 +6663,12 @@ void BlueStore::_init_logger()
   b.add_time_avg(l_bluestore_read_lat, "read_lat",
 		 "Average read latency",
 		 "r_l", PerfCountersBuilder::PRIO_CRITICAL);
+  b.add_u64_counter(l_bluestore_read_zerocopy_bytes, "read_zerocopy_bytes",
+		    "Bytes returned by reference to device or cache buffers",
+		    "rzcb", PerfCountersBuilder::PRIO_USEFUL, unit_t(UNIT_BYTES));
+  b.add_u64_counter(l_bluestore_read_copied_bytes, "read_copied_bytes",
+		    "Bytes returned from decompressed or zero-filled buffers",
+		    "rcpb", PerfCountersBuilder::PRIO_USEFUL, unit_t(UNIT_BYTES));
   //****************************************
 
   // kv_thread latencies
@@ -6452,6 +6685,8 @@ void BlueStore::_init_logger()
   b.add_time_avg(l_bluestore_kv_final_lat, "kv_final_lat",
 		 "Average kv_finalize thread latency",
 		 "kfll", PerfCountersBuilder::PRIO_INTERESTING);
+  b.add_u64_counter(l_bluestore_kv_sync_txc, "kv_sync_txc",
+		    "Transactions committed by kv_sync thread (lane 0)");
   //****************************************
 
   // write op stats
@@ -6515,6 +6750,15 @@ void BlueStore::_init_logger()
 		    NULL,
 		    PerfCountersBuilder::PRIO_DEBUGONLY,
 		    unit_t(UNIT_BYTES));
+  b.add_u64_counter(l_bluestore_deferred_coalesce_groups,
+		    "deferred_coalesce_groups",
+		    "Deferred submissions coalesced across OpSequencers");
+  b.add_u64_counter(l_bluestore_deferred_coalesce_ios_in,
+		    "deferred_coalesce_ios_in",
+		    "Deferred ios that per-sequencer submission would have issued");
+  b.add_u64_counter(l_bluestore_deferred_coalesce_ios_out,
+		    "deferred_coalesce_ios_out",
+		    "Deferred ios actually issued after cross-sequencer coalescing");
 
   b.add_u64_counter(l_bluestore_write_big_skipped_blobs,
       "write_big_skipped_blobs",
@@ -6565,11 +6809,19 @@ void BlueStore::_init_logger()
   b.add_u64_counter(l_bluestore_onode_misses, "onode_misses",
 		    "Count of onode cache lookup misses",
 		    "o_ms", PerfCountersBuilder::PRIO_USEFUL);
+  b.add_u64_counter(l_bluestore_onode_lockless_hits, "onode_lockless_hits",
+		    "Count of onode cache hits served without the cache shard lock");
   b.add_u64_counter(l_bluestore_onode_shard_hits, "onode_shard_hits",
 		    "Count of onode shard cache lookups hits");
   b.add_u64_counter(l_bluestore_onode_shard_misses,
 		    "onode_shard_misses",
 		    "Count of onode shard cache lookups misses");
+  b.add_u64_counter(l_bluestore_onode_shard_compact_hits,
+		    "onode_shard_compact_hits",
+		    "Count of onode shards decoded from the compact cache");
+  b.add_u64_counter(l_bluestore_onode_shard_compacted,
+		    "onode_shard_compacted",
+		    "Count of onode shards unloaded to their compact form");
   b.add_u64(l_bluestore_extents, "onode_extents",
 	    "Number of extents in cache");
   b.add_u64(l_bluestore_blobs, "onode_blobs",
@@ -6659,6 +6911,13 @@ void BlueStore::_init_logger()
   b.add_time_avg(l_bluestore_truncate_lat, "truncate_lat",
     "Average truncate latency",
     "tr_l", PerfCountersBuilder::PRIO_USEFUL);
+  b.add_time_avg(l_bluestore_destroy_coll_lat, "destroy_collection_lat",
+    "Average latency of removing a collection with its objects");
+  b.add_u64_counter(l_bluestore_destroy_coll_objects, "destroy_collection_objects",
+    "Objects removed together with their collection");
+  b.add_u64_counter(l_bluestore_destroy_coll_range_deletes,
+    "destroy_collection_range_deletes",
+    "Key ranges dropped with a single range deletion on collection removal");
   //****************************************
 
   // slow op count
@@ -6731,6 +6990,17 @@ void BlueStore::_init_logger()
     "Latency of static fragmentation measurement during scrub",
     "sfl",
     PerfCountersBuilder::PRIO_USEFUL);
+  b.add_u64_counter(l_bluestore_defrag_objects, "defrag_objects",
+    "Objects rewritten by the defragmenter");
+  b.add_u64_counter(l_bluestore_defrag_bytes, "defrag_bytes",
+    "Bytes rewritten by the defragmenter",
+    NULL, 0, unit_t(UNIT_BYTES));
+  b.add_u64_counter(l_bluestore_defrag_score_before, "defrag_score_before",
+    "Sum of fragmentation scores of defragmented objects before rewrite");
+  b.add_u64_counter(l_bluestore_defrag_score_after, "defrag_score_after",
+    "Sum of fragmentation scores of defragmented objects after rewrite");
+  b.add_u64_counter(l_bluestore_defrag_busy, "defrag_busy",
+    "Defragmentation rounds cut short by client load");
 
   logger = b.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
@@ -8299,6 +8569,14 @@ int BlueStore::_prepare_db_environment(bool create, bool read_only,
 
   FreelistManager::setup_merge_operators(db, freelist_type);
   db->set_merge_operator(PREFIX_STAT, merge_op);
+  if (cct->_conf.get_val<bool>("bluestore_rocksdb_omap_prefix_bloom")) {
+    // see Onode::calc_omap_key(): everything up to and including the nid
+    db->set_prefix_bloom(PREFIX_OMAP, sizeof(uint64_t));
+    db->set_prefix_bloom(PREFIX_PGMETA_OMAP, sizeof(uint64_t));
+    db->set_prefix_bloom(PREFIX_PERPOOL_OMAP, 2 * sizeof(uint64_t));
+    db->set_prefix_bloom(PREFIX_PERPG_OMAP,
+      2 * sizeof(uint64_t) + sizeof(uint32_t));
+  }
   db->set_cache_size(cache_kv_ratio * cache_size);
   return 0;
 }
@@ -9225,6 +9503,27 @@ bool BlueStore::get_db_sharding(std::string& res_sharding)
   return ret;
 }
 
+int BlueStore::advise_db_sharding(Formatter* f,
+				  double hot_write_share,
+				  bool reset)
+{
+  RocksDBStore* rdb = dynamic_cast<RocksDBStore*>(db);
+  if (!rdb) {
+    return -EOPNOTSUPP;
+  }
+  std::string proposed;
+  f->open_object_section("sharding_advice");
+  int r = rdb->advise_sharding(f, hot_write_share, reset, &proposed);
+  if (r == 0 && !proposed.empty()) {
+    // resharding rewrites the whole db and needs the OSD to be stopped
+    f->dump_string("command",
+		   "ceph-bluestore-tool --path " + path +
+		   " --sharding=\"" + proposed + "\" reshard");
+  }
+  f->close_section();
+  return r;
+}
+
 int BlueStore::expand_devices(ostream& out)
 {
   bool need_to_close = false;
@@ -9469,6 +9768,29 @@ fail:
   return r;
 }
 
+bool BlueStore::register_priority_cache(
+  const std::string& name,
+  std::shared_ptr<PriorityCache::PriCache> cache)
+{
+  dout(10) << __func__ << " " << name << dendl;
+  std::lock_guard l(mempool_thread.lock);
+  ceph_assert(!mempool_thread.external_caches.count(name));
+  mempool_thread.external_caches.emplace(name, cache);
+  if (mempool_thread.pcm) {
+    mempool_thread.pcm->insert(name, cache, true);
+  }
+  return cache_autotune;
+}
+
+void BlueStore::unregister_priority_cache(const std::string& name)
+{
+  dout(10) << __func__ << " " << name << dendl;
+  std::lock_guard l(mempool_thread.lock);
+  if (mempool_thread.external_caches.erase(name) && mempool_thread.pcm) {
+    mempool_thread.pcm->erase(name);
+  }
+}
+
 void BlueStore::set_cache_shards(unsigned num)
 {
   dout(10) << __func__ << " " << num << dendl;
@@ -9643,6 +9965,7 @@ int BlueStore::_mount()
     }
   }
   debug_extent_map_encode_check = cct->_conf.get_val<bool>("bluestore_debug_extent_map_encode_check");
+  onode_compact_cache = cct->_conf.get_val<bool>("bluestore_onode_compact_cache");
   _kv_only = false;
   if (cct->_conf->bluestore_fsck_on_mount) {
     int rc = fsck(cct->_conf->bluestore_fsck_on_mount_deep);
@@ -9707,6 +10030,11 @@ int BlueStore::_mount()
 
   mempool_thread.init();
 
+  if (cct->_conf.get_val<double>("bluestore_defrag_interval") > 0) {
+    defrag_enabled = true;
+    defrag_thread.init();
+  }
+
   if ((!per_pool_stat_collection || per_pool_omap != OMAP_PER_PG) &&
     cct->_conf->bluestore_fsck_quick_fix_on_mount == true) {
 
@@ -9733,6 +10061,10 @@ int BlueStore::umount()
 {
   dout(5) << __func__ << dendl;
   ceph_assert(_kv_only || mounted);
+  if (defrag_thread.is_started()) {
+    defrag_thread.shutdown();
+  }
+  defrag_enabled = false;
   _osr_drain_all();
 
   if (bluefs) {
@@ -10777,6 +11109,11 @@ void BlueStore::_fsck_check_objects(
   mempool::bluestore_fsck::list<string> expecting_shards;
   if (it) {
     const size_t thread_count = cct->_conf->bluestore_fsck_quick_fix_threads;
+    fsck_progress.start(
+      depth == FSCK_SHALLOW ? thread_count + 1 : 1, 0);
+    auto finish_progress = make_scope_guard([&] {
+      fsck_progress.finish();
+    });
     typedef ShallowFSCKThreadPool::FSCKWorkQueue<256> WQ;
     std::unique_ptr<WQ> wq(
       new WQ(
@@ -10858,6 +11195,7 @@ void BlueStore::_fsck_check_objects(
         ++errors;
         continue;
       }
+      ++fsck_progress.objects;
       if (!c ||
         oid.shard_id != pgid.shard ||
         oid.hobj.get_logical_pool() != (int64_t)pgid.pool() ||
@@ -13072,6 +13410,7 @@ int BlueStore::_generate_read_result_bl(
   bufferlist& bl)
 {
  // enumerate and decompress desired blobs
+  uint64_t copied = 0; ///< bytes not served from device/cache buffers as-is
   auto p = compressed_blob_bls.begin();
   blobs2read_t::iterator b2r_it = blobs2read.begin();
   while (b2r_it != blobs2read.end()) {
@@ -13102,6 +13441,7 @@ int BlueStore::_generate_read_result_bl(
         for (auto& r : req.regs) {
           ready_regions[r.logical_offset].substr_of(
             raw_bl, r.blob_xoffset, r.length);
+          copied += r.length;
         }
       }
     } else {
@@ -13149,12 +13489,15 @@ int BlueStore::_generate_read_result_bl(
                << ": zeros for 0x" << (pos + offset) << "~" << l
                << std::dec << dendl;
       bl.append_zero(l);
+      copied += l;
       pos += l;
     }
   }
   ceph_assert(bl.length() == length);
   ceph_assert(pos == length);
   ceph_assert(pr == pr_end);
+  logger->inc(l_bluestore_read_zerocopy_bytes, length - copied);
+  logger->inc(l_bluestore_read_copied_bytes, copied);
   return 0;
 }
 
@@ -13202,6 +13545,152 @@ void BlueStore::_measure_static_frag(
   logger->tinc_with_max(l_bluestore_static_frag_lat, finish - start);
 }
 
+void *BlueStore::DefragThread::entry()
+{
+  std::unique_lock l{lock};
+  while (!stop) {
+    auto interval =
+      store->cct->_conf.get_val<double>("bluestore_defrag_interval");
+    cond.wait_for(l, ceph::make_timespan(std::max(interval, 1.0)));
+    if (stop || interval <= 0) {
+      continue;
+    }
+    l.unlock();
+    store->_defrag_round();
+    l.lock();
+  }
+  return nullptr;
+}
+
+void BlueStore::_defrag_round()
+{
+  auto min_score = cct->_conf.get_val<uint64_t>("bluestore_defrag_min_score");
+  uint64_t budget =
+    cct->_conf.get_val<Option::size_t>("bluestore_defrag_max_bytes");
+  auto scan_max = cct->_conf.get_val<uint64_t>("bluestore_defrag_scan_objects");
+
+  // only ever run while nothing else is in flight
+  if (throttle.get_current() > 0) {
+    logger->inc(l_bluestore_defrag_busy);
+    return;
+  }
+  vector<CollectionRef> colls;
+  {
+    std::shared_lock l(coll_lock);
+    colls.reserve(coll_map.size());
+    for (auto& p : coll_map) {
+      colls.push_back(p.second);
+    }
+  }
+  dout(10) << __func__ << " " << colls.size() << " collections, budget 0x"
+	   << std::hex << budget << std::dec << dendl;
+  for (auto& c : colls) {
+    // candidates come from the onode cache only, never from the db
+    vector<OnodeRef> candidates;
+    c->onode_space.map_any([&](Onode* o) {
+      candidates.emplace_back(o);
+      return candidates.size() >= scan_max;
+    });
+    for (auto& o : candidates) {
+      if (budget == 0) {
+	return;
+      }
+      if (throttle.get_current() > 0) {
+	logger->inc(l_bluestore_defrag_busy);
+	return;
+      }
+      budget -= std::min<uint64_t>(budget, _defrag_onode(c, o, min_score));
+    }
+  }
+}
+
+uint64_t BlueStore::_defrag_onode(
+  CollectionRef& c,
+  OnodeRef& o,
+  uint64_t min_score)
+{
+  OpSequencer *osr = c->osr.get();
+  std::lock_guard sl(osr->submit_lock);
+  uint64_t length = 0;
+  uint64_t score = 0;
+  // only the allocated parts are rewritten, holes stay holes
+  std::vector<std::pair<uint64_t, bufferlist>> ranges;
+  {
+    std::shared_lock l(c->lock);
+    if (!o->exists || o->onode.size == 0) {
+      return 0;
+    }
+    o->extent_map.fault_range(db, 0, o->onode.size);
+    interval_set<uint64_t> allocated;
+    for (auto& e : o->extent_map.extent_map) {
+      // rewriting would unshare clones or recompress data, leave it be
+      if (e.blob->get_blob().is_shared() ||
+	  e.blob->get_blob().is_compressed()) {
+	return 0;
+      }
+      allocated.union_insert(e.logical_offset, e.length);
+    }
+    length = allocated.size();
+    if (length == 0 ||
+	length > cct->_conf.get_val<Option::size_t>("bluestore_defrag_max_bytes")) {
+      return 0;
+    }
+    // nor compress what was stored uncompressed
+    WriteContext wctx;
+    _choose_write_options(c, o, 0, &wctx);
+    if (wctx.compress) {
+      return 0;
+    }
+    score = o->get_fragmentation_score();
+    if (score < min_score) {
+      return 0;
+    }
+    // the new extents are allocated before the old ones are released
+    if (alloc->get_free() < length * 2) {
+      return 0;
+    }
+    for (auto [off, len] : allocated) {
+      bufferlist bl;
+      int r = _do_read(c.get(), o, off, len, bl,
+		       CEPH_OSD_OP_FLAG_FADVISE_DONTNEED);
+      if (r < 0 || bl.length() != len) {
+	dout(10) << __func__ << " " << o->oid << " read 0x" << std::hex
+		 << off << "~" << len << std::dec << " failed " << r << dendl;
+	return 0;
+      }
+      ranges.emplace_back(off, std::move(bl));
+    }
+  }
+
+  // submit_lock keeps client txcs out until ours is queued, so what we
+  // read above is still the object content
+  TransContext *txc = _txc_create(c.get(), osr, nullptr);
+  uint64_t new_score;
+  {
+    std::unique_lock l(c->lock);
+    for (auto& [off, bl] : ranges) {
+      int r = _write(txc, c, o, off, bl.length(), bl,
+		     CEPH_OSD_OP_FLAG_FADVISE_DONTNEED);
+      ceph_assert(r == 0);
+    }
+    new_score = o->get_fragmentation_score();
+  }
+  txc->bytes += length;
+  _txc_prepare_kv(txc);
+  _txc_start_throttled(txc, mono_clock::now());
+  logger->inc(l_bluestore_txc);
+  _txc_state_proc(txc);
+
+  dout(10) << __func__ << " " << c->cid << " " << o->oid << " 0x"
+	   << std::hex << length << std::dec << " score " << score
+	   << " -> " << new_score << dendl;
+  logger->inc(l_bluestore_defrag_objects);
+  logger->inc(l_bluestore_defrag_bytes, length);
+  logger->inc(l_bluestore_defrag_score_before, score);
+  logger->inc(l_bluestore_defrag_score_after, new_score);
+  return length;
+}
+
 int BlueStore::_do_read(
   Collection *c,
   OnodeRef& o,
@@ -14767,9 +15256,28 @@ void BlueStore::_txc_state_proc(TransContext *txc)
 	  _txc_apply_kv(txc, true);
 	}
       }
-      {
+      if (auto lane = _kv_lane_for(txc->osr.get()); lane) {
+	std::lock_guard l(lane->lock);
+	lane->queue.push_back(txc);
+	if (!lane->in_progress) {
+	  lane->in_progress = true;
+	  lane->cond.notify_one();
+	}
+	if (txc->get_state() != TransContext::STATE_KV_SUBMITTED) {
+	  lane->queue_unsubmitted.push_back(txc);
+	  ++txc->osr->kv_committing_serially;
+	}
+	if (txc->had_ios)
+	  lane->ios++;
+	lane->throttle_costs += txc->cost;
+	++lane->throttle_txcs;
+	lane->logger->inc(l_bluestore_kv_lane_queued);
+      } else {
 	std::lock_guard l(kv_lock);
 	kv_queue.push_back(txc);
+	if (kv_lane0_logger) {
+	  kv_lane0_logger->inc(l_bluestore_kv_lane_queued);
+	}
 	if (!kv_sync_in_progress) {
 	  kv_sync_in_progress = true;
 	  kv_cond.notify_one();
@@ -15020,6 +15528,9 @@ void BlueStore::_txc_committed_kv(TransContext *txc)
 {
   dout(20) << __func__ << " txc " << txc << dendl;
   throttle.complete_kv(*txc);
+  for (auto& [prefix, start, end] : txc->compact_ranges) {
+    db->compact_range_async(prefix, start, end);
+  }
   {
     std::lock_guard l(txc->osr->qlock);
     txc->set_state(TransContext::STATE_KV_DONE);
@@ -15315,14 +15826,67 @@ void BlueStore::_kv_start()
 {
   dout(10) << __func__ << dendl;
 
+  uint32_t num_lanes = cct->_conf.get_val<uint64_t>("bluestore_kv_sync_lanes");
+  ceph_assert(!kv_lane0_logger);
+  if (num_lanes > 1) {
+    kv_lane0_logger = _create_kv_lane_logger(0);
+  }
+
   finisher.start();
   kv_sync_thread.create("bstore_kv_sync");
   kv_finalize_thread.create("bstore_kv_final");
+
+  ceph_assert(kv_lanes.empty());
+  for (uint32_t i = 1; i < num_lanes; ++i) {
+    auto lane = std::make_unique<KVSyncLane>(this, i);
+    lane->logger = _create_kv_lane_logger(i);
+    lane->create(fmt::format("bstore_kv_l{}", i).c_str());
+    kv_lanes.emplace_back(std::move(lane));
+  }
+  if (!kv_lanes.empty()) {
+    dout(1) << __func__ << " using " << num_lanes << " kv sync lanes" << dendl;
+  }
+}
+
+PerfCounters *BlueStore::_create_kv_lane_logger(uint32_t idx)
+{
+  PerfCountersBuilder b(cct, fmt::format("bluestore-kv-lane-{}", idx),
+			l_bluestore_kv_lane_first, l_bluestore_kv_lane_last);
+  b.add_u64_counter(l_bluestore_kv_lane_txc, "txc",
+		    "Transactions committed by this lane");
+  b.add_u64_counter(l_bluestore_kv_lane_batches, "batches",
+		    "Commit batches (sync kv submits) issued by this lane");
+  b.add_u64(l_bluestore_kv_lane_queued, "queued",
+	    "Transactions queued for this lane");
+  b.add_time_avg(l_bluestore_kv_lane_flush_lat, "flush_lat",
+		 "Average lane flush latency");
+  b.add_time_avg(l_bluestore_kv_lane_commit_lat, "commit_lat",
+		 "Average lane commit latency");
+  b.add_time_avg(l_bluestore_kv_lane_sync_lat, "sync_lat",
+		 "Average lane sync latency");
+  auto l = b.create_perf_counters();
+  cct->get_perfcounters_collection()->add(l);
+  return l;
 }
 
 void BlueStore::_kv_stop()
 {
   dout(10) << __func__ << dendl;
+  // lanes feed kv_finalize_thread, so stop them first
+  for (auto& lane : kv_lanes) {
+    {
+      std::unique_lock l{lane->lock};
+      while (!lane->started) {
+	lane->cond.wait(l);
+      }
+      lane->stop = true;
+      lane->cond.notify_all();
+    }
+    lane->join();
+    cct->get_perfcounters_collection()->remove(lane->logger);
+    delete lane->logger;
+  }
+  kv_lanes.clear();
   {
     std::unique_lock l{kv_lock};
     while (!kv_sync_started) {
@@ -15341,6 +15905,11 @@ void BlueStore::_kv_stop()
   }
   kv_sync_thread.join();
   kv_finalize_thread.join();
+  if (kv_lane0_logger) {
+    cct->get_perfcounters_collection()->remove(kv_lane0_logger);
+    delete kv_lane0_logger;
+    kv_lane0_logger = nullptr;
+  }
   ceph_assert(removed_collections.empty());
   {
     std::lock_guard l(kv_lock);
@@ -15416,6 +15985,9 @@ void BlueStore::_kv_sync_thread()
       kv_ios = 0;
       kv_throttle_costs = 0;
       kv_throttle_txcs = 0;
+      if (kv_lane0_logger) {
+	kv_lane0_logger->dec(l_bluestore_kv_lane_queued, kv_committing.size());
+      }
       l.unlock();
 
       dout(30) << __func__ << " committing " << kv_committing << dendl;
@@ -15472,23 +16044,14 @@ void BlueStore::_kv_sync_thread()
       // it.  in either case, we increase the max in the earlier txn
       // we submit.
       uint64_t new_nid_max = 0, new_blobid_max = 0;
-      if (nid_last + cct->_conf->bluestore_nid_prealloc/2 > nid_max) {
-	KeyValueDB::Transaction t =
-	  kv_submitting.empty() ? synct : kv_submitting.front()->t;
-	new_nid_max = nid_last + cct->_conf->bluestore_nid_prealloc;
-	bufferlist bl;
-	encode(new_nid_max, bl);
-	t->set(PREFIX_SUPER, "nid_max", bl);
-	dout(10) << __func__ << " new_nid_max " << new_nid_max << dendl;
-      }
-      if (blobid_last + cct->_conf->bluestore_blobid_prealloc/2 > blobid_max) {
-	KeyValueDB::Transaction t =
-	  kv_submitting.empty() ? synct : kv_submitting.front()->t;
-	new_blobid_max = blobid_last + cct->_conf->bluestore_blobid_prealloc;
-	bufferlist bl;
-	encode(new_blobid_max, bl);
-	t->set(PREFIX_SUPER, "blobid_max", bl);
-	dout(10) << __func__ << " new_blobid_max " << new_blobid_max << dendl;
+      // other kv sync lanes may race with us; if we raise the limits,
+      // hold the lock until they are durable.
+      std::unique_lock id_l{kv_id_max_lock};
+      _kv_prepare_id_max(
+	kv_submitting.empty() ? synct : kv_submitting.front()->t,
+	&new_nid_max, &new_blobid_max);
+      if (!new_nid_max && !new_blobid_max) {
+	id_l.unlock();
       }
 
       for (auto txc : kv_committing) {
@@ -15561,31 +16124,12 @@ void BlueStore::_kv_sync_thread()
       }
 #endif
 
-      {
-	std::unique_lock m{kv_finalize_lock};
-	if (kv_committing_to_finalize.empty()) {
-	  kv_committing_to_finalize.swap(kv_committing);
-	} else {
-	  kv_committing_to_finalize.insert(
-	      kv_committing_to_finalize.end(),
-	      kv_committing.begin(),
-	      kv_committing.end());
-	  kv_committing.clear();
-	}
-	if (deferred_stable_to_finalize.empty()) {
-	  deferred_stable_to_finalize.swap(deferred_stable);
-	} else {
-	  deferred_stable_to_finalize.insert(
-	      deferred_stable_to_finalize.end(),
-	      deferred_stable.begin(),
-	      deferred_stable.end());
-	  deferred_stable.clear();
-	}
-	if (!kv_finalize_in_progress) {
-	  kv_finalize_in_progress = true;
-	  kv_finalize_cond.notify_one();
-	}
+      logger->inc(l_bluestore_kv_sync_txc, committing_size);
+      if (kv_lane0_logger) {
+	kv_lane0_logger->inc(l_bluestore_kv_lane_txc, committing_size);
+	kv_lane0_logger->inc(l_bluestore_kv_lane_batches);
       }
+      _kv_queue_finalize(kv_committing, deferred_stable);
 
       if (new_nid_max) {
 	nid_max = new_nid_max;
@@ -15595,6 +16139,9 @@ void BlueStore::_kv_sync_thread()
 	blobid_max = new_blobid_max;
 	dout(10) << __func__ << " blobid_max now " << blobid_max << dendl;
       }
+      if (id_l.owns_lock()) {
+	id_l.unlock();
+      }
 
       {
 	auto finish = mono_clock::now();
@@ -15618,6 +16165,11 @@ void BlueStore::_kv_sync_thread()
 	  l_bluestore_kv_sync_lat,
 	  dur,
 	  cct->_conf->bluestore_log_op_age);
+	if (kv_lane0_logger) {
+	  kv_lane0_logger->tinc(l_bluestore_kv_lane_flush_lat, dur_flush);
+	  kv_lane0_logger->tinc(l_bluestore_kv_lane_commit_lat, dur_kv);
+	  kv_lane0_logger->tinc(l_bluestore_kv_lane_sync_lat, dur);
+	}
       }
 
       l.lock();
@@ -15630,6 +16182,159 @@ void BlueStore::_kv_sync_thread()
   kv_sync_started = false;
 }
 
+void BlueStore::_kv_prepare_id_max(
+  KeyValueDB::Transaction t,
+  uint64_t *new_nid_max,
+  uint64_t *new_blobid_max)
+{
+  ceph_assert(ceph_mutex_is_locked(kv_id_max_lock));
+  if (nid_last + cct->_conf->bluestore_nid_prealloc/2 > nid_max) {
+    *new_nid_max = nid_last + cct->_conf->bluestore_nid_prealloc;
+    bufferlist bl;
+    encode(*new_nid_max, bl);
+    t->set(PREFIX_SUPER, "nid_max", bl);
+    dout(10) << __func__ << " new_nid_max " << *new_nid_max << dendl;
+  }
+  if (blobid_last + cct->_conf->bluestore_blobid_prealloc/2 > blobid_max) {
+    *new_blobid_max = blobid_last + cct->_conf->bluestore_blobid_prealloc;
+    bufferlist bl;
+    encode(*new_blobid_max, bl);
+    t->set(PREFIX_SUPER, "blobid_max", bl);
+    dout(10) << __func__ << " new_blobid_max " << *new_blobid_max << dendl;
+  }
+}
+
+void BlueStore::_kv_queue_finalize(
+  deque<TransContext*>& committed,
+  deque<DeferredBatch*>& deferred_stable)
+{
+  std::unique_lock m{kv_finalize_lock};
+  if (kv_committing_to_finalize.empty()) {
+    kv_committing_to_finalize.swap(committed);
+  } else {
+    kv_committing_to_finalize.insert(
+	kv_committing_to_finalize.end(),
+	committed.begin(),
+	committed.end());
+    committed.clear();
+  }
+  if (deferred_stable_to_finalize.empty()) {
+    deferred_stable_to_finalize.swap(deferred_stable);
+  } else {
+    deferred_stable_to_finalize.insert(
+	deferred_stable_to_finalize.end(),
+	deferred_stable.begin(),
+	deferred_stable.end());
+    deferred_stable.clear();
+  }
+  if (!kv_finalize_in_progress) {
+    kv_finalize_in_progress = true;
+    kv_finalize_cond.notify_one();
+  }
+}
+
+void BlueStore::_kv_lane_thread(KVSyncLane *lane)
+{
+  dout(10) << __func__ << " lane " << lane->idx << " start" << dendl;
+  std::unique_lock l{lane->lock};
+  ceph_assert(!lane->started);
+  lane->started = true;
+  lane->cond.notify_all();
+
+  while (true) {
+    if (lane->queue.empty()) {
+      if (lane->stop)
+	break;
+      dout(20) << __func__ << " lane " << lane->idx << " sleep" << dendl;
+      lane->in_progress = false;
+      lane->cond.wait(l);
+      dout(20) << __func__ << " lane " << lane->idx << " wake" << dendl;
+      continue;
+    }
+    deque<TransContext*> committing, submitting;
+    deque<DeferredBatch*> no_deferred;
+    committing.swap(lane->queue);
+    submitting.swap(lane->queue_unsubmitted);
+    uint64_t aios = lane->ios;
+    uint64_t costs = lane->throttle_costs;
+    uint64_t txcs = lane->throttle_txcs;
+    lane->ios = 0;
+    lane->throttle_costs = 0;
+    lane->throttle_txcs = 0;
+    lane->logger->dec(l_bluestore_kv_lane_queued, committing.size());
+    l.unlock();
+
+    dout(20) << __func__ << " lane " << lane->idx
+	     << " committing " << committing.size()
+	     << " submitting " << submitting.size() << dendl;
+
+    auto start = mono_clock::now();
+    // data must be stable before the metadata referencing it.  deferred
+    // ios are left to kv_sync_thread, which owns the done->stable cycle.
+    if (aios) {
+      bdev->flush();
+    }
+    auto after_flush = mono_clock::now();
+
+    KeyValueDB::Transaction synct = db->get_transaction();
+    uint64_t new_nid_max = 0, new_blobid_max = 0;
+    std::unique_lock id_l{kv_id_max_lock};
+    _kv_prepare_id_max(
+      submitting.empty() ? synct : submitting.front()->t,
+      &new_nid_max, &new_blobid_max);
+    if (!new_nid_max && !new_blobid_max) {
+      id_l.unlock();
+    }
+
+    for (auto txc : committing) {
+      throttle.log_state_latency(*txc, logger, l_bluestore_state_kv_queued_lat);
+      if (txc->get_state() == TransContext::STATE_KV_QUEUED) {
+	_txc_apply_kv(txc, false);
+	--txc->osr->kv_committing_serially;
+      } else {
+	ceph_assert(txc->get_state() == TransContext::STATE_KV_SUBMITTED);
+      }
+      if (txc->had_ios) {
+	--txc->osr->txc_with_unstable_io;
+      }
+    }
+    throttle.release_kv_throttle(costs, txcs);
+
+    int r = db_was_opened_read_only || cct->_conf->bluestore_debug_omit_kv_commit ?
+      0 : db->submit_transaction_sync(synct);
+    ceph_assert(r == 0);
+
+    if (new_nid_max) {
+      nid_max = new_nid_max;
+      dout(10) << __func__ << " nid_max now " << nid_max << dendl;
+    }
+    if (new_blobid_max) {
+      blobid_max = new_blobid_max;
+      dout(10) << __func__ << " blobid_max now " << blobid_max << dendl;
+    }
+    if (id_l.owns_lock()) {
+      id_l.unlock();
+    }
+
+    size_t committing_size = committing.size();
+    _kv_queue_finalize(committing, no_deferred);
+
+    auto finish = mono_clock::now();
+    lane->logger->inc(l_bluestore_kv_lane_txc, committing_size);
+    lane->logger->inc(l_bluestore_kv_lane_batches);
+    lane->logger->tinc(l_bluestore_kv_lane_flush_lat, after_flush - start);
+    lane->logger->tinc(l_bluestore_kv_lane_commit_lat, finish - after_flush);
+    lane->logger->tinc(l_bluestore_kv_lane_sync_lat, finish - start);
+    dout(20) << __func__ << " lane " << lane->idx
+	     << " committed " << committing_size
+	     << " in " << (finish - start) << dendl;
+
+    l.lock();
+  }
+  dout(10) << __func__ << " lane " << lane->idx << " finish" << dendl;
+  lane->started = false;
+}
+
 void BlueStore::_kv_finalize_thread()
 {
   deque<TransContext*> kv_committed;
@@ -15770,6 +16475,14 @@ void BlueStore::deferred_try_submit()
     }
   }
 
+  if (osrs.size() > 1 &&
+      cct->_conf.get_val<bool>("bluestore_deferred_coalesce")) {
+    _deferred_submit_coalesced(osrs);
+    std::lock_guard l(deferred_lock);
+    deferred_last_submitted = ceph_clock_now();
+    return;
+  }
+
   for (auto& osr : osrs) {
     osr->deferred_lock.lock();
     if (osr->deferred_pending) {
@@ -15812,23 +16525,33 @@ void BlueStore::_deferred_submit_unlock(OpSequencer *osr)
   for (auto& txc : b->txcs) {
     throttle.log_state_latency(txc, logger, l_bluestore_state_deferred_queued_lat);
   }
+  _deferred_prepare_aios(b->iomap, &b->ioc);
+  bdev->aio_submit(&b->ioc);
+}
+
+unsigned BlueStore::_deferred_prepare_aios(
+  map<uint64_t,DeferredBatch::deferred_io>& iomap,
+  IOContext *ioc)
+{
+  unsigned ios = 0;
   uint64_t start = 0, pos = 0;
   bufferlist bl;
-  auto i = b->iomap.begin();
+  auto i = iomap.begin();
   while (true) {
-    if (i == b->iomap.end() || i->first != pos) {
+    if (i == iomap.end() || i->first != pos) {
       if (bl.length()) {
 	dout(20) << __func__ << " write 0x" << std::hex
 		 << start << "~" << bl.length()
 		 << " crc " << bl.crc32c(-1) << std::dec << dendl;
+	++ios;
 	if (!g_conf()->bluestore_debug_omit_block_device_write) {
 	  logger->inc(l_bluestore_submitted_deferred_writes);
 	  logger->inc(l_bluestore_submitted_deferred_write_bytes, bl.length());
-	  int r = bdev->aio_write(start, bl, &b->ioc, false);
+	  int r = bdev->aio_write(start, bl, ioc, false);
 	  ceph_assert(r == 0);
 	}
       }
-      if (i == b->iomap.end()) {
+      if (i == iomap.end()) {
 	break;
       }
       start = 0;
@@ -15845,8 +16568,92 @@ void BlueStore::_deferred_submit_unlock(OpSequencer *osr)
     bl.claim_append(i->second.bl);
     ++i;
   }
+  return ios;
+}
 
-  bdev->aio_submit(&b->ioc);
+static unsigned count_deferred_runs(
+  const map<uint64_t,BlueStore::DeferredBatch::deferred_io>& iomap)
+{
+  unsigned runs = 0;
+  uint64_t pos = 0;
+  for (auto& [off, io] : iomap) {
+    if (runs == 0 || off != pos) {
+      ++runs;
+    }
+    pos = off + io.bl.length();
+  }
+  return runs;
+}
+
+static bool deferred_iomap_overlaps(
+  const map<uint64_t,BlueStore::DeferredBatch::deferred_io>& a,
+  const map<uint64_t,BlueStore::DeferredBatch::deferred_io>& b)
+{
+  for (auto& [off, io] : b) {
+    auto p = a.lower_bound(off);
+    if (p != a.end() && p->first < off + io.bl.length()) {
+      return true;
+    }
+    if (p != a.begin()) {
+      --p;
+      if (p->first + p->second.bl.length() > off) {
+	return true;
+      }
+    }
+  }
+  return false;
+}
+
+void BlueStore::_deferred_submit_coalesced(vector<OpSequencerRef>& osrs)
+{
+  // take every pending batch that may be started now, then merge their
+  // ios by device offset so that adjacent writes from different
+  // sequencers become a single aio and the rest go out in lba order.
+  auto g = new DeferredGroup(cct);
+  map<uint64_t,DeferredBatch::deferred_io> iomap;
+  unsigned ios_in = 0;
+  for (auto& osr : osrs) {
+    osr->deferred_lock.lock();
+    if (!osr->deferred_pending || osr->deferred_running) {
+      osr->deferred_lock.unlock();
+      dout(20) << __func__ << "  osr " << osr << " has no pending or running"
+	       << dendl;
+      continue;
+    }
+    auto b = osr->deferred_pending;
+    deferred_queue_size -= b->txcs.size();
+    ceph_assert(deferred_queue_size >= 0);
+    osr->deferred_running = b;
+    osr->deferred_pending = nullptr;
+    osr->deferred_lock.unlock();
+
+    for (auto& txc : b->txcs) {
+      throttle.log_state_latency(txc, logger, l_bluestore_state_deferred_queued_lat);
+    }
+    if (deferred_iomap_overlaps(iomap, b->iomap)) {
+      // can't tell which write wins across sequencers, submit it on its own
+      dout(20) << __func__ << "  osr " << osr << " overlaps, not coalescing"
+	       << dendl;
+      _deferred_prepare_aios(b->iomap, &b->ioc);
+      bdev->aio_submit(&b->ioc);
+      continue;
+    }
+    ios_in += count_deferred_runs(b->iomap);
+    iomap.merge(b->iomap);
+    ceph_assert(b->iomap.empty());
+    g->osrs.push_back(osr.get());
+  }
+  if (g->osrs.empty()) {
+    delete g;
+    return;
+  }
+  unsigned ios_out = _deferred_prepare_aios(iomap, &g->ioc);
+  dout(10) << __func__ << " " << g->osrs.size() << " osrs, " << ios_in
+	   << " ios coalesced into " << ios_out << dendl;
+  logger->inc(l_bluestore_deferred_coalesce_groups);
+  logger->inc(l_bluestore_deferred_coalesce_ios_in, ios_in);
+  logger->inc(l_bluestore_deferred_coalesce_ios_out, ios_out);
+  bdev->aio_submit(&g->ioc);
 }
 
 struct C_DeferredTrySubmit : public Context {
@@ -16062,6 +16869,11 @@ int BlueStore::queue_transactions(
   Collection *c = static_cast<Collection*>(ch.get());
   OpSequencer *osr = c->osr.get();
   dout(10) << __func__ << " ch " << c << " " << c->cid << dendl;
+  // only the defragmenter submits behind our back
+  std::unique_lock sl(osr->submit_lock, std::defer_lock);
+  if (defrag_enabled) {
+    sl.lock();
+  }
 
   // prepare
   TransContext *txc = _txc_create(static_cast<Collection*>(ch.get()), osr,
@@ -16071,21 +16883,7 @@ int BlueStore::queue_transactions(
     txc->bytes += (*p).get_num_bytes();
     _txc_add_transaction(txc, &(*p));
   }
-  _txc_calc_cost(txc);
-
-  _txc_write_nodes(txc, txc->t);
-
-  // journal deferred items
-  if (txc->deferred_txn) {
-    txc->deferred_txn->seq = ++deferred_seq;
-    bufferlist bl;
-    encode(*txc->deferred_txn, bl);
-    string key;
-    get_deferred_key(txc->deferred_txn->seq, &key);
-    txc->t->set(PREFIX_DEFERRED, key, bl);
-  }
-
-  _txc_finalize_kv(txc, txc->t);
+  _txc_prepare_kv(txc);
 
 #ifdef WITH_BLKIN
   if (txc->trace) {
@@ -16097,27 +16895,7 @@ int BlueStore::queue_transactions(
     handle->suspend_tp_timeout();
 
   auto tstart = mono_clock::now();
-
-  if (!throttle.try_start_transaction(
-	*db,
-	*txc,
-	tstart)) {
-    // ensure we do not block here because of deferred writes
-    dout(10) << __func__ << " failed get throttle_deferred_bytes, aggressive"
-	     << dendl;
-    ++deferred_aggressive;
-    deferred_try_submit();
-    {
-      // wake up any previously finished deferred events
-      std::lock_guard l(kv_lock);
-      if (!kv_sync_in_progress) {
-	kv_sync_in_progress = true;
-	kv_cond.notify_one();
-      }
-    }
-    throttle.finish_start_transaction(*db, *txc, tstart);
-    --deferred_aggressive;
-  }
+  _txc_start_throttled(txc, tstart);
   auto tend = mono_clock::now();
 
   if (handle)
@@ -16127,6 +16905,9 @@ int BlueStore::queue_transactions(
 
   // execute (start)
   _txc_state_proc(txc);
+  if (sl.owns_lock()) {
+    sl.unlock();
+  }
 
   // we're immediately readable (unlike FileStore)
   for (auto c : on_applied_sync) {
@@ -16157,6 +16938,51 @@ int BlueStore::queue_transactions(
   return 0;
 }
 
+void BlueStore::_txc_prepare_kv(TransContext *txc)
+{
+  _txc_calc_cost(txc);
+
+  _txc_write_nodes(txc, txc->t);
+
+  // journal deferred items
+  if (txc->deferred_txn) {
+    txc->deferred_txn->seq = ++deferred_seq;
+    bufferlist bl;
+    encode(*txc->deferred_txn, bl);
+    string key;
+    get_deferred_key(txc->deferred_txn->seq, &key);
+    txc->t->set(PREFIX_DEFERRED, key, bl);
+  }
+
+  _txc_finalize_kv(txc, txc->t);
+}
+
+void BlueStore::_txc_start_throttled(
+  TransContext *txc,
+  mono_clock::time_point tstart)
+{
+  if (!throttle.try_start_transaction(
+	*db,
+	*txc,
+	tstart)) {
+    // ensure we do not block here because of deferred writes
+    dout(10) << __func__ << " failed get throttle_deferred_bytes, aggressive"
+	     << dendl;
+    ++deferred_aggressive;
+    deferred_try_submit();
+    {
+      // wake up any previously finished deferred events
+      std::lock_guard l(kv_lock);
+      if (!kv_sync_in_progress) {
+	kv_sync_in_progress = true;
+	kv_cond.notify_one();
+      }
+    }
+    throttle.finish_start_transaction(*db, *txc, tstart);
+    --deferred_aggressive;
+  }
+}
+
 void BlueStore::_txc_aio_submit(TransContext *txc)
 {
   dout(10) << __func__ << " txc " << txc << dendl;
@@ -16211,6 +17037,15 @@ void BlueStore::_txc_add_transaction(TransContext *txc, Transaction *t)
       }
       break;
 
+    case Transaction::OP_DESTROY_COLLECTION:
+      {
+        const coll_t &cid = i.get_cid(op->cid);
+	r = _destroy_collection(txc, cid, &c);
+	if (!r)
+	  continue;
+      }
+      break;
+
     case Transaction::OP_MKCOLL:
       {
 	ceph_assert(!c);
@@ -18308,28 +19143,39 @@ int BlueStore::_truncate(TransContext *txc,
 int BlueStore::_do_remove(
   TransContext *txc,
   CollectionRef& c,
-  OnodeRef& o)
+  OnodeRef& o,
+  bool keys_range_deleted,
+  bool omap_range_deleted)
 {
   set<SharedBlob*> maybe_unshared_blobs;
   bool is_gen = !o->oid.is_no_gen();
   bool is_snap = o->oid.hobj.is_snap();
-  _do_truncate(txc, c, o, 0, (is_gen || is_snap) ? &maybe_unshared_blobs : nullptr);
+  // when the whole collection goes, the head goes too: nothing to unshare
+  bool unshare = (is_gen || is_snap) && !keys_range_deleted;
+  _do_truncate(txc, c, o, 0, unshare ? &maybe_unshared_blobs : nullptr);
   if (o->onode.has_omap()) {
     o->flush();
-    _do_omap_clear(txc, o);
+    if (omap_range_deleted && o->onode.is_perpg_omap() &&
+	!o->onode.is_pgmeta_omap()) {
+      o->onode.clear_omap_flag();
+    } else {
+      _do_omap_clear(txc, o);
+    }
   }
   o->exists = false;
-  string key;
-  for (auto &s : o->extent_map.shards) {
-    dout(20) << __func__ << "  removing shard 0x" << std::hex
-	     << s.shard_info->offset << std::dec << dendl;
-    generate_extent_shard_key_and_apply(o->key, s.shard_info->offset, &key,
-      [&](const string& final_key) {
-        txc->t->rmkey(PREFIX_OBJ, final_key);
-      }
-    );
+  if (!keys_range_deleted) {
+    string key;
+    for (auto &s : o->extent_map.shards) {
+      dout(20) << __func__ << "  removing shard 0x" << std::hex
+	       << s.shard_info->offset << std::dec << dendl;
+      generate_extent_shard_key_and_apply(o->key, s.shard_info->offset, &key,
+        [&](const string& final_key) {
+          txc->t->rmkey(PREFIX_OBJ, final_key);
+        }
+      );
+    }
+    txc->t->rmkey(PREFIX_OBJ, o->key.c_str(), o->key.size());
   }
-  txc->t->rmkey(PREFIX_OBJ, o->key.c_str(), o->key.size());
   txc->note_removed_object(o);
   o->extent_map.clear();
   o->onode = bluestore_onode_t();
@@ -18355,6 +19201,28 @@ int BlueStore::_do_remove(
   return 0;
 }
 
+void BlueStore::_do_destroy_onode(
+  TransContext *txc,
+  CollectionRef& c,
+  OnodeRef& o,
+  bool omap_range_deleted)
+{
+  // o is not in the onode cache and its keys are range-deleted by the
+  // caller, only its space and non per-pg omap have to go
+  dout(20) << __func__ << " " << c->cid << " " << o->oid << dendl;
+  WriteContext wctx;
+  o->extent_map.fault_range(db, 0, o->onode.size);
+  o->extent_map.punch_hole(c, 0, o->onode.size, &wctx.old_extents);
+  _wctx_finish(txc, c, o, &wctx);
+  if (o->onode.has_omap() &&
+      !(omap_range_deleted && o->onode.is_perpg_omap() &&
+	!o->onode.is_pgmeta_omap())) {
+    _do_omap_clear(txc, o);
+  }
+  o->exists = false;
+  _debug_obj_on_delete(o->oid);
+}
+
 int BlueStore::_maybe_unshare_on_remove(
   TransContext *txc,
   CollectionRef& c,
@@ -19092,6 +19960,136 @@ void BlueStore::_do_remove_collection(TransContext *txc,
   c->reset();
 }
 
+int BlueStore::_destroy_collection(TransContext *txc, const coll_t &cid,
+				   CollectionRef *c)
+{
+  dout(15) << __func__ << " " << cid << dendl;
+  if (!*c) {
+    dout(10) << __func__ << " " << cid << " = " << -ENOENT << dendl;
+    return -ENOENT;
+  }
+  auto start_time = mono_clock::now();
+  (*c)->flush_all_but_last();
+
+  // Objects of a pg live in a contiguous range of onode and per-pg omap
+  // keys, drop these with range deletions instead of a tombstone per key.
+  // Per-pg omap keys carry no shard, so the omap range of an EC shard is
+  // shared with the other shards of the pg on this OSD: clear it per
+  // object instead.
+  spg_t pgid;
+  bool bulk = (*c)->cid.is_pg(&pgid);
+  bool bulk_omap = bulk && pgid.shard == shard_id_t::NO_SHARD;
+  vector<pair<string, string>> obj_ranges;
+  pair<string, string> omap_range;
+  if (bulk) {
+    get_pg_key_ranges(pgid, (*c)->cnode.bits, &obj_ranges, &omap_range);
+  }
+  uint64_t num = 0;
+  int r = 0;
+  {
+    std::unique_lock l((*c)->lock);
+    auto remove = [&](const ghobject_t& oid) {
+      OnodeRef o = (*c)->get_onode(oid, false);
+      if (o && o->exists) {
+	_do_remove(txc, *c, o, bulk, bulk_omap);
+	++num;
+      }
+    };
+    // cached onodes may carry state of transactions that are not committed
+    // yet (including removal), handle them the regular way
+    set<ghobject_t> cached;
+    (*c)->onode_space.map_any([&](Onode* o) {
+      cached.insert(o->oid);
+      return false;
+    });
+    for (auto& oid : cached) {
+      remove(oid);
+    }
+    if (bulk) {
+      // everything else is released straight from the db, one onode at a
+      // time and without going through the onode cache, so destroying a
+      // large pg does not pin its onodes and extents in memory
+      for (auto& [start, end] : obj_ranges) {
+	auto it = db->get_iterator(PREFIX_OBJ, KeyValueDB::ITERATOR_NOCACHE);
+	for (it->lower_bound(start); it->valid() && it->key() < end;
+	     it->next()) {
+	  if (is_extent_shard_key(it->key())) {
+	    continue;
+	  }
+	  ghobject_t oid;
+	  if (get_key_object(it->key(), &oid) < 0 || cached.count(oid)) {
+	    continue;
+	  }
+	  OnodeRef o(Onode::create_decode(*c, oid, it->key(), it->value(),
+					  false, segment_size != 0));
+	  _do_destroy_onode(txc, *c, o, bulk_omap);
+	  ++num;
+	}
+      }
+    } else {
+      // removed onodes are pinned by txc->modified_objects, so that
+      // listing does not find them again
+      vector<ghobject_t> ls;
+      ghobject_t next;
+      while (!next.is_max()) {
+	ls.clear();
+	r = _collection_list(c->get(), next, ghobject_t::get_max(),
+			     get_ideal_list_max(), false, &ls, &next);
+	if (r < 0) {
+	  break;
+	}
+	for (auto& oid : ls) {
+	  remove(oid);
+	}
+      }
+    }
+  }
+  if (r >= 0) {
+    if (bulk) {
+      bool compact =
+	cct->_conf.get_val<bool>("bluestore_destroy_collection_compact");
+      for (auto& [start, end] : obj_ranges) {
+	dout(20) << __func__ << " remove range start: "
+		 << pretty_binary_string(start) << " end: "
+		 << pretty_binary_string(end) << dendl;
+	txc->t->rm_range_keys_bulk(PREFIX_OBJ, start, end);
+	if (compact) {
+	  txc->compact_ranges.emplace_back(PREFIX_OBJ, start, end);
+	}
+      }
+      if (bulk_omap) {
+	txc->t->rm_range_keys_bulk(PREFIX_PERPG_OMAP,
+				   omap_range.first, omap_range.second);
+	if (compact) {
+	  txc->compact_ranges.emplace_back(PREFIX_PERPG_OMAP,
+					   omap_range.first, omap_range.second);
+	}
+      }
+      logger->inc(l_bluestore_destroy_coll_range_deletes,
+		  obj_ranges.size() + (bulk_omap ? 1 : 0));
+    }
+    std::unique_lock l(coll_lock);
+    _do_remove_collection(txc, c);
+  }
+  logger->inc(l_bluestore_destroy_coll_objects, num);
+  log_latency_fn(
+    __func__,
+    l_bluestore_destroy_coll_lat,
+    mono_clock::now() - start_time,
+    cct->_conf->bluestore_log_op_age,
+    [&](const ceph::timespan& lat) {
+      ostringstream ostr;
+      ostr << ", lat = " << timespan_str(lat)
+	   << " cid =" << cid
+	   << " objects =" << num;
+      return ostr.str();
+    }
+  );
+  dout(10) << __func__ << " " << cid << " removed " << num << " objects"
+	   << " = " << r << dendl;
+  return r;
+}
+
 int BlueStore::_split_collection(TransContext *txc,
 				CollectionRef& c,
 				CollectionRef& d,
@@ -20919,8 +21917,35 @@ void BlueStore::ExtentDecoderPartial::reset(const ghobject_t _oid,
   std::swap(spanning_blobs, empty2);
 }
 
+void BlueStore::scan_progress_t::start(uint32_t _threads, uint32_t _chunks)
+{
+  threads = _threads;
+  chunks_total = _chunks;
+  chunks_done = 0;
+  objects = 0;
+  started = ceph::mono_clock::now();
+  running = true;
+}
+
+void BlueStore::scan_progress_t::dump(ceph::Formatter *f) const
+{
+  auto elapsed = ceph::to_seconds<double>(ceph::mono_clock::now() - started.load());
+  uint64_t n = objects;
+  f->dump_bool("running", running);
+  f->dump_unsigned("threads", threads);
+  f->dump_unsigned("chunks_total", chunks_total);
+  f->dump_unsigned("chunks_done", chunks_done);
+  f->dump_unsigned("objects", n);
+  f->dump_float("elapsed", elapsed);
+  f->dump_float("objects_per_sec", elapsed > 0 ? n / elapsed : 0);
+}
+
 int BlueStore::read_allocation_from_onodes(SimpleBitmap *sbmap, read_alloc_stats_t& stats)
 {
+  alloc_recovery_progress.start(1, 0);
+  auto finish_progress = make_scope_guard([&] {
+    alloc_recovery_progress.finish();
+  });
   sb_info_space_efficient_map_t sb_info;
   // iterate over all shared blobs
   auto it = db->get_iterator(PREFIX_SHARED_BLOB, KeyValueDB::ITERATOR_NOCACHE);
@@ -21002,6 +22027,7 @@ int BlueStore::read_allocation_from_onodes(SimpleBitmap *sbmap, read_alloc_stats
         edecoder,
         segment_size != 0);
       ++stats.onode_count;
+      ++alloc_recovery_progress.objects;
     } else {
       uint32_t offset;
       int r = get_key_extent_shard(key, &okey, &offset);
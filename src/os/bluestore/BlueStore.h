@@ -126,6 +126,8 @@ enum {
   l_bluestore_read_eio,
   l_bluestore_reads_with_retries,
   l_bluestore_read_lat,
+  l_bluestore_read_zerocopy_bytes,
+  l_bluestore_read_copied_bytes,
   //****************************************
 
   // kv_thread latencies
@@ -134,6 +136,7 @@ enum {
   l_bluestore_kv_commit_lat,
   l_bluestore_kv_sync_lat,
   l_bluestore_kv_final_lat,
+  l_bluestore_kv_sync_txc,
   //****************************************
 
   // write op stats
@@ -157,6 +160,9 @@ enum {
   l_bluestore_issued_deferred_write_bytes,
   l_bluestore_submitted_deferred_writes,
   l_bluestore_submitted_deferred_write_bytes,
+  l_bluestore_deferred_coalesce_groups,
+  l_bluestore_deferred_coalesce_ios_in,
+  l_bluestore_deferred_coalesce_ios_out,
 
   l_bluestore_write_big_skipped_blobs,
   l_bluestore_write_big_skipped_bytes,
@@ -181,8 +187,11 @@ enum {
   l_bluestore_pinned_onodes,
   l_bluestore_onode_hits,
   l_bluestore_onode_misses,
+  l_bluestore_onode_lockless_hits,
   l_bluestore_onode_shard_hits,
   l_bluestore_onode_shard_misses,
+  l_bluestore_onode_shard_compact_hits,
+  l_bluestore_onode_shard_compacted,
   l_bluestore_extents,
   l_bluestore_blobs,
   l_bluestore_spanning_blobs,
@@ -227,6 +236,9 @@ enum {
   l_bluestore_clist_lat,
   l_bluestore_remove_lat,
   l_bluestore_truncate_lat,
+  l_bluestore_destroy_coll_lat,
+  l_bluestore_destroy_coll_objects,
+  l_bluestore_destroy_coll_range_deletes,
   //****************************************
 
   // allocation stats
@@ -249,10 +261,27 @@ enum {
   //****************************************
   l_bluestore_runtime_frag_lat,
   l_bluestore_static_frag_lat,
+  l_bluestore_defrag_objects,
+  l_bluestore_defrag_bytes,
+  l_bluestore_defrag_score_before,
+  l_bluestore_defrag_score_after,
+  l_bluestore_defrag_busy,
   //****************************************
   l_bluestore_last
 };
 
+// per kv sync lane counters, see bluestore_kv_sync_lanes
+enum {
+  l_bluestore_kv_lane_first = 732900,
+  l_bluestore_kv_lane_txc,
+  l_bluestore_kv_lane_batches,
+  l_bluestore_kv_lane_queued,
+  l_bluestore_kv_lane_flush_lat,
+  l_bluestore_kv_lane_commit_lat,
+  l_bluestore_kv_lane_sync_lat,
+  l_bluestore_kv_lane_last
+};
+
 #define META_POOL_ID ((uint64_t)-1ull)
 using bptr_c_it_t = buffer::ptr::const_iterator;
 
@@ -972,6 +1001,9 @@ public:
       unsigned extents = 0;  ///< count extents in this shard
       bool loaded = false;   ///< true if shard is loaded
       bool dirty = false;    ///< true if shard is dirty and needs reencoding
+      /// encoded shard as stored in kv, kept while clean when
+      /// bluestore_onode_compact_cache is enabled; empty otherwise
+      ceph::buffer::list encoded;
     };
 
     mempool::bluestore_cache_meta::vector<Shard> shards;    ///< shards
@@ -1187,6 +1219,8 @@ public:
     /// ensure that a range of the map is loaded
     void fault_range(KeyValueDB *db,
 		     uint32_t offset, uint32_t length);
+    /// unload clean shards that have a cached encoded form
+    unsigned compact_clean_shards();
     /// ensure that a range of the map is loaded
     /// return range that is encompassed by affected shards
     std::pair<uint32_t, uint32_t> fault_range_ex(
@@ -1458,6 +1492,9 @@ public:
     void flush();
     void get();
     void put();
+    /// drop decoded extents/blobs of clean shards, caller must have
+    /// exclusive access (unpinned and unpublished from its OnodeSpace)
+    bool compact();
 
     inline bool is_cached() const {
       return cached;
@@ -1685,14 +1722,47 @@ public:
     /// forward lookups
     mempool::bluestore_cache_meta::unordered_map<ghobject_t,OnodeRef> onode_map;
 
+    /// lock-free lookup table for cached onodes, indexed by oid hash.
+    /// Slots hold unowned pointers to onodes present in onode_map.
+    /// Writers hold cache->lock and never wait for readers: an onode that
+    /// leaves onode_map is kept alive on the retired lists until readers
+    /// that may have loaded its pointer are gone, see _reclaim().
+    mempool::bluestore_cache_meta::vector<std::atomic<Onode*>> fast_slots;
+    std::atomic<uint64_t> rcu_epoch = {0};
+    std::atomic<int32_t> rcu_readers[2] = {0, 0};
+    std::vector<Onode*> retired;      ///< dropped since the last epoch flip
+    std::vector<Onode*> retired_prev; ///< dropped before the last flip
+
     friend struct Collection; // for split_cache()
     friend struct Onode; // for put()
     friend struct LruOnodeCacheShard;
     void _remove(const ghobject_t& oid);
+
+    std::atomic<Onode*>& _fast_slot(const ghobject_t& oid) {
+      return fast_slots[std::hash<ghobject_t>()(oid) & (fast_slots.size() - 1)];
+    }
+    void _publish(Onode* o) {
+      if (!fast_slots.empty()) {
+	_fast_slot(o->oid).store(o);
+      }
+    }
+    void _unpublish(Onode* o);
+    void _unpublish_all();
+    int _rcu_read_lock();
+    void _rcu_read_unlock(int idx) {
+      --rcu_readers[idx];
+    }
+    void _retire(Onode* o);
+    void _reclaim();
+    static void _free_retired(std::vector<Onode*>& v);
+    OnodeRef _lookup_lockless(const ghobject_t& oid);
   public:
-    OnodeSpace(OnodeCacheShard *c) : cache(c) {}
+    OnodeSpace(OnodeCacheShard *c);
     ~OnodeSpace() {
       clear();
+      // no readers left, the collection is going away
+      _free_retired(retired_prev);
+      _free_retired(retired);
     }
 
     OnodeRef add_onode(const ghobject_t& oid, OnodeRef& o);
@@ -1981,6 +2051,8 @@ public:
     KeyValueDB::Transaction t; ///< then we will commit this
     std::list<Context*> oncommits;  ///< more commit completions
     std::list<CollectionRef> removed_collections; ///< colls we removed
+    /// (prefix, start, end) key ranges to compact once committed
+    std::vector<std::tuple<std::string, std::string, std::string>> compact_ranges;
 
     boost::intrusive::list_member_hook<> deferred_queue_item;
     bluestore_deferred_transaction_t *deferred_txn = nullptr; ///< if any
@@ -2228,6 +2300,23 @@ public:
     }
   };
 
+  /// running DeferredBatches of several OpSequencers, submitted together
+  /// as offset-sorted, coalesced aios (see bluestore_deferred_coalesce)
+  struct DeferredGroup final : public AioContext {
+    std::vector<OpSequencer*> osrs;  ///< their deferred_running batches
+    IOContext ioc;                   ///< our aios
+
+    explicit DeferredGroup(CephContext *cct)
+      : ioc(cct, this) {}
+
+    void aio_finish(BlueStore *store) override {
+      for (auto osr : osrs) {
+	store->_deferred_aio_finish(osr);
+      }
+      delete this;
+    }
+  };
+
   class OpSequencer : public RefCountedObject {
   public:
     ceph::mutex qlock = ceph::make_mutex("BlueStore::OpSequencer::qlock");
@@ -2247,6 +2336,10 @@ public:
 
     ceph::mutex deferred_lock = ceph::make_mutex("BlueStore::OpSequencer::deferred_lock");
 
+    /// serializes txc creation and submission on this sequencer between
+    /// queue_transactions() and internal submitters (the defragmenter)
+    ceph::mutex submit_lock = ceph::make_mutex("BlueStore::OpSequencer::submit_lock");
+
     BlueStore *store;
     coll_t cid;
 
@@ -2383,6 +2476,31 @@ public:
     }
   };
 
+  /// additional kv sync pipeline, see bluestore_kv_sync_lanes.  Each
+  /// OpSequencer is bound to exactly one lane, so per-sequencer commit
+  /// order is preserved; deferred io cleanup stays with kv_sync_thread.
+  struct KVSyncLane : public Thread {
+    BlueStore *store;
+    const uint32_t idx;
+    ceph::mutex lock = ceph::make_mutex("BlueStore::KVSyncLane::lock");
+    ceph::condition_variable cond;
+    bool started = false;
+    bool stop = false;
+    bool in_progress = false;
+    std::deque<TransContext*> queue;             ///< ready, already submitted
+    std::deque<TransContext*> queue_unsubmitted; ///< ready, need submit by lane
+    uint64_t ios = 0;
+    uint64_t throttle_costs = 0;
+    uint64_t throttle_txcs = 0;
+    PerfCounters *logger = nullptr;
+
+    KVSyncLane(BlueStore *s, uint32_t i) : store(s), idx(i) {}
+    void *entry() override {
+      store->_kv_lane_thread(this);
+      return NULL;
+    }
+  };
+
   struct BigDeferredWriteContext {
     uint64_t off = 0;     // original logical offset
     uint32_t b_off = 0;   // blob relative offset
@@ -2484,6 +2602,13 @@ private:
   std::deque<DeferredBatch*> deferred_stable_to_finalize; ///< pending finalization
   bool kv_finalize_in_progress = false;
 
+  /// lanes 1..N-1; lane 0 is kv_sync_thread itself
+  std::vector<std::unique_ptr<KVSyncLane>> kv_lanes;
+  /// per-lane counters of kv_sync_thread, only if there are other lanes
+  PerfCounters *kv_lane0_logger = nullptr;
+  /// serializes persisting of nid_max/blobid_max across kv sync lanes
+  ceph::mutex kv_id_max_lock = ceph::make_mutex("BlueStore::kv_id_max_lock");
+
   PerfCounters *logger = nullptr;
 
   std::list<CollectionRef> removed_collections;
@@ -2509,6 +2634,7 @@ private:
   bool elastic_shared_blobs = false; ///< use smart ExtentMap::dup to reduce shared blob count
   bool use_write_v2 = false; ///< use new write path
   bool debug_extent_map_encode_check = false;
+  bool onode_compact_cache = false; ///< keep encoded shards, unload cold ones
 
   enum {
     // Please preserve the order since it's DB persistent
@@ -2602,6 +2728,9 @@ private:
     std::shared_ptr<PriorityCache::PriCache> binned_kv_cache = nullptr;
     std::shared_ptr<PriorityCache::PriCache> binned_kv_onode_cache = nullptr;
     std::shared_ptr<PriorityCache::Manager> pcm = nullptr;
+    /// caches of our user sized along with ours, protected by lock
+    std::map<std::string, std::shared_ptr<PriorityCache::PriCache>>
+      external_caches;
 
     struct MempoolCache : public PriorityCache::PriCache {
       BlueStore *store;
@@ -2826,6 +2955,32 @@ private:
     mono_clock::time_point last_fragmentation_check;
   } mempool_thread;
 
+  /// rewrites fragmented cached objects while the store is idle
+  struct DefragThread : public Thread {
+    BlueStore *store;
+    ceph::condition_variable cond;
+    ceph::mutex lock = ceph::make_mutex("BlueStore::DefragThread::lock");
+    bool stop = false;
+
+    explicit DefragThread(BlueStore *s) : store(s) {}
+    void *entry() override;
+    void init() {
+      ceph_assert(stop == false);
+      create("bstore_defrag");
+    }
+    void shutdown() {
+      lock.lock();
+      stop = true;
+      cond.notify_all();
+      lock.unlock();
+      join();
+      stop = false;
+    }
+  } defrag_thread;
+  /// set at mount when the defragmenter runs; queue_transactions() then
+  /// takes OpSequencer::submit_lock
+  bool defrag_enabled = false;
+
 #ifdef WITH_BLKIN
   ZTracer::Endpoint trace_endpoint {"0.0.0.0", 0, "BlueStore"};
 #endif
@@ -2960,6 +3115,8 @@ private:
   void _txc_update_store_statfs(TransContext *txc);
   void _txc_add_transaction(TransContext *txc, Transaction *t);
   void _txc_calc_cost(TransContext *txc);
+  void _txc_prepare_kv(TransContext *txc);
+  void _txc_start_throttled(TransContext *txc, mono_clock::time_point tstart);
   void _txc_write_nodes(TransContext *txc, KeyValueDB::Transaction t);
   void _txc_state_proc(TransContext *txc);
   void _txc_aio_submit(TransContext *txc);
@@ -2985,6 +3142,22 @@ private:
   void _kv_stop();
   void _kv_sync_thread();
   void _kv_finalize_thread();
+  void _kv_lane_thread(KVSyncLane *lane);
+  KVSyncLane *_kv_lane_for(const OpSequencer *osr) {
+    if (kv_lanes.empty()) {
+      return nullptr;
+    }
+    auto i = osr->get_sequencer_id() % (kv_lanes.size() + 1);
+    return i ? kv_lanes[i - 1].get() : nullptr;
+  }
+  PerfCounters *_create_kv_lane_logger(uint32_t idx);
+  void _kv_prepare_id_max(
+    KeyValueDB::Transaction t,
+    uint64_t *new_nid_max,
+    uint64_t *new_blobid_max);
+  void _kv_queue_finalize(
+    std::deque<TransContext*>& committed,
+    std::deque<DeferredBatch*>& deferred_stable);
 
   bluestore_deferred_op_t *_get_deferred_op(TransContext *txc, uint64_t len);
   void _deferred_queue(TransContext *txc);
@@ -2992,6 +3165,10 @@ public:
   void deferred_try_submit();
 private:
   void _deferred_submit_unlock(OpSequencer *osr);
+  void _deferred_submit_coalesced(std::vector<OpSequencerRef>& osrs);
+  unsigned _deferred_prepare_aios(
+    std::map<uint64_t,DeferredBatch::deferred_io>& iomap,
+    IOContext *ioc);
   void _deferred_aio_finish(OpSequencer *osr);
   int _deferred_replay();
   bool _eliminate_outdated_deferred(bluestore_deferred_transaction_t* deferred_txn,
@@ -3209,6 +3386,10 @@ public:
   }
 
   void set_cache_shards(unsigned num) override;
+  bool register_priority_cache(
+    const std::string& name,
+    std::shared_ptr<PriorityCache::PriCache> cache) override;
+  void unregister_priority_cache(const std::string& name) override;
   void dump_cache_stats(ceph::Formatter *f) override {
     int onode_count = 0, buffers_bytes = 0;
     for (auto i: onode_cache_shards) {
@@ -3264,6 +3445,7 @@ public:
   std::string get_device_path(unsigned id);
 
   bool get_db_sharding(std::string& res_sharding);
+  int advise_db_sharding(ceph::Formatter* f, double hot_write_share, bool reset);
 
   int dump_bluefs_sizes(std::ostream& out);
   void trim_free_space(const std::string& type, std::ostream& outss);
@@ -3375,6 +3557,8 @@ private:
   void _measure_runtime_frag(Collection *c, const blobs2read_t& blobs2read);
 
   void _measure_static_frag(Collection *c, const OnodeRef& o);
+  void _defrag_round();
+  uint64_t _defrag_onode(CollectionRef& c, OnodeRef& o, uint64_t min_score);
 
   int _do_read(
     Collection *c,
@@ -3656,6 +3840,10 @@ public:
     OnodeRef o = c->get_onode(hoid, false);
     return o;
   }
+  void debug_defrag_round() {
+    ceph_assert(defrag_enabled);
+    _defrag_round();
+  }
   inline void log_latency(const char* name,
     int idx,
     const ceph::timespan& lat,
@@ -3969,7 +4157,13 @@ private:
 	      OnodeRef& o);
   int _do_remove(TransContext *txc,
 		 CollectionRef& c,
-		 OnodeRef& o);
+		 OnodeRef& o,
+		 bool keys_range_deleted = false,
+		 bool omap_range_deleted = false);
+  void _do_destroy_onode(TransContext *txc,
+			 CollectionRef& c,
+			 OnodeRef& o,
+			 bool omap_range_deleted);
   int _maybe_unshare_on_remove(TransContext *txc,
                                CollectionRef& c,
                                OnodeRef& head_o,
@@ -4041,6 +4235,8 @@ private:
   int _remove_collection(TransContext *txc, const coll_t &cid,
                          CollectionRef *c);
   void _do_remove_collection(TransContext *txc, CollectionRef *c);
+  int _destroy_collection(TransContext *txc, const coll_t &cid,
+			  CollectionRef *c);
   int _split_collection(TransContext *txc,
 			CollectionRef& c,
 			CollectionRef& d,
@@ -4165,6 +4361,23 @@ private:
     std::map<uint64_t, volatile_statfs> actual_pool_vstatfs;
     volatile_statfs actual_store_vstatfs;
   };
+  /// progress of a full onode scan, see "bluestore scan progress"
+  struct scan_progress_t {
+    std::atomic<bool> running = false;
+    std::atomic<uint32_t> threads = 0;
+    std::atomic<uint32_t> chunks_total = 0;  ///< 0 if not partitioned
+    std::atomic<uint32_t> chunks_done = 0;
+    std::atomic<uint64_t> objects = 0;
+    std::atomic<ceph::mono_time> started;
+
+    void start(uint32_t _threads, uint32_t _chunks);
+    void finish() {
+      running = false;
+    }
+    void dump(ceph::Formatter *f) const;
+  };
+  scan_progress_t fsck_progress;
+  scan_progress_t alloc_recovery_progress;
   int allocation_recover_and_compare(
     SimpleBitmap *sbmap,
     read_alloc_stats_t &stats,
@@ -14,6 +14,7 @@
 #include "common/pretty_binary.h"
 #include "simple_bitmap.h"
 #include "common/debug.h"
+#include "include/scope_guard.h"
 using namespace std;
 
 // kv store prefixes, copied from BlueStore.cc
@@ -201,6 +202,7 @@ class BlueStore::OnodeScanMT {
   ceph::mutex lock = ceph::make_mutex("BlueStore::OnodeScanMT::lock");
   void report_progress(uint32_t thread_no, uint64_t no_completed) {
     auto &cct = store.cct;
+    store.alloc_recovery_progress.objects += no_completed;
     std::lock_guard l(lock);
     if (total / interval != (total + no_completed) / interval) {
       dout(5) << __func__ << " processed objects count = "
@@ -306,6 +308,7 @@ class BlueStore::OnodeScanMT {
       dout(10) << "thread " << thread_no << " runs: " << pretty_binary_string(start_key)
         << "..." << pretty_binary_string(upper_bound_key) << dendl;
       scan_onodes_range(stats, start_key, upper_bound_key);
+      ++store.alloc_recovery_progress.chunks_done;
     }
   }
 
@@ -330,6 +333,10 @@ public:
     }
 
     num_threads = std::min(num_threads, chunks.size());
+    store.alloc_recovery_progress.start(num_threads, chunks.size());
+    auto finish_progress = make_scope_guard([&] {
+      store.alloc_recovery_progress.finish();
+    });
     thr_stats.resize(num_threads);
     thr.resize(num_threads);
     timers.resize(num_threads);
@@ -312,6 +312,7 @@ int main(int argc, char **argv)
   int log_level = 30;
   bool fsck_deep = false;
   uint64_t disk_offset;
+  uint64_t threads = 0;
   po::options_description po_options("Options");
   po_options.add_options()
     ("help,h", "produce help message")
@@ -328,6 +329,8 @@ int main(int argc, char **argv)
     ("devs-source", po::value<vector<string>>(&devs_source), "bluefs-dev-migrate source device(s)")
     ("dev-target", po::value<string>(&dev_target), "target/resulting device")
     ("deep", po::value<bool>(&fsck_deep), "deep fsck (read all data)")
+    ("threads", po::value<uint64_t>(&threads),
+      "worker threads for allocation recovery and quick-fix")
     ("key,k", po::value<string>(&key), "label metadata key name")
     ("value,v", po::value<string>(&value), "label metadata value")
     ("allocator", po::value<vector<string>>(&allocs_name), "allocator to inspect: 'block'/'bluefs-wal'/'bluefs-db'")
@@ -499,6 +502,15 @@ int main(int argc, char **argv)
       exit(EXIT_FAILURE);
     }
   }
+  if (vm.count("threads")) {
+    // these are startup options, make sure we can still adjust them
+    g_conf()._clear_safe_to_start_threads();
+    g_conf().set_val_or_die("bluestore_allocation_recovery_threads",
+                            std::to_string(threads));
+    g_conf().set_val_or_die("bluestore_fsck_quick_fix_threads",
+                            std::to_string(threads));
+    g_conf().apply_changes(nullptr);
+  }
   if (action == "prime-osd-dir") {
     if (devs.size() != 1) {
       cerr << "must specify the main bluestore device" << std::endl;
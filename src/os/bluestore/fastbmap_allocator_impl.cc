@@ -42,73 +42,62 @@ interval_t AllocatorLevel01Loose::_get_longest_from_l0(uint64_t pos0,
   *tail = interval_t();
 
   auto d = bits_per_slot;
-  slot_t bits = l0[pos / d];
-  bits >>= pos % d;
-  bool end_loop = false;
   auto min_granules = min_length / l0_granularity;
 
-  do {
-    if ((pos % d) == 0) {
-      bits = l0[pos / d];
-      if (pos1 - pos >= d) {
-        switch(bits) {
-	  case all_slot_set:
-	    // slot is totally free
-	    if (!res_candidate.length) {
-	      res_candidate.offset = pos;
-	    }
-	    res_candidate.length += d;
-	    pos += d;
-	    end_loop = pos >= pos1;
-	    if (end_loop) {
-	      *tail = res_candidate;
-	      res_candidate = _align2units(res_candidate.offset,
-		res_candidate.length, min_granules);
-	      if(res.length < res_candidate.length) {
-		res = res_candidate;
-	      }
-	    }
-	    continue;
-	  case all_slot_clear:
-	    // slot is totally allocated
-	    res_candidate = _align2units(res_candidate.offset,
-	      res_candidate.length, min_granules);
-	    if (res.length < res_candidate.length) {
-	      res = res_candidate;
-	    }
-	    res_candidate = interval_t();
-	    pos += d;
-	    end_loop = pos >= pos1;
-	    continue;
+  auto close_candidate = [&]() {
+    res_candidate = _align2units(res_candidate.offset,
+      res_candidate.length, min_granules);
+    if (res.length < res_candidate.length) {
+      res = res_candidate;
+    }
+    res_candidate = interval_t();
+  };
+
+  while (pos < pos1) {
+    if ((pos % d) == 0 && pos1 - pos >= d) {
+      auto idx = pos / d;
+      slot_t bits = l0[idx];
+      if (bits == all_slot_set || bits == all_slot_clear) {
+	// skip the whole run of identical slots at once
+	auto slots = (pos1 - pos) / d;
+	auto run = 1 + fastbmap_simd::find_first_not(l0.data() + idx + 1,
+	  slots - 1, bits);
+	if (bits == all_slot_set) {
+	  if (!res_candidate.length) {
+	    res_candidate.offset = pos;
+	  }
+	  res_candidate.length += run * d;
+	} else {
+	  close_candidate();
 	}
+	pos += run * d;
+	continue;
       }
-    } //if ((pos % d) == 0)
+    }
 
-    end_loop = ++pos >= pos1;
-    if (bits & 1) {
-      // item is free
-      if (!res_candidate.length) {
-	res_candidate.offset = pos - 1;
-      }
-      ++res_candidate.length;
-      if (end_loop) {
-	*tail = res_candidate;
-	res_candidate = _align2units(res_candidate.offset,
-	  res_candidate.length, min_granules);
-	if (res.length < res_candidate.length) {
-	  res = res_candidate;
+    // partial slot, walk it run by run rather than bit by bit
+    slot_t bits = l0[pos / d] >> (pos % d);
+    uint64_t slot_end = std::min(p2roundup<uint64_t>(pos + 1, d), pos1);
+    while (pos < slot_end) {
+      uint64_t n;
+      if (bits & 1) {
+	n = std::min<uint64_t>(std::countr_one(bits), slot_end - pos);
+	if (!res_candidate.length) {
+	  res_candidate.offset = pos;
 	}
+	res_candidate.length += n;
+      } else {
+	n = std::min<uint64_t>(std::countr_zero(bits), slot_end - pos);
+	close_candidate();
       }
-    } else {
-      res_candidate = _align2units(res_candidate.offset,
-	res_candidate.length, min_granules);
-      if (res.length < res_candidate.length) {
-	res = res_candidate;
-      }
-      res_candidate = interval_t();
+      pos += n;
+      bits = n < d ? bits >> n : 0;
     }
-    bits >>= 1;
-  } while (!end_loop);
+  }
+  // a trailing free run may continue in the next slotset
+  *tail = res_candidate;
+  close_candidate();
+
   res.offset *= l0_granularity;
   res.length *= l0_granularity;
   tail->offset *= l0_granularity;
@@ -10,6 +10,7 @@
 #ifndef __FAST_BITMAP_ALLOCATOR_IMPL_H
 #define __FAST_BITMAP_ALLOCATOR_IMPL_H
 #include "include/intarith.h"
+#include "fastbmap_simd.h"
 
 #include <bit>
 #include <vector>
@@ -213,6 +214,9 @@ class AllocatorLevel01Loose : public AllocatorLevel01
       slot_t& slot_val = l0[idx];
       auto base = idx * d0;
       if (slot_val == all_slot_clear) {
+        // jump over the whole run of allocated slots
+        idx += fastbmap_simd::find_first_not(l0.data() + idx + 1,
+          l0_pos1 / d0 - idx - 1, all_slot_clear);
         continue;
       } else if (slot_val == all_slot_set) {
         uint64_t to_alloc = std::min(need_entries, d0);
@@ -418,18 +422,14 @@ protected:
 
   bool _is_empty_l0(uint64_t l0_pos, uint64_t l0_pos_end)
   {
-    bool no_free = true;
     uint64_t d = slots_per_slotset * L0_ENTRIES_PER_SLOT;
     ceph_assert(0 == (l0_pos % d));
     ceph_assert(0 == (l0_pos_end % d));
 
     auto idx = l0_pos / L0_ENTRIES_PER_SLOT;
     auto idx_end = l0_pos_end / L0_ENTRIES_PER_SLOT;
-    while (idx < idx_end && no_free) {
-      no_free = l0[idx] == all_slot_clear;
-      ++idx;
-    }
-    return no_free;
+    return fastbmap_simd::find_first_not(l0.data() + idx, idx_end - idx,
+      all_slot_clear) == idx_end - idx;
   }
   bool _is_empty_l1(uint64_t l1_pos, uint64_t l1_pos_end)
   {
@@ -523,25 +523,7 @@ public:
       idx1 = l0.size();
     }
 
-    uint64_t res = 0;
-    for (uint64_t i = idx0; i < idx1; ++i) {
-      auto v = l0[i];
-      if (v == all_slot_set) {
-        res += L0_ENTRIES_PER_SLOT;
-      } else if (v != all_slot_clear) {
-        size_t cnt = 0;
-#ifdef __GNUC__
-        cnt = __builtin_popcountll(v);
-#else
-        // Kernighan's Alg to count set bits
-        while (v) {
-          v &= (v - 1);
-          cnt++;
-        }
-#endif
-        res += cnt;
-      }
-    }
+    uint64_t res = fastbmap_simd::count_set(l0.data() + idx0, idx1 - idx0);
     return res * l0_granularity;
   }
   void collect_stats(
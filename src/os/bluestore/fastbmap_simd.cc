@@ -0,0 +1,194 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:nil -*-
+// vim: ts=8 sw=2 sts=2 expandtab
+
+#include "fastbmap_simd.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define FASTBMAP_HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace fastbmap_simd {
+
+static size_t find_first_not_scalar(const uint64_t* slots, size_t n,
+  uint64_t val)
+{
+  size_t i = 0;
+  while (i < n && slots[i] == val) {
+    ++i;
+  }
+  return i;
+}
+
+static uint64_t count_set_scalar(const uint64_t* slots, size_t n)
+{
+  uint64_t res = 0;
+  for (size_t i = 0; i < n; ++i) {
+#ifdef __GNUC__
+    res += __builtin_popcountll(slots[i]);
+#else
+    auto v = slots[i];
+    while (v) {
+      v &= (v - 1);
+      res++;
+    }
+#endif
+  }
+  return res;
+}
+
+static const kernels_t scalar_kernels = {
+  impl_t::SCALAR, "scalar", find_first_not_scalar, count_set_scalar
+};
+
+#ifdef FASTBMAP_HAVE_X86_KERNELS
+
+__attribute__((target("avx2")))
+static size_t find_first_not_avx2(const uint64_t* slots, size_t n,
+  uint64_t val)
+{
+  const __m256i v = _mm256_set1_epi64x(val);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(slots + i));
+    unsigned eq = _mm256_movemask_pd(
+      _mm256_castsi256_pd(_mm256_cmpeq_epi64(x, v)));
+    if (eq != 0xf) {
+      return i + __builtin_ctz(~eq);
+    }
+  }
+  return i + find_first_not_scalar(slots + i, n - i, val);
+}
+
+// nibble lookup popcount, see W. Mula et al., "Faster Population Counts
+// Using AVX2 Instructions"
+__attribute__((target("avx2")))
+static uint64_t count_set_avx2(const uint64_t* slots, size_t n)
+{
+  const __m256i lut = _mm256_setr_epi8(
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0f);
+  __m256i acc = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(slots + i));
+    __m256i lo = _mm256_and_si256(x, low_mask);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), low_mask);
+    __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lut, lo),
+                                  _mm256_shuffle_epi8(lut, hi));
+    acc = _mm256_add_epi64(acc,
+      _mm256_sad_epu8(cnt, _mm256_setzero_si256()));
+  }
+  uint64_t res = _mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) +
+                 _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3);
+  return res + count_set_scalar(slots + i, n - i);
+}
+
+static const kernels_t avx2_kernels = {
+  impl_t::AVX2, "avx2", find_first_not_avx2, count_set_avx2
+};
+
+// a slotset is 8 slots, i.e. exactly one zmm register
+__attribute__((target("avx512f")))
+static size_t find_first_not_avx512(const uint64_t* slots, size_t n,
+  uint64_t val)
+{
+  const __m512i v = _mm512_set1_epi64(val);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512i x = _mm512_loadu_si512(slots + i);
+    __mmask8 ne = _mm512_cmpneq_epu64_mask(x, v);
+    if (ne) {
+      return i + __builtin_ctz(ne);
+    }
+  }
+  if (i < n) {
+    __mmask8 k = (__mmask8)((1u << (n - i)) - 1);
+    __m512i x = _mm512_maskz_loadu_epi64(k, slots + i);
+    __mmask8 ne = _mm512_mask_cmpneq_epu64_mask(k, x, v);
+    return ne ? i + __builtin_ctz(ne) : n;
+  }
+  return n;
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static uint64_t count_set_avx512(const uint64_t* slots, size_t n)
+{
+  __m512i acc = _mm512_setzero_si512();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    acc = _mm512_add_epi64(acc,
+      _mm512_popcnt_epi64(_mm512_loadu_si512(slots + i)));
+  }
+  if (i < n) {
+    __mmask8 k = (__mmask8)((1u << (n - i)) - 1);
+    acc = _mm512_add_epi64(acc,
+      _mm512_popcnt_epi64(_mm512_maskz_loadu_epi64(k, slots + i)));
+  }
+  alignas(64) uint64_t lanes[8];
+  _mm512_store_si512(lanes, acc);
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+         lanes[4] + lanes[5] + lanes[6] + lanes[7];
+}
+
+static const kernels_t avx512_kernels = {
+  impl_t::AVX512, "avx512", find_first_not_avx512, count_set_avx512
+};
+
+#endif // FASTBMAP_HAVE_X86_KERNELS
+
+bool is_supported(impl_t impl)
+{
+  switch (impl) {
+  case impl_t::SCALAR:
+    return true;
+#ifdef FASTBMAP_HAVE_X86_KERNELS
+  case impl_t::AVX2:
+    return __builtin_cpu_supports("avx2");
+  case impl_t::AVX512:
+    return __builtin_cpu_supports("avx512f") &&
+      __builtin_cpu_supports("avx512vpopcntdq");
+#endif
+  default:
+    return false;
+  }
+}
+
+const kernels_t* get_kernels(impl_t impl)
+{
+  if (!is_supported(impl)) {
+    return nullptr;
+  }
+  switch (impl) {
+#ifdef FASTBMAP_HAVE_X86_KERNELS
+  case impl_t::AVX2:
+    return &avx2_kernels;
+  case impl_t::AVX512:
+    return &avx512_kernels;
+#endif
+  default:
+    return &scalar_kernels;
+  }
+}
+
+bool select(impl_t impl)
+{
+  auto k = get_kernels(impl);
+  if (k) {
+    active = k;
+  }
+  return k != nullptr;
+}
+
+// constant initialized, so allocators created during static init of other
+// translation units still see a valid table
+const kernels_t* active = &scalar_kernels;
+
+static struct kernels_picker_t {
+  kernels_picker_t() {
+    select(impl_t::AVX512) || select(impl_t::AVX2);
+  }
+} kernels_picker;
+
+} // namespace fastbmap_simd
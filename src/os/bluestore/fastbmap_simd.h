@@ -0,0 +1,57 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:nil -*-
+// vim: ts=8 sw=2 sts=2 expandtab
+
+/*
+ * Slot scanning kernels for the bitmap allocator.
+ *
+ * L0 bitmaps get large (a 20TB device at 4K allocation unit is ~5G bits),
+ * so the loops that skip over fully free/allocated slots and count free
+ * bits are provided in scalar, AVX2 and AVX-512 flavours. The best one
+ * supported by the running CPU is picked at startup.
+ */
+
+#ifndef __FAST_BITMAP_SIMD_H
+#define __FAST_BITMAP_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fastbmap_simd {
+
+enum class impl_t {
+  SCALAR,
+  AVX2,
+  AVX512,
+};
+
+struct kernels_t {
+  impl_t impl;
+  const char* name;
+  // index of the first of n slots that is not equal to val, n if none
+  size_t (*find_first_not)(const uint64_t* slots, size_t n, uint64_t val);
+  // number of set bits in n slots
+  uint64_t (*count_set)(const uint64_t* slots, size_t n);
+};
+
+extern const kernels_t* active;
+
+inline size_t find_first_not(const uint64_t* slots, size_t n, uint64_t val)
+{
+  return active->find_first_not(slots, n, val);
+}
+
+inline uint64_t count_set(const uint64_t* slots, size_t n)
+{
+  return active->count_set(slots, n);
+}
+
+bool is_supported(impl_t impl);
+const kernels_t* get_kernels(impl_t impl);
+
+// Switch the active implementation, returns false if the CPU lacks support.
+// Not thread safe, meant for benchmarks and tests.
+bool select(impl_t impl);
+
+} // namespace fastbmap_simd
+
+#endif
@@ -794,6 +794,13 @@ void MemStore::_do_transaction(Transaction& t)
       }
       break;
 
+    case Transaction::OP_DESTROY_COLLECTION:
+      {
+        coll_t cid = i.get_cid(op->cid);
+	r = _destroy_collection(cid, true);
+      }
+      break;
+
     case Transaction::OP_COLL_ADD:
       {
         coll_t ocid = i.get_cid(op->cid);
@@ -1293,7 +1300,7 @@ int MemStore::_create_collection(const coll_t& cid, int bits)
   return 0;
 }
 
-int MemStore::_destroy_collection(const coll_t& cid)
+int MemStore::_destroy_collection(const coll_t& cid, bool remove_objects)
 {
   dout(10) << __func__ << " " << cid << dendl;
   std::lock_guard l{coll_lock};
@@ -1302,7 +1309,7 @@ int MemStore::_destroy_collection(const coll_t& cid)
     return -ENOENT;
   {
     std::shared_lock l2{cp->second->lock};
-    if (!cp->second->object_map.empty())
+    if (!remove_objects && !cp->second->object_map.empty())
       return -ENOTEMPTY;
     cp->second->exists = false;
   }
@@ -223,7 +223,7 @@ private:
   int _collection_hint_expected_num_objs(const coll_t& cid, uint32_t pg_num,
       uint64_t num_objs) const { return 0; }
   int _create_collection(const coll_t& c, int bits);
-  int _destroy_collection(const coll_t& c);
+  int _destroy_collection(const coll_t& c, bool remove_objects = false);
   int _collection_add(const coll_t& cid, const coll_t& ocid, const ghobject_t& oid);
   int _collection_move_rename(const coll_t& oldcid, const ghobject_t& oldoid,
 			      coll_t cid, const ghobject_t& o);
@@ -304,6 +304,15 @@ OSDService::OSDService(OSD *osd, ceph::async::io_context_pool& poolctx) :
     auto fin = make_unique<Finisher>(osd->client_messenger->cct, str.str(), "finisher");
     objecter_finishers.push_back(std::move(fin));
   }
+  if (auto size = cct->_conf.get_val<Option::size_t>(
+	"osd_object_context_cache_size"); size > 0) {
+    obc_cache = std::make_shared<ObjectContextCache>(
+      cct,
+      cct->_conf.get_val<uint64_t>("osd_object_context_cache_shards"),
+      size);
+    obc_cache->set_cache_ratio(
+      cct->_conf.get_val<double>("osd_object_context_cache_ratio"));
+  }
 }
 
 #ifdef PG_DEBUG_REFS
@@ -2478,6 +2487,8 @@ OSD::OSD(CephContext *cct_,
                                            cct->_conf->osd_op_history_duration);
   op_tracker.set_history_slow_op_size_and_threshold(cct->_conf->osd_op_history_slow_op_size,
                                                     cct->_conf->osd_op_history_slow_op_threshold);
+  op_tracker.set_sample_rate(
+    cct->_conf.get_val<uint64_t>("osd_op_tracker_sample_rate"));
   ObjectCleanRegions::set_max_num_intervals(cct->_conf->osd_object_clean_region_max_num_intervals);
 #ifdef WITH_BLKIN
   std::stringstream ss;
@@ -2920,6 +2931,10 @@ will start to track new ops received afterwards.";
     f->open_object_section("pq");
     op_shardedwq.dump(f);
     f->close_section();
+  } else if (prefix == "dump_op_shards") {
+    f->open_object_section("op_shards");
+    op_shardedwq.dump_shards(f);
+    f->close_section();
   } else if (prefix == "dump_blocklist") {
     list<pair<entity_addr_t,utime_t> > bl;
     list<pair<entity_addr_t,utime_t> > rbl;
@@ -3278,6 +3293,11 @@ will start to track new ops received afterwards.";
     }
     f->open_object_section("cache_status");
     f->dump_int("object_ctx", obj_ctx_count);
+    if (service.obc_cache) {
+      f->open_object_section("object_ctx_cache");
+      service.obc_cache->dump(f);
+      f->close_section();
+    }
     store->dump_cache_stats(f);
     f->close_section();
   }
@@ -3710,6 +3730,11 @@ int OSD::init()
   journal_is_rotational = store->is_journal_rotational();
   dout(2) << "journal looks like " << (journal_is_rotational ? "hdd" : "ssd")
           << dendl;
+  if (service.obc_cache) {
+    bool tuned = store->register_priority_cache("osd_obc", service.obc_cache);
+    dout(2) << "object context cache budget "
+	    << (tuned ? "autotuned" : "fixed") << dendl;
+  }
 
   enable_disable_fuse(false);
 
@@ -4075,6 +4100,9 @@ int OSD::init()
 
 out:
   enable_disable_fuse(true);
+  if (service.obc_cache) {
+    store->unregister_priority_cache("osd_obc");
+  }
   store->umount();
   store.reset();
   return r;
@@ -4130,6 +4158,10 @@ void OSD::final_init()
 				     asok_hook,
 				     "dump op queue state");
   ceph_assert(r == 0);
+  r = admin_socket->register_command("dump_op_shards",
+				     asok_hook,
+				     "dump op shard queue depths and work stealing counts");
+  ceph_assert(r == 0);
   r = admin_socket->register_command("dump_blocklist",
 				     asok_hook,
 				     "dump blocklisted clients and times");
@@ -4832,6 +4864,9 @@ int OSD::shutdown()
   service.shutdown();
 
   std::lock_guard lock(osd_lock);
+  if (service.obc_cache) {
+    store->unregister_priority_cache("osd_obc");
+  }
   store->umount();
   store.reset();
   dout(10) << "Store synced" << dendl;
@@ -7794,11 +7829,22 @@ void OSD::ms_fast_dispatch(Message *m)
       OSDMapRef nextmap = service.get_nextmap_reserved();
       dispatch_session_waiting(session, nextmap);
       service.release_map(nextmap);
+      // others may dispatch this session's waiting ops once we unlock
+      op_shardedwq.flush_batch();
     }
   }
   OID_EVENT_TRACE_WITH_MSG(m, "MS_FAST_DISPATCH_END", false);
 }
 
+void OSD::ms_fast_dispatch_batch(const std::vector<MessageRef>& ms)
+{
+  op_shardedwq.begin_batch();
+  for (const auto& m : ms) {
+    ms_fast_dispatch(MessageRef(m).detach());
+  }
+  op_shardedwq.end_batch();
+}
+
 bool OSD::ms_handle_fast_authentication(Connection *con)
 {
   auto s = ceph::ref_cast<Session>(con->get_priv());
@@ -10086,6 +10132,10 @@ std::vector<std::string> OSD::get_tracked_keys() const noexcept
     "osd_op_history_slow_op_size"s,
     "osd_op_history_slow_op_threshold"s,
     "osd_enable_op_tracker"s,
+    "osd_op_tracker_sample_rate"s,
+    "osd_op_queue_steal_min_depth"s,
+    "osd_object_context_cache_size"s,
+    "osd_object_context_cache_ratio"s,
     "osd_map_cache_size"s,
     "osd_pg_epoch_max_lag_factor"s,
     "osd_pg_epoch_persisted_max_stale"s,
@@ -10204,6 +10254,25 @@ void OSD::handle_conf_change(const ConfigProxy& conf,
   if (changed.count("osd_enable_op_tracker")) {
       op_tracker.set_tracking(cct->_conf->osd_enable_op_tracker);
   }
+  if (changed.count("osd_op_tracker_sample_rate")) {
+    op_tracker.set_sample_rate(
+      cct->_conf.get_val<uint64_t>("osd_op_tracker_sample_rate"));
+  }
+  if (changed.count("osd_op_queue_steal_min_depth")) {
+    op_shardedwq.set_steal_min_depth(
+      cct->_conf.get_val<uint64_t>("osd_op_queue_steal_min_depth"));
+  }
+  if (service.obc_cache) {
+    // with an autotuning store this only holds until the next balance
+    if (changed.count("osd_object_context_cache_size")) {
+      service.obc_cache->set_budget(
+	cct->_conf.get_val<Option::size_t>("osd_object_context_cache_size"));
+    }
+    if (changed.count("osd_object_context_cache_ratio")) {
+      service.obc_cache->set_cache_ratio(
+	cct->_conf.get_val<double>("osd_object_context_cache_ratio"));
+    }
+  }
   if (changed.count("osd_map_cache_size")) {
     service.map_cache.set_size(cct->_conf->osd_map_cache_size);
     service.map_bl_cache.set_size(cct->_conf->osd_map_cache_size);
@@ -10858,6 +10927,7 @@ int OSDShard::_wake_pg_slot(
   }
   slot->waiting_peering.clear();
   ++slot->requeue_seq;
+  queue_depth += count;
   return count;
 }
 
@@ -11112,16 +11182,44 @@ void OSD::ShardedOpWQ::_add_slot_waiter(
 #undef dout_prefix
 #define dout_prefix *_dout << "osd." << osd->whoami << " op_wq(" << shard_index << ") "
 
+OSDShard *OSD::ShardedOpWQ::_pick_steal_victim(OSDShard *thief)
+{
+  auto min_depth = steal_min_depth.load(std::memory_order_relaxed);
+  if (!min_depth || osd->num_shards < 2 || osd->is_stopping()) {
+    return nullptr;
+  }
+  OSDShard *victim = nullptr;
+  int64_t max_depth = min_depth - 1;
+  for (auto shard : osd->shards) {
+    if (shard == thief || shard->idle_threads > 0) {
+      continue;
+    }
+    if (int64_t depth = shard->queue_depth; depth > max_depth) {
+      victim = shard;
+      max_depth = depth;
+    }
+  }
+  return victim;
+}
+
 void OSD::ShardedOpWQ::_process(uint32_t thread_index, uint32_t shard_index, heartbeat_handle_d *hb)
 {
   auto& sdata = osd->shards[shard_index];
   ceph_assert(sdata);
+  _process_shard(thread_index, sdata, hb, nullptr);
+}
 
+void OSD::ShardedOpWQ::_process_shard(uint32_t thread_index,
+                                      OSDShard *sdata,
+                                      heartbeat_handle_d *hb,
+                                      OSDShard *thief)
+{
+  [[maybe_unused]] uint32_t shard_index = sdata->shard_id;  // for dout_prefix
   // If all threads of shards do oncommits, there is a out-of-order
   // problem.  So we choose the thread which has the smallest
   // thread_index(thread_index < num_shards) of shard to do oncommit
-  // callback.
-  bool is_smallest_thread_index = thread_index < osd->num_shards;
+  // callback.  A thread helping another shard never does.
+  bool is_smallest_thread_index = !thief && thread_index < osd->num_shards;
 
   // peek at spg_t
   sdata->shard_lock.lock();
@@ -11131,11 +11229,31 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, uint32_t shard_index, hea
     if (is_smallest_thread_index && !sdata->context_queue.empty()) {
       // we raced with a context_queue addition, don't wait
       wait_lock.unlock();
+    } else if (thief) {
+      // its own threads got there first
+      wait_lock.unlock();
+      sdata->shard_lock.unlock();
+      return;
     } else if (!sdata->stop_waiting) {
+      if (OSDShard *victim = _pick_steal_victim(sdata); victim) {
+        dout(20) << __func__ << " empty q, helping shard "
+                 << victim->shard_id << dendl;
+        wait_lock.unlock();
+        sdata->shard_lock.unlock();
+        _process_shard(thread_index, victim, hb, sdata);
+        return;
+      }
       dout(20) << __func__ << " empty q, waiting" << dendl;
       osd->cct->get_heartbeat_map()->clear_timeout(hb);
       sdata->shard_lock.unlock();
-      sdata->sdata_cond.wait(wait_lock);
+      ++sdata->idle_threads;
+      if (steal_min_depth.load(std::memory_order_relaxed)) {
+        // look for busy shards again every now and then
+        sdata->sdata_cond.wait_for(wait_lock, std::chrono::milliseconds(10));
+      } else {
+        sdata->sdata_cond.wait(wait_lock);
+      }
+      --sdata->idle_threads;
       wait_lock.unlock();
       sdata->shard_lock.lock();
       if (sdata->scheduler->empty() &&
@@ -11188,6 +11306,11 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, uint32_t shard_index, hea
     // If the work item is scheduled in the future, wait until
     // the time returned in the dequeue response before retrying.
     if (auto when_ready = std::get_if<double>(&work_item)) {
+      if (thief) {
+        // leave it to the shard's own threads
+        sdata->shard_lock.unlock();
+        return;
+      }
       if (is_smallest_thread_index) {
         sdata->shard_lock.unlock();
         handle_oncommits(oncommits);
@@ -11217,6 +11340,11 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, uint32_t shard_index, hea
 
   // Access the stored item
   auto item = std::move(std::get<OpSchedulerItem>(work_item));
+  --sdata->queue_depth;
+  if (thief) {
+    ++sdata->stolen;
+    ++thief->steals;
+  }
   if (osd->is_stopping()) {
     sdata->shard_lock.unlock();
     for (auto c : oncommits) {
@@ -11449,6 +11577,68 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, uint32_t shard_index, hea
   handle_oncommits(oncommits);
 }
 
+namespace {
+// items held back by the calling thread between
+// ShardedOpWQ::begin_batch() and end_batch(), by shard
+struct op_batch_t {
+  const void *wq = nullptr;
+  std::vector<std::vector<OpSchedulerItem>> shards;
+};
+thread_local op_batch_t op_batch;
+}
+
+void OSD::ShardedOpWQ::begin_batch()
+{
+  ceph_assert(op_batch.wq == nullptr);
+  op_batch.wq = this;
+  op_batch.shards.resize(osd->shards.size());
+}
+
+void OSD::ShardedOpWQ::flush_batch()
+{
+  if (op_batch.wq != this) {
+    return;
+  }
+  for (uint32_t shard_index = 0; shard_index < op_batch.shards.size();
+       ++shard_index) {
+    auto& items = op_batch.shards[shard_index];
+    if (items.empty()) {
+      continue;
+    }
+    if (unlikely(m_fast_shutdown)) {
+      items.clear();
+      continue;
+    }
+    OSDShard* sdata = osd->shards[shard_index];
+    bool empty = true;
+    {
+      std::lock_guard l{sdata->shard_lock};
+      empty = sdata->scheduler->empty();
+      for (auto& item : items) {
+        dout(20) << fmt::format("{} {}", __func__, item) << dendl;
+        sdata->scheduler->enqueue(std::move(item));
+      }
+      sdata->queue_depth += static_cast<int32_t>(items.size());
+    }
+    {
+      std::lock_guard l{sdata->sdata_wait_lock};
+      if (empty || items.size() > 1) {
+        sdata->sdata_cond.notify_all();
+      } else if (sdata->waiting_threads) {
+        sdata->sdata_cond.notify_one();
+      }
+    }
+    items.clear();
+  }
+}
+
+void OSD::ShardedOpWQ::end_batch()
+{
+  ceph_assert(op_batch.wq == this);
+  flush_batch();
+  op_batch.wq = nullptr;
+}
+
 void OSD::ShardedOpWQ::_enqueue(OpSchedulerItem&& item) {
   if (unlikely(m_fast_shutdown) ) {
     // stop enqueing when we are in the middle of a fast shutdown
@@ -11458,6 +11648,11 @@ void OSD::ShardedOpWQ::_enqueue(OpSchedulerItem&& item) {
   uint32_t shard_index =
     item.get_ordering_token().hash_to_shard(osd->shards.size());
 
+  if (op_batch.wq == this) {
+    op_batch.shards[shard_index].push_back(std::move(item));
+    return;
+  }
+
   OSDShard* sdata = osd->shards[shard_index];
   assert (NULL != sdata);
 
@@ -11468,6 +11663,7 @@ void OSD::ShardedOpWQ::_enqueue(OpSchedulerItem&& item) {
     std::lock_guard l{sdata->shard_lock};
     empty = sdata->scheduler->empty();
     sdata->scheduler->enqueue(std::move(item));
+    ++sdata->queue_depth;
   }
 
   {
@@ -11508,11 +11704,32 @@ void OSD::ShardedOpWQ::_enqueue_front(OpSchedulerItem&& item)
     dout(20) << __func__ << " " << item << dendl;
   }
   sdata->scheduler->enqueue_front(std::move(item));
+  ++sdata->queue_depth;
   sdata->shard_lock.unlock();
   std::lock_guard l{sdata->sdata_wait_lock};
   sdata->sdata_cond.notify_one();
 }
 
+void OSD::ShardedOpWQ::dump_shards(ceph::Formatter *f)
+{
+  f->dump_unsigned("steal_min_depth", steal_min_depth);
+  f->open_array_section("shards");
+  for (auto sdata : osd->shards) {
+    f->open_object_section("shard");
+    f->dump_unsigned("id", sdata->shard_id);
+    f->dump_int("queue_depth", sdata->queue_depth);
+    f->dump_int("idle_threads", sdata->idle_threads);
+    {
+      std::lock_guard l{sdata->shard_lock};
+      f->dump_unsigned("pg_slots", sdata->pg_slots.size());
+    }
+    f->dump_unsigned("stolen", sdata->stolen);
+    f->dump_unsigned("steals", sdata->steals);
+    f->close_section();
+  }
+  f->close_section();
+}
+
 void OSD::ShardedOpWQ::stop_for_fast_shutdown()
 {
   m_fast_shutdown = true;
@@ -11524,6 +11741,7 @@ void OSD::ShardedOpWQ::stop_for_fast_shutdown()
     while (!sdata->scheduler->empty()) {
       sdata->scheduler->dequeue();
     }
+    sdata->queue_depth = 0;
   }
 }
 
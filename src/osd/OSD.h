@@ -54,6 +54,7 @@
 #include "messages/MOSDOp.h"
 #include "common/EventTrace.h"
 #include "osd/osd_perf_counters.h"
+#include "osd/ObjectContextCache.h"
 #include "common/Finisher.h"
 #include "scrubber/osd_scrub.h"
 
@@ -690,6 +691,9 @@ public:
 			    epoch_t lpr,
 			    ceph::signedspan delay = ceph::signedspan::zero());
 
+  /// unreferenced object contexts of all PGs, null if disabled
+  std::shared_ptr<ObjectContextCache> obc_cache;
+
   // osd map cache (past osd maps)
   ceph::mutex map_cache_lock = ceph::make_mutex("OSDService::map_cache_lock");
   SharedLRU<epoch_t, const OSDMap> map_cache;
@@ -994,6 +998,15 @@ struct OSDShard {
   ceph::condition_variable sdata_cond;
   int waiting_threads = 0;
 
+  /// items in the scheduler, approximate, for work stealing
+  std::atomic<int32_t> queue_depth = 0;
+  /// threads of this shard waiting for work
+  std::atomic<int32_t> idle_threads = 0;
+  /// items of this shard run by threads of other shards
+  std::atomic<uint64_t> stolen = 0;
+  /// items of other shards run by threads of this shard
+  std::atomic<uint64_t> steals = 0;
+
   ceph::mutex osdmap_lock;  ///< protect shard_osdmap updates vs users w/o shard_lock
   OSDMapRef shard_osdmap;
 
@@ -1743,13 +1756,21 @@ protected:
   {
     OSD *osd;
     bool m_fast_shutdown = false;
+    /// osd_op_queue_steal_min_depth, checked on every idle wakeup
+    std::atomic<uint64_t> steal_min_depth;
   public:
     ShardedOpWQ(OSD *o,
 		ceph::timespan ti,
 		ceph::timespan si,
 		ShardedThreadPool* tp)
       : ShardedThreadPool::ShardedWQ<OpSchedulerItem>(ti, si, tp),
-        osd(o) {
+        osd(o),
+        steal_min_depth(
+          o->cct->_conf.get_val<uint64_t>("osd_op_queue_steal_min_depth")) {
+    }
+
+    void set_steal_min_depth(uint64_t depth) {
+      steal_min_depth = depth;
     }
 
     void _add_slot_waiter(
@@ -1761,6 +1782,13 @@ protected:
     void _process(uint32_t thread_index,
                   uint32_t shard_index,
                   ceph::heartbeat_handle_d *hb) override;
+    /// try to do some work of @p sdata, on behalf of @p thief if not null
+    void _process_shard(uint32_t thread_index,
+                        OSDShard *sdata,
+                        ceph::heartbeat_handle_d *hb,
+                        OSDShard *thief);
+    /// find a busy shard an idle thread of @p thief should help with
+    OSDShard *_pick_steal_victim(OSDShard *thief);
 
     void stop_for_fast_shutdown();
 
@@ -1770,6 +1798,12 @@ protected:
     /// requeue an old item (at the front of the line)
     void _enqueue_front(OpSchedulerItem&& item) override;
 
+    /// hold back the items this thread enqueues until end_batch(), which
+    /// queues them with a single lock and wakeup per shard
+    void begin_batch();
+    void flush_batch();
+    void end_batch();
+
     void return_waiting_threads() override {
       for(uint32_t i = 0; i < osd->num_shards; i++) {
 	OSDShard* sdata = osd->shards[i];
@@ -1804,6 +1838,8 @@ protected:
       }
     }
 
+    void dump_shards(ceph::Formatter *f);
+
     bool is_shard_empty(uint32_t thread_index, uint32_t shard_index) override {
       auto &&sdata = osd->shards[shard_index];
       ceph_assert(sdata);
@@ -2155,6 +2191,7 @@ private:
     }
   }
   void ms_fast_dispatch(Message *m) override;
+  void ms_fast_dispatch_batch(const std::vector<MessageRef>& ms) override;
   bool ms_dispatch(Message *m) override;
   void ms_handle_connect(Connection *con) override;
   void ms_handle_fast_connect(Connection *con) override;
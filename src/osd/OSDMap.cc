@@ -1559,14 +1559,15 @@ void OSDMap::set_max_osd(int m)
   osd_state.resize(max_osd, 0);
   osd_weight.resize(max_osd, CEPH_OSD_OUT);
   osd_info.resize(max_osd);
-  osd_xinfo.resize(max_osd);
-  osd_addrs->client_addrs.resize(max_osd);
-  osd_addrs->cluster_addrs.resize(max_osd);
-  osd_addrs->hb_back_addrs.resize(max_osd);
-  osd_addrs->hb_front_addrs.resize(max_osd);
-  osd_uuid->resize(max_osd);
+  cow(osd_xinfo).resize(max_osd);
+  auto& addrs = cow(osd_addrs);
+  addrs.client_addrs.resize(max_osd);
+  addrs.cluster_addrs.resize(max_osd);
+  addrs.hb_back_addrs.resize(max_osd);
+  addrs.hb_front_addrs.resize(max_osd);
+  cow(osd_uuid).resize(max_osd);
   if (osd_primary_affinity)
-    osd_primary_affinity->resize(max_osd, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY);
+    cow(osd_primary_affinity).resize(max_osd, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY);
 
   calc_num_osds();
 }
@@ -1780,10 +1781,10 @@ uint64_t OSDMap::get_features(int entity_type, uint64_t *pmask) const
     features |= CEPH_FEATUREMASK_CRUSH_MSR;
   mask |= CEPH_FEATURES_CRUSH;
 
-  if (!pg_upmap.empty() || !pg_upmap_items.empty())
+  if (!pg_upmap->empty() || !pg_upmap_items->empty())
     features |= CEPH_FEATUREMASK_OSDMAP_PG_UPMAP;
   mask |= CEPH_FEATUREMASK_OSDMAP_PG_UPMAP;
-  if (!pg_upmap_primaries.empty())
+  if (!pg_upmap_primaries->empty())
     features |= CEPH_FEATUREMASK_SERVER_REEF;
   mask |= CEPH_FEATUREMASK_SERVER_REEF;
 
@@ -1937,34 +1938,37 @@ void OSDMap::dedup(const OSDMap *o, OSDMap *n)
 
   int diff = 0;
 
-  // do addrs match?
-  if (o->max_osd != n->max_osd)
-    diff++;
-  for (int i = 0; i < o->max_osd && i < n->max_osd; i++) {
-    if ( n->osd_addrs->client_addrs[i] &&  o->osd_addrs->client_addrs[i] &&
-	*n->osd_addrs->client_addrs[i] == *o->osd_addrs->client_addrs[i])
-      n->osd_addrs->client_addrs[i] = o->osd_addrs->client_addrs[i];
-    else
-      diff++;
-    if ( n->osd_addrs->cluster_addrs[i] &&  o->osd_addrs->cluster_addrs[i] &&
-	*n->osd_addrs->cluster_addrs[i] == *o->osd_addrs->cluster_addrs[i])
-      n->osd_addrs->cluster_addrs[i] = o->osd_addrs->cluster_addrs[i];
-    else
-      diff++;
-    if ( n->osd_addrs->hb_back_addrs[i] &&  o->osd_addrs->hb_back_addrs[i] &&
-	*n->osd_addrs->hb_back_addrs[i] == *o->osd_addrs->hb_back_addrs[i])
-      n->osd_addrs->hb_back_addrs[i] = o->osd_addrs->hb_back_addrs[i];
-    else
+  // do addrs match?  (leave them alone if n shares them with another
+  // map, see deepish_copy_from())
+  if (n->osd_addrs.use_count() == 1) {
+    if (o->max_osd != n->max_osd)
       diff++;
-    if ( n->osd_addrs->hb_front_addrs[i] &&  o->osd_addrs->hb_front_addrs[i] &&
-	*n->osd_addrs->hb_front_addrs[i] == *o->osd_addrs->hb_front_addrs[i])
-      n->osd_addrs->hb_front_addrs[i] = o->osd_addrs->hb_front_addrs[i];
-    else
-      diff++;
-  }
-  if (diff == 0) {
-    // zoinks, no differences at all!
-    n->osd_addrs = o->osd_addrs;
+    for (int i = 0; i < o->max_osd && i < n->max_osd; i++) {
+      if ( n->osd_addrs->client_addrs[i] &&  o->osd_addrs->client_addrs[i] &&
+	  *n->osd_addrs->client_addrs[i] == *o->osd_addrs->client_addrs[i])
+        n->osd_addrs->client_addrs[i] = o->osd_addrs->client_addrs[i];
+      else
+        diff++;
+      if ( n->osd_addrs->cluster_addrs[i] &&  o->osd_addrs->cluster_addrs[i] &&
+	  *n->osd_addrs->cluster_addrs[i] == *o->osd_addrs->cluster_addrs[i])
+        n->osd_addrs->cluster_addrs[i] = o->osd_addrs->cluster_addrs[i];
+      else
+        diff++;
+      if ( n->osd_addrs->hb_back_addrs[i] &&  o->osd_addrs->hb_back_addrs[i] &&
+	  *n->osd_addrs->hb_back_addrs[i] == *o->osd_addrs->hb_back_addrs[i])
+        n->osd_addrs->hb_back_addrs[i] = o->osd_addrs->hb_back_addrs[i];
+      else
+        diff++;
+      if ( n->osd_addrs->hb_front_addrs[i] &&  o->osd_addrs->hb_front_addrs[i] &&
+	  *n->osd_addrs->hb_front_addrs[i] == *o->osd_addrs->hb_front_addrs[i])
+        n->osd_addrs->hb_front_addrs[i] = o->osd_addrs->hb_front_addrs[i];
+      else
+        diff++;
+    }
+    if (diff == 0) {
+      // zoinks, no differences at all!
+      n->osd_addrs = o->osd_addrs;
+    }
   }
 
   // does crush match?
@@ -1989,6 +1993,22 @@ void OSDMap::dedup(const OSDMap *o, OSDMap *n)
   if (o->osd_uuid->size() == n->osd_uuid->size() &&
       *o->osd_uuid == *n->osd_uuid)
     n->osd_uuid = o->osd_uuid;
+
+  // do xinfos match?
+  if (o->osd_xinfo != n->osd_xinfo &&
+      *o->osd_xinfo == *n->osd_xinfo)
+    n->osd_xinfo = o->osd_xinfo;
+
+  // do upmaps match?
+  if (o->pg_upmap != n->pg_upmap &&
+      *o->pg_upmap == *n->pg_upmap)
+    n->pg_upmap = o->pg_upmap;
+  if (o->pg_upmap_items != n->pg_upmap_items &&
+      *o->pg_upmap_items == *n->pg_upmap_items)
+    n->pg_upmap_items = o->pg_upmap_items;
+  if (o->pg_upmap_primaries != n->pg_upmap_primaries &&
+      *o->pg_upmap_primaries == *n->pg_upmap_primaries)
+    n->pg_upmap_primaries = o->pg_upmap_primaries;
 }
 
 void OSDMap::clean_temps(CephContext *cct,
@@ -2102,15 +2122,57 @@ void OSDMap::clean_temps(CephContext *cct,
 
 void OSDMap::get_upmap_pgs(vector<pg_t> *upmap_pgs) const
 {
-  upmap_pgs->reserve(pg_upmap.size() + pg_upmap_items.size() + pg_upmap_primaries.size());
-  for (auto& p : pg_upmap)
+  upmap_pgs->reserve(pg_upmap->size() + pg_upmap_items->size() + pg_upmap_primaries->size());
+  for (auto& p : *pg_upmap)
     upmap_pgs->push_back(p.first);
-  for (auto& p : pg_upmap_items)
+  for (auto& p : *pg_upmap_items)
     upmap_pgs->push_back(p.first);
-  for (auto& p : pg_upmap_primaries)
+  for (auto& p : *pg_upmap_primaries)
     upmap_pgs->push_back(p.first);
 }
 
+void OSDMap::get_temp_and_upmap_pgs(const set<int>& osds,
+                                    set<pg_t> *pgs) const
+{
+  if (osds.empty()) {
+    return;
+  }
+  for (const auto& pg : *pg_temp) {
+    for (auto osd : pg.second) {
+      if (osds.count(osd)) {
+        pgs->insert(pg.first);
+        break;
+      }
+    }
+  }
+  for (auto& [pg, osd] : *primary_temp) {
+    if (osds.count(osd)) {
+      pgs->insert(pg);
+    }
+  }
+  for (auto& [pg, um] : *pg_upmap) {
+    for (auto osd : um) {
+      if (osds.count(osd)) {
+        pgs->insert(pg);
+        break;
+      }
+    }
+  }
+  for (auto& [pg, items] : *pg_upmap_items) {
+    for (auto& [from, to] : items) {
+      if (osds.count(from) || osds.count(to)) {
+        pgs->insert(pg);
+        break;
+      }
+    }
+  }
+  for (auto& [pg, osd] : *pg_upmap_primaries) {
+    if (osds.count(osd)) {
+      pgs->insert(pg);
+    }
+  }
+}
+
 bool OSDMap::check_pg_upmaps(
   CephContext *cct,
   const vector<pg_t>& to_check,
@@ -2191,8 +2253,8 @@ bool OSDMap::check_pg_upmaps(
 
     // okay, upmap is valid
     // continue to check if it is still necessary
-    auto i = pg_upmap.find(pg);
-    if (i != pg_upmap.end()) {
+    auto i = pg_upmap->find(pg);
+    if (i != pg_upmap->end()) {
       if (i->second == raw) {
         ldout(cct, 10) << __func__ << "removing redundant pg_upmap " << i->first << " "
                        << i->second << dendl;
@@ -2207,21 +2269,21 @@ bool OSDMap::check_pg_upmaps(
         continue;
       }
     }
-    auto j = pg_upmap_items.find(pg);
-    if (j != pg_upmap_items.end()) {
+    auto j = pg_upmap_items->find(pg);
+    if (j != pg_upmap_items->end()) {
       mempool::osdmap::vector<pair<int,int>> newmap;
       for (auto& p : j->second) {
 	auto osd_from = p.first;
 	auto osd_to = p.second;
         if (std::find(raw.begin(), raw.end(), osd_from) == raw.end()) {
           // cancel mapping if source osd does not exist anymore
-          ldout(cct, 20) << __func__ << " pg_upmap_items (source osd does not exist) " << pg_upmap_items << dendl;
+          ldout(cct, 20) << __func__ << " pg_upmap_items (source osd does not exist) " << *pg_upmap_items << dendl;
           continue;
         }
         if (osd_to != CRUSH_ITEM_NONE && osd_to < max_osd &&
             osd_to >= 0 && osd_weight[osd_to] == 0) {
           // cancel mapping if target osd is out
-          ldout(cct, 20) << __func__ << " pg_upmap_items (target osd is out) " << pg_upmap_items << dendl;
+          ldout(cct, 20) << __func__ << " pg_upmap_items (target osd is out) " << *pg_upmap_items << dendl;
           continue;
         }
         newmap.push_back(p);
@@ -2243,8 +2305,8 @@ bool OSDMap::check_pg_upmaps(
     }
     // Cancel any pg_upmap_primary mapping where the mapping is set
     //   to an OSD outside the raw set, or if the mapping is redundant
-    auto k = pg_upmap_primaries.find(pg);
-    if (k != pg_upmap_primaries.end()) {
+    auto k = pg_upmap_primaries->find(pg);
+    if (k != pg_upmap_primaries->end()) {
       auto curr_prim = k->second;
       bool valid_prim = false;
       for (auto osd : raw) {
@@ -2283,8 +2345,8 @@ void OSDMap::clean_pg_upmaps(
                      << dendl;
       pending_inc->new_pg_upmap.erase(i);
     }
-    auto j = pg_upmap.find(pg);
-    if (j != pg_upmap.end()) {
+    auto j = pg_upmap->find(pg);
+    if (j != pg_upmap->end()) {
       ldout(cct, 10) << __func__ << " cancel invalid pg_upmap entry "
                      << j->first << "->" << j->second
                      << dendl;
@@ -2298,8 +2360,8 @@ void OSDMap::clean_pg_upmaps(
 		     << dendl;
       pending_inc->new_pg_upmap_primary.erase(k);
     }
-    auto l = pg_upmap_primaries.find(pg);
-    if (l != pg_upmap_primaries.end()) {
+    auto l = pg_upmap_primaries->find(pg);
+    if (l != pg_upmap_primaries->end()) {
       ldout(cct, 10) << __func__ << " cancel invalid pg_upmap_primaries entry "
 	             << l->first << "->" << l->second
 		     << dendl;
@@ -2313,8 +2375,8 @@ void OSDMap::clean_pg_upmaps(
                      << dendl;
       pending_inc->new_pg_upmap_items.erase(p);
     }
-    auto q = pg_upmap_items.find(pg);
-    if (q != pg_upmap_items.end()) {
+    auto q = pg_upmap_items->find(pg);
+    if (q != pg_upmap_items->end()) {
       ldout(cct, 10) << __func__ << " cancel invalid "
                      << "pg_upmap_items entry "
                      << q->first << "->" << q->second
@@ -2338,8 +2400,8 @@ void OSDMap::clean_pg_upmaps(
                      << dendl;
       pending_inc->new_pg_upmap_primary.erase(k);
     }
-    auto l = pg_upmap_primaries.find(pg_prim);
-    if (l != pg_upmap_primaries.end()) {
+    auto l = pg_upmap_primaries->find(pg_prim);
+    if (l != pg_upmap_primaries->end()) {
       ldout(cct, 10) << __func__ << " cancel invalid pg_upmap_primaries entry "
                      << l->first << "->" << l->second
                      << dendl;
@@ -2472,7 +2534,7 @@ int OSDMap::apply_incremental(const Incremental &inc)
     // xinfo old_weight.
     if (weight.second) {
       osd_state[weight.first] &= ~(CEPH_OSD_AUTOOUT | CEPH_OSD_NEW);
-      osd_xinfo[weight.first].old_weight = 0;
+      cow(osd_xinfo)[weight.first].old_weight = 0;
     }
   }
 
@@ -2495,19 +2557,20 @@ int OSDMap::apply_incremental(const Incremental &inc)
     if ((osd_state[osd] & CEPH_OSD_UP) &&
 	(s & CEPH_OSD_UP)) {
       osd_info[osd].down_at = epoch;
-      osd_xinfo[osd].down_stamp = modified;
+      cow(osd_xinfo)[osd].down_stamp = modified;
     }
     if ((osd_state[osd] & CEPH_OSD_EXISTS) &&
 	(s & CEPH_OSD_EXISTS)) {
       // osd is destroyed; clear out anything interesting.
-      (*osd_uuid)[osd] = uuid_d();
+      cow(osd_uuid)[osd] = uuid_d();
       osd_info[osd] = osd_info_t();
-      osd_xinfo[osd] = osd_xinfo_t();
+      cow(osd_xinfo)[osd] = osd_xinfo_t();
       set_primary_affinity(osd, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY);
-      osd_addrs->client_addrs[osd].reset(new entity_addrvec_t());
-      osd_addrs->cluster_addrs[osd].reset(new entity_addrvec_t());
-      osd_addrs->hb_front_addrs[osd].reset(new entity_addrvec_t());
-      osd_addrs->hb_back_addrs[osd].reset(new entity_addrvec_t());
+      auto& addrs = cow(osd_addrs);
+      addrs.client_addrs[osd].reset(new entity_addrvec_t());
+      addrs.cluster_addrs[osd].reset(new entity_addrvec_t());
+      addrs.hb_front_addrs[osd].reset(new entity_addrvec_t());
+      addrs.hb_back_addrs[osd].reset(new entity_addrvec_t());
       osd_state[osd] = 0;
     } else {
       osd_state[osd] ^= s;
@@ -2517,18 +2580,19 @@ int OSDMap::apply_incremental(const Incremental &inc)
   for (const auto &client : inc.new_up_client) {
     osd_state[client.first] |= CEPH_OSD_EXISTS | CEPH_OSD_UP;
     osd_state[client.first] &= ~CEPH_OSD_STOP; // if any
-    osd_addrs->client_addrs[client.first].reset(
+    auto& addrs = cow(osd_addrs);
+    addrs.client_addrs[client.first].reset(
       new entity_addrvec_t(client.second));
-    osd_addrs->hb_back_addrs[client.first].reset(
+    addrs.hb_back_addrs[client.first].reset(
       new entity_addrvec_t(inc.new_hb_back_up.find(client.first)->second));
-    osd_addrs->hb_front_addrs[client.first].reset(
+    addrs.hb_front_addrs[client.first].reset(
       new entity_addrvec_t(inc.new_hb_front_up.find(client.first)->second));
 
     osd_info[client.first].up_from = epoch;
   }
 
   for (const auto &cluster : inc.new_up_cluster)
-    osd_addrs->cluster_addrs[cluster.first].reset(
+    cow(osd_addrs).cluster_addrs[cluster.first].reset(
       new entity_addrvec_t(cluster.second));
 
   // info
@@ -2545,49 +2609,49 @@ int OSDMap::apply_incremental(const Incremental &inc)
 
   // xinfo
   for (const auto &xinfo : inc.new_xinfo)
-    osd_xinfo[xinfo.first] = xinfo.second;
+    cow(osd_xinfo)[xinfo.first] = xinfo.second;
 
   // uuid
   for (const auto &uuid : inc.new_uuid)
-    (*osd_uuid)[uuid.first] = uuid.second;
+    cow(osd_uuid)[uuid.first] = uuid.second;
 
   // pg rebuild
   for (const auto &pg : inc.new_pg_temp) {
     if (pg.second.empty())
-      pg_temp->erase(pg.first);
+      cow(pg_temp).erase(pg.first);
     else
-      pg_temp->set(pg.first, pg.second);
+      cow(pg_temp).set(pg.first, pg.second);
   }
   if (!inc.new_pg_temp.empty()) {
     // make sure pg_temp is efficiently stored
-    pg_temp->rebuild();
+    cow(pg_temp).rebuild();
   }
 
   for (const auto &pg : inc.new_primary_temp) {
     if (pg.second == -1)
-      primary_temp->erase(pg.first);
+      cow(primary_temp).erase(pg.first);
     else
-      (*primary_temp)[pg.first] = pg.second;
+      cow(primary_temp)[pg.first] = pg.second;
   }
 
   for (auto& p : inc.new_pg_upmap) {
-    pg_upmap[p.first] = p.second;
+    cow(pg_upmap)[p.first] = p.second;
   }
   for (auto& pg : inc.old_pg_upmap) {
-    pg_upmap.erase(pg);
+    cow(pg_upmap).erase(pg);
   }
   for (auto& p : inc.new_pg_upmap_items) {
-    pg_upmap_items[p.first] = p.second;
+    cow(pg_upmap_items)[p.first] = p.second;
   }
   for (auto& pg : inc.old_pg_upmap_items) {
-    pg_upmap_items.erase(pg);
+    cow(pg_upmap_items).erase(pg);
   }
 
   for (auto& [pg, prim] : inc.new_pg_upmap_primary) {
-    pg_upmap_primaries[pg] = prim;
+    cow(pg_upmap_primaries)[pg] = prim;
   }
   for (auto& pg : inc.old_pg_upmap_primary) {
-    pg_upmap_primaries.erase(pg);
+    cow(pg_upmap_primaries).erase(pg);
   }
 
   // blocklist
@@ -2809,8 +2873,8 @@ int OSDMap::_pick_primary(const vector<int>& osds) const
 void OSDMap::_apply_upmap(const pg_pool_t& pi, pg_t raw_pg, vector<int> *raw) const
 {
   pg_t pg = pi.raw_pg_to_pg(raw_pg);
-  auto p = pg_upmap.find(pg);
-  if (p != pg_upmap.end()) {
+  auto p = pg_upmap->find(pg);
+  if (p != pg_upmap->end()) {
     // make sure targets aren't marked out
     for (auto osd : p->second) {
       if (osd != CRUSH_ITEM_NONE && osd < max_osd && osd >= 0 &&
@@ -2823,8 +2887,8 @@ void OSDMap::_apply_upmap(const pg_pool_t& pi, pg_t raw_pg, vector<int> *raw) co
     // continue to check and apply pg_upmap_items if any
   }
 
-  auto q = pg_upmap_items.find(pg);
-  if (q != pg_upmap_items.end()) {
+  auto q = pg_upmap_items->find(pg);
+  if (q != pg_upmap_items->end()) {
     // NOTE: this approach does not allow a bidirectional swap,
     // e.g., [[1,2],[2,1]] applied to [0,1,2] -> [0,2,1].
     for (auto& [osd_from, osd_to] : q->second) {
@@ -2851,8 +2915,8 @@ void OSDMap::_apply_upmap(const pg_pool_t& pi, pg_t raw_pg, vector<int> *raw) co
       }
     }
   }
-  auto r = pg_upmap_primaries.find(pg);
-  if (r != pg_upmap_primaries.end()) {
+  auto r = pg_upmap_primaries->find(pg);
+  if (r != pg_upmap_primaries->end()) {
     auto new_prim = r->second;	
     // Apply mapping only if new primary is not marked out and valid osd id
     if (new_prim != CRUSH_ITEM_NONE && new_prim < max_osd && new_prim >= 0 &&
@@ -3388,7 +3452,7 @@ void OSDMap::encode_classic(ceph::buffer::list& bl, uint64_t features) const
   encode(cluster_snapshot_epoch, bl);
   encode(cluster_snapshot, bl);
   encode(*osd_uuid, bl);
-  encode(osd_xinfo, bl, features);
+  encode(*osd_xinfo, bl, features);
   encode(osd_addrs->hb_front_addrs, bl, features);
 }
 
@@ -3489,11 +3553,11 @@ void OSDMap::encode(ceph::buffer::list& bl, uint64_t features) const
     encode(erasure_code_profiles, bl);
 
     if (v >= 4) {
-      encode(pg_upmap, bl);
-      encode(pg_upmap_items, bl);
+      encode(*pg_upmap, bl);
+      encode(*pg_upmap_items, bl);
     } else {
-      ceph_assert(pg_upmap.empty());
-      ceph_assert(pg_upmap_items.empty());
+      ceph_assert(pg_upmap->empty());
+      ceph_assert(pg_upmap_items->empty());
     }
     if (v >= 6) {
       encode(crush_version, bl);
@@ -3507,9 +3571,9 @@ void OSDMap::encode(ceph::buffer::list& bl, uint64_t features) const
       encode(last_in_change, bl);
     }
     if (v >= 10) {
-      encode(pg_upmap_primaries, bl);
+      encode(*pg_upmap_primaries, bl);
     } else {
-      ceph_assert(pg_upmap_primaries.empty());
+      ceph_assert(pg_upmap_primaries->empty());
     }
     ENCODE_FINISH(bl); // client-usable data
   }
@@ -3557,7 +3621,7 @@ void OSDMap::encode(ceph::buffer::list& bl, uint64_t features) const
     encode(cluster_snapshot_epoch, bl);
     encode(cluster_snapshot, bl);
     encode(*osd_uuid, bl);
-    encode(osd_xinfo, bl, features);
+    encode(*osd_xinfo, bl, features);
     if (target_v < 7) {
       encode_addrvec_pvec_as_addr(osd_addrs->hb_front_addrs, bl, features);
     } else {
@@ -3736,9 +3800,9 @@ void OSDMap::decode_classic(ceph::buffer::list::const_iterator& p)
     osd_uuid->resize(max_osd);
   }
   if (ev >= 9)
-    decode(osd_xinfo, p);
+    decode(*osd_xinfo, p);
   else
-    osd_xinfo.resize(max_osd);
+    osd_xinfo->resize(max_osd);
 
   if (ev >= 10)
     decode(osd_addrs->hb_front_addrs, p);
@@ -3764,6 +3828,19 @@ void OSDMap::decode(ceph::buffer::list::const_iterator& bl)
   size_t tail_offset = 0;
   ceph::buffer::list crc_front, crc_tail;
 
+  // the tables may be shared with other maps (see deepish_copy_from()),
+  // decode into fresh ones
+  osd_addrs = std::make_shared<addrs_s>();
+  pg_temp = std::make_shared<PGTempMap>();
+  primary_temp = std::make_shared<mempool::osdmap::map<pg_t,int32_t>>();
+  pg_upmap = std::make_shared<
+    mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>>>();
+  pg_upmap_items = std::make_shared<
+    mempool::osdmap::map<pg_t,mempool::osdmap::vector<pair<int32_t,int32_t>>>>();
+  pg_upmap_primaries = std::make_shared<mempool::osdmap::map<pg_t,int32_t>>();
+  osd_uuid = std::make_shared<mempool::osdmap::vector<uuid_d>>();
+  osd_xinfo = std::make_shared<mempool::osdmap::vector<osd_xinfo_t>>();
+
   DECODE_START_LEGACY_COMPAT_LEN(8, 7, 7, bl); // wrapper
   if (struct_v < 7) {
     bl.seek(start_offset);
@@ -3830,11 +3907,11 @@ void OSDMap::decode(ceph::buffer::list::const_iterator& bl)
     // version increased from 3 to 4 still in luminous, so same as above
     // applies.
     if (struct_v >= 4) {
-      decode(pg_upmap, bl);
-      decode(pg_upmap_items, bl);
+      decode(*pg_upmap, bl);
+      decode(*pg_upmap_items, bl);
     } else {
-      pg_upmap.clear();
-      pg_upmap_items.clear();
+      pg_upmap->clear();
+      pg_upmap_items->clear();
     }
     // again, version increased from 5 to 6 still in luminous, so above
     // applies.
@@ -3852,9 +3929,9 @@ void OSDMap::decode(ceph::buffer::list::const_iterator& bl)
       decode(last_in_change, bl);
     }
     if (struct_v >= 10) {
-      decode(pg_upmap_primaries, bl);
+      decode(*pg_upmap_primaries, bl);
     } else {
-      pg_upmap_primaries.clear();
+      pg_upmap_primaries->clear();
     }
     DECODE_FINISH(bl); // client-usable data
   }
@@ -3868,7 +3945,7 @@ void OSDMap::decode(ceph::buffer::list::const_iterator& bl)
     decode(cluster_snapshot_epoch, bl);
     decode(cluster_snapshot, bl);
     decode(*osd_uuid, bl);
-    decode(osd_xinfo, bl);
+    decode(*osd_xinfo, bl);
     decode(osd_addrs->hb_front_addrs, bl);
     // 
     if (struct_v >= 2) {
@@ -4188,14 +4265,14 @@ void OSDMap::dump(Formatter *f, CephContext *cct) const
     if (exists(i)) {
       f->open_object_section("xinfo");
       f->dump_int("osd", i);
-      osd_xinfo[i].dump(f);
+      (*osd_xinfo)[i].dump(f);
       f->close_section();
     }
   }
   f->close_section();
 
   f->open_array_section("pg_upmap");
-  for (auto& p : pg_upmap) {
+  for (auto& p : *pg_upmap) {
     f->open_object_section("mapping");
     f->dump_stream("pgid") << p.first;
     f->open_array_section("osds");
@@ -4208,7 +4285,7 @@ void OSDMap::dump(Formatter *f, CephContext *cct) const
   f->close_section();
 
   f->open_array_section("pg_upmap_items");
-  for (auto& [pgid, mappings] : pg_upmap_items) {
+  for (auto& [pgid, mappings] : *pg_upmap_items) {
     f->open_object_section("mapping");
     f->dump_stream("pgid") << pgid;
     f->open_array_section("mappings");
@@ -4224,7 +4301,7 @@ void OSDMap::dump(Formatter *f, CephContext *cct) const
   f->close_section();
 
   f->open_array_section("pg_upmap_primaries");
-  for (const auto& [pg, osd] : pg_upmap_primaries) {
+  for (const auto& [pg, osd] : *pg_upmap_primaries) {
     f->open_object_section("primary_mapping");
     f->dump_stream("pgid") << pg;
     f->dump_int("primary_osd", osd);
@@ -4529,14 +4606,14 @@ void OSDMap::print(CephContext *cct, ostream& out) const
   print_osds(out);
   out << std::endl;
 
-  for (auto& p : pg_upmap) {
+  for (auto& p : *pg_upmap) {
     out << "pg_upmap " << p.first << " " << p.second << "\n";
   }
-  for (auto& p : pg_upmap_items) {
+  for (auto& p : *pg_upmap_items) {
     out << "pg_upmap_items " << p.first << " " << p.second << "\n";
   }
 
-  for (auto& [pg, osd] : pg_upmap_primaries) {
+  for (auto& [pg, osd] : *pg_upmap_primaries) {
     out << "pg_upmap_primary " << pg << " " << osd << "\n";
   }
 
@@ -5373,7 +5450,7 @@ int OSDMap::balance_primaries(
 	prim_dist_scores[up_primary] -= 1;
 
 	// Update the mappings
-	tmp_osd_map.pg_upmap_primaries[pg] = curr_best_osd;
+	cow(tmp_osd_map.pg_upmap_primaries)[pg] = curr_best_osd;
 	if (curr_best_osd == orig_prims[pg]) {
           pending_inc->new_pg_upmap_primary.erase(pg);
           prim_pgs_to_check[pg] = false;
@@ -5437,7 +5514,7 @@ void OSDMap::rm_all_upmap_prims(
         ldout(cct, 30) << __func__ << " Removing pending pg_upmap_prim for pg " << pg << dendl;
         pending_inc->new_pg_upmap_primary.erase(pg);
       }
-      if (pg_upmap_primaries.contains(pg)) {
+      if (pg_upmap_primaries->contains(pg)) {
         ldout(cct, 30) << __func__ << " Removing pg_upmap_prim for pg " << pg << dendl;
         pending_inc->old_pg_upmap_primary.insert(pg);
       }
@@ -5449,7 +5526,7 @@ void OSDMap::rm_all_upmap_prims(
   CephContext *cct,
   OSDMap::Incremental *pending_inc) const
 {
-  for (const auto& [pg, _] : pg_upmap_primaries) {
+  for (const auto& [pg, _] : *pg_upmap_primaries) {
     if (pending_inc->new_pg_upmap_primary.contains(pg)) {
         ldout(cct, 30) << __func__ << "Removing pending pg_upmap_prim for pg " << pg << dendl;
         pending_inc->new_pg_upmap_primary.erase(pg);
@@ -5909,8 +5986,8 @@ int OSDMap::calc_pg_upmaps(
 
       // try upmap
       for (auto pg : pgs) {
-        auto temp_it = tmp_osd_map.pg_upmap.find(pg);
-        if (temp_it != tmp_osd_map.pg_upmap.end()) {
+        auto temp_it = tmp_osd_map.pg_upmap->find(pg);
+        if (temp_it != tmp_osd_map.pg_upmap->end()) {
           // leave pg_upmap alone
           // it must be specified by admin since balancer does not
           // support pg_upmap yet
@@ -5922,8 +5999,8 @@ int OSDMap::calc_pg_upmaps(
         auto pg_pool_size = tmp_osd_map.get_pg_pool_size(pg);
         mempool::osdmap::vector<pair<int32_t,int32_t>> new_upmap_items;
         set<int> existing;
-        auto it = tmp_osd_map.pg_upmap_items.find(pg);
-        if (it != tmp_osd_map.pg_upmap_items.end()) {
+        auto it = tmp_osd_map.pg_upmap_items->find(pg);
+        if (it != tmp_osd_map.pg_upmap_items->end()) {
 	  auto& um_items = it->second;
           if (um_items.size() >= (size_t)pg_pool_size) {
             ldout(cct, 10) << " " << pg << " already has full-size pg_upmap_items "
@@ -6309,8 +6386,8 @@ int OSDMap::pack_upmap_results(
   int num_changed = 0;
   for (auto& i : to_unmap) {
     ldout(cct, 10) << " unmap pg " << i << dendl;
-    ceph_assert(tmp_osd_map.pg_upmap_items.count(i));
-    tmp_osd_map.pg_upmap_items.erase(i);
+    ceph_assert(tmp_osd_map.pg_upmap_items->count(i));
+    cow(tmp_osd_map.pg_upmap_items).erase(i);
     pending_inc->old_pg_upmap_items.insert(i);
     ++num_changed;
   }
@@ -6318,7 +6395,7 @@ int OSDMap::pack_upmap_results(
     ldout(cct, 10) << " upmap pg " << pg
                    << " new pg_upmap_items " << um_items
                    << dendl;
-    tmp_osd_map.pg_upmap_items[pg] = um_items;
+    cow(tmp_osd_map.pg_upmap_items)[pg] = um_items;
     pending_inc->new_pg_upmap_items[pg] = um_items;
     ++num_changed;
   }
@@ -6369,8 +6446,8 @@ bool OSDMap::try_drop_remap_overfull(
   //
   const float osd_dev = osd_deviation.at(osd);
   for (auto pg : pgs) {
-    auto p = tmp_osd_map.pg_upmap_items.find(pg);
-    if (p == tmp_osd_map.pg_upmap_items.end())
+    auto p = tmp_osd_map.pg_upmap_items->find(pg);
+    if (p == tmp_osd_map.pg_upmap_items->end())
       continue;
     mempool::osdmap::vector<pair<int32_t,int32_t>> new_upmap_items;
     auto& pg_upmap_items = p->second;
@@ -6543,8 +6620,8 @@ OSDMap::candidates_by_osd_t OSDMap::build_candidates_by_osd(
   // build the candidates data structure
   //
   candidates_t candidates;
-  candidates.reserve(tmp_osd_map.pg_upmap_items.size());
-  for (auto& [pg, um_pair] : tmp_osd_map.pg_upmap_items) {
+  candidates.reserve(tmp_osd_map.pg_upmap_items->size());
+  for (auto& [pg, um_pair] : *tmp_osd_map.pg_upmap_items) {
     if (to_skip.count(pg))
       continue;
     if (!only_pools.empty() && !only_pools.count(pg.pool()))
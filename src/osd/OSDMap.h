@@ -103,6 +103,8 @@ struct osd_xinfo_t {
   osd_xinfo_t() : laggy_probability(0), laggy_interval(0),
                   features(0), old_weight(0) {}
 
+  bool operator==(const osd_xinfo_t&) const = default;
+
   void dump(ceph::Formatter *f) const;
   void encode(ceph::buffer::list& bl, uint64_t features) const;
   void decode(ceph::buffer::list::const_iterator& bl);
@@ -600,9 +602,9 @@ private:
   std::shared_ptr< mempool::osdmap::vector<__u32> > osd_primary_affinity; ///< 16.16 fixed point, 0x10000 = baseline
 
   // remap (post-CRUSH, pre-up)
-  mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>> pg_upmap; ///< remap pg
-  mempool::osdmap::map<pg_t,mempool::osdmap::vector<std::pair<int32_t,int32_t>>> pg_upmap_items; ///< remap osds in up set
-  mempool::osdmap::map<pg_t, int32_t> pg_upmap_primaries; ///< remap primary of a pg
+  std::shared_ptr<mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>>> pg_upmap; ///< remap pg
+  std::shared_ptr<mempool::osdmap::map<pg_t,mempool::osdmap::vector<std::pair<int32_t,int32_t>>>> pg_upmap_items; ///< remap osds in up set
+  std::shared_ptr<mempool::osdmap::map<pg_t, int32_t>> pg_upmap_primaries; ///< remap primary of a pg
 
   mempool::osdmap::map<int64_t,pg_pool_t> pools;
   mempool::osdmap::map<int64_t,std::string> pool_name;
@@ -610,7 +612,7 @@ private:
   mempool::osdmap::map<std::string,int64_t, std::less<>> name_pool;
 
   std::shared_ptr< mempool::osdmap::vector<uuid_d> > osd_uuid;
-  mempool::osdmap::vector<osd_xinfo_t> osd_xinfo;
+  std::shared_ptr< mempool::osdmap::vector<osd_xinfo_t> > osd_xinfo;
 
   class range_bits {
     struct ip6 {
@@ -694,7 +696,11 @@ private:
 	     osd_addrs(std::make_shared<addrs_s>()),
 	     pg_temp(std::make_shared<PGTempMap>()),
 	     primary_temp(std::make_shared<mempool::osdmap::map<pg_t,int32_t>>()),
+	     pg_upmap(std::make_shared<mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>>>()),
+	     pg_upmap_items(std::make_shared<mempool::osdmap::map<pg_t,mempool::osdmap::vector<std::pair<int32_t,int32_t>>>>()),
+	     pg_upmap_primaries(std::make_shared<mempool::osdmap::map<pg_t,int32_t>>()),
 	     osd_uuid(std::make_shared<mempool::osdmap::vector<uuid_d>>()),
+	     osd_xinfo(std::make_shared<mempool::osdmap::vector<osd_xinfo_t>>()),
 	     cluster_snapshot_epoch(0),
 	     new_blocklist_entries(false),
 	     cached_up_osd_features(0),
@@ -707,6 +713,21 @@ private:
 private:
   OSDMap(const OSDMap& other) = default;
   OSDMap& operator=(const OSDMap& other) = default;
+
+  /**
+   * get a table of this map for modification
+   *
+   * The tables held by shared_ptr may be shared with maps of other
+   * epochs (see deepish_copy_from() and dedup()).  Copy the table first
+   * if that is the case, so the other maps are left alone.
+   */
+  template <typename T>
+  static T& cow(std::shared_ptr<T>& p) {
+    if (p.use_count() > 1) {
+      p = std::make_shared<T>(*p);
+    }
+    return *p;
+  }
 public:
 
   /// return feature mask subset that is relevant to OSDMap encoding
@@ -722,17 +743,17 @@ public:
 
   uint64_t get_encoding_features() const;
 
+  /**
+   * make this a copy of @p o that can be modified
+   *
+   * The tables held by shared_ptr (addrs, pg_temp, primary_temp,
+   * primary affinity, uuids, xinfo and the upmaps) are shared with @p o
+   * and only copied once they are modified, so a map derived from the
+   * previous epoch by apply_incremental() only pays for the tables the
+   * incremental touches.
+   */
   void deepish_copy_from(const OSDMap& o) {
     *this = o;
-    primary_temp.reset(new mempool::osdmap::map<pg_t,int32_t>(*o.primary_temp));
-    pg_temp.reset(new PGTempMap(*o.pg_temp));
-    osd_uuid.reset(new mempool::osdmap::vector<uuid_d>(*o.osd_uuid));
-
-    if (o.osd_primary_affinity)
-      osd_primary_affinity.reset(new mempool::osdmap::vector<__u32>(*o.osd_primary_affinity));
-
-    // NOTE: this still references shared entity_addrvec_t's.
-    osd_addrs.reset(new addrs_s(*o.osd_addrs));
 
     // NOTE: we do not copy crush.  note that apply_incremental will
     // allocate a new CrushWrapper, though.
@@ -856,7 +877,7 @@ public:
       osd_primary_affinity.reset(
 	new mempool::osdmap::vector<__u32>(
 	  max_osd, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY));
-    (*osd_primary_affinity)[o] = w;
+    cow(osd_primary_affinity)[o] = w;
   }
   unsigned get_primary_affinity(int o) const {
     ceph_assert(o < max_osd);
@@ -1075,7 +1096,7 @@ public:
 
   const osd_xinfo_t& get_xinfo(int osd) const {
     ceph_assert(osd < max_osd);
-    return osd_xinfo[osd];
+    return (*osd_xinfo)[osd];
   }
   
   int get_next_up_osd_after(int n) const {
@@ -1138,8 +1159,11 @@ public:
    */
   uint64_t get_up_osd_features() const;
 
-  int get_num_pg_upmap_primaries() const { return pg_upmap_primaries.size(); };
+  int get_num_pg_upmap_primaries() const { return pg_upmap_primaries->size(); };
   void get_upmap_pgs(std::vector<pg_t> *upmap_pgs) const;
+  /// pgs with a pg_temp, primary_temp or upmap naming any of @p osds
+  void get_temp_and_upmap_pgs(const std::set<int>& osds,
+                              std::set<pg_t> *pgs) const;
   bool check_pg_upmaps(
     CephContext *cct,
     const std::vector<pg_t>& to_check,
@@ -1765,8 +1789,8 @@ public:
   int get_osds_by_bucket_name(const std::string &name, std::set<int> *osds) const;
 
   bool have_pg_upmaps(pg_t pg) const {
-    return pg_upmap.count(pg) ||
-      pg_upmap_items.count(pg);
+    return pg_upmap->count(pg) ||
+      pg_upmap_items->count(pg);
   }
 
   bool check_full(const std::set<pg_shard_t> &missing_on) const {
@@ -1822,8 +1846,8 @@ public:
   int validate_crush_rules(CrushWrapper *crush, std::ostream *ss) const;
 
   void clear_temp() {
-    pg_temp->clear();
-    primary_temp->clear();
+    cow(pg_temp).clear();
+    cow(primary_temp).clear();
   }
 
 private:
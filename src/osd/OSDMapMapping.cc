@@ -9,6 +9,7 @@
 #include "common/debug.h"
 #include "crush/crush.h" // for CRUSH_ITEM_NONE
 
+using std::set;
 using std::vector;
 
 MEMPOOL_DEFINE_OBJECT_FACTORY(OSDMapMapping, osdmapmapping,
@@ -16,7 +17,8 @@ MEMPOOL_DEFINE_OBJECT_FACTORY(OSDMapMapping, osdmapmapping,
 
 // ensure that we have a PoolMappings for each pool and that
 // the dimensions (pg_num and size) match up.
-void OSDMapMapping::_init_mappings(const OSDMap& osdmap)
+void OSDMapMapping::_init_mappings(const OSDMap& osdmap,
+				   set<int64_t> *recreated)
 {
   num_pgs = 0;
   auto q = pools.begin();
@@ -40,6 +42,9 @@ void OSDMapMapping::_init_mappings(const OSDMap& osdmap)
     pools.emplace(p.first, PoolMapping(p.second.get_size(),
 				       p.second.get_pg_num(),
 				       p.second.is_erasure()));
+    if (recreated) {
+      recreated->insert(p.first);
+    }
   }
   pools.erase(q, pools.end());
   ceph_assert(pools.size() == osdmap.get_pools().size());
@@ -47,9 +52,20 @@ void OSDMapMapping::_init_mappings(const OSDMap& osdmap)
 
 void OSDMapMapping::update(const OSDMap& osdmap)
 {
-  _start(osdmap);
-  for (auto& p : osdmap.get_pools()) {
-    _update_range(osdmap, p.first, 0, p.second.get_pg_num());
+  set<int64_t> dirty_pools;
+  vector<pg_t> dirty_pgs;
+  if (_start(osdmap, &dirty_pools, &dirty_pgs)) {
+    for (auto pool : dirty_pools) {
+      _update_range(osdmap, pool, 0,
+		    osdmap.get_pg_pool(pool)->get_pg_num());
+    }
+    for (auto pgid : dirty_pgs) {
+      update(osdmap, pgid);
+    }
+  } else {
+    for (auto& p : osdmap.get_pools()) {
+      _update_range(osdmap, p.first, 0, p.second.get_pg_num());
+    }
   }
   _finish(osdmap);
   //_dump();  // for debugging
@@ -60,6 +76,246 @@ void OSDMapMapping::update(const OSDMap& osdmap, pg_t pgid)
   _update_range(osdmap, pgid.pool(), pgid.ps(), pgid.ps() + 1);
 }
 
+void OSDMapMapping::Changes::append(Changes&& next)
+{
+  if (!next.last) {
+    return;
+  }
+  if (!last) {
+    *this = std::move(next);
+    return;
+  }
+  all = all || next.all || next.first != last + 1;
+  last = next.last;
+  if (all) {
+    pools.clear();
+    pgs.clear();
+    osds.clear();
+    weight_osds.clear();
+    affinity_osds.clear();
+    return;
+  }
+  pools.merge(next.pools);
+  pgs.merge(next.pgs);
+  osds.merge(next.osds);
+  weight_osds.merge(next.weight_osds);
+  affinity_osds.merge(next.affinity_osds);
+}
+
+void OSDMapMapping::note_incremental(const OSDMap::Incremental& inc)
+{
+  Changes c;
+  c.first = c.last = inc.epoch;
+  if (inc.fullmap.length() || inc.crush.length()) {
+    // a new crush map can move any pg
+    c.all = true;
+    pending.append(std::move(c));
+    return;
+  }
+  for (auto& p : inc.new_pools) {
+    c.pools.insert(p.first);
+  }
+  for (auto& p : inc.new_pg_temp) {
+    c.pgs.insert(p.first);
+  }
+  for (auto& p : inc.new_primary_temp) {
+    c.pgs.insert(p.first);
+  }
+  for (auto& p : inc.new_pg_upmap) {
+    c.pgs.insert(p.first);
+  }
+  for (auto& p : inc.new_pg_upmap_items) {
+    c.pgs.insert(p.first);
+  }
+  for (auto& p : inc.new_pg_upmap_primary) {
+    c.pgs.insert(p.first);
+  }
+  c.pgs.insert(inc.old_pg_upmap.begin(), inc.old_pg_upmap.end());
+  c.pgs.insert(inc.old_pg_upmap_items.begin(), inc.old_pg_upmap_items.end());
+  c.pgs.insert(inc.old_pg_upmap_primary.begin(),
+	       inc.old_pg_upmap_primary.end());
+  for (auto& [osd, state] : inc.new_state) {
+    // the other state bits (e.g. nearfull) have no say in the mapping
+    if (!state || (state & (CEPH_OSD_UP | CEPH_OSD_EXISTS))) {
+      c.osds.insert(osd);
+    }
+  }
+  for (auto& p : inc.new_up_client) {
+    c.osds.insert(p.first);
+  }
+  for (auto& p : inc.new_weight) {
+    c.weight_osds.insert(p.first);
+  }
+  for (auto& p : inc.new_primary_affinity) {
+    c.affinity_osds.insert(p.first);
+  }
+  pending.append(std::move(c));
+}
+
+bool OSDMapMapping::_start(const OSDMap& osdmap,
+			   set<int64_t> *dirty_pools,
+			   vector<pg_t> *dirty_pgs)
+{
+  // if the previous job was aborted, whatever it was redoing still
+  // needs to be redone
+  in_flight.append(std::move(pending));
+  pending = Changes();
+
+  set<int64_t> recreated;
+  _init_mappings(osdmap, &recreated);
+  bool incremental = complete && dirty_pools && dirty_pgs &&
+    !in_flight.all &&
+    in_flight.first == epoch + 1 &&
+    in_flight.last == osdmap.get_epoch();
+  if (!incremental) {
+    complete = false;
+    return false;
+  }
+  in_flight.pools.merge(recreated);
+  _get_dirty(osdmap, dirty_pools, dirty_pgs);
+  return true;
+}
+
+void OSDMapMapping::_get_dirty(const OSDMap& osdmap,
+			       set<int64_t> *dirty_pools,
+			       vector<pg_t> *dirty_pgs)
+{
+  for (auto pool : in_flight.pools) {
+    if (osdmap.have_pg_pool(pool)) {
+      dirty_pools->insert(pool);
+    }
+  }
+
+  // an osd that came up or was reweighted may now be chosen for any pg
+  // of a pool whose rule takes from a subtree containing it, while an
+  // osd that only went down just drops out of the pgs it is in.
+  set<int> placed = in_flight.weight_osds;
+  set<int> dropped;
+  for (auto osd : in_flight.osds) {
+    if (!in_flight.weight_osds.count(osd) && !osdmap.is_up(osd)) {
+      dropped.insert(osd);
+    } else {
+      placed.insert(osd);
+    }
+  }
+  if (!placed.empty()) {
+    const auto& crush = *osdmap.crush;
+    std::map<int, bool> take_hit;  // take item -> contains a placed osd
+    for (auto& [poolid, pool] : osdmap.get_pools()) {
+      int rule = pool.get_crush_rule();
+      if (dirty_pools->count(poolid) || !crush.rule_exists(rule)) {
+	continue;
+      }
+      bool hit = false;
+      for (int step = 0; step < crush.get_rule_len(rule) && !hit; ++step) {
+	if (crush.get_rule_op(rule, step) != CRUSH_RULE_TAKE) {
+	  continue;
+	}
+	int take = crush.get_rule_arg1(rule, step);
+	auto p = take_hit.find(take);
+	if (p == take_hit.end()) {
+	  set<int> children;
+	  crush.get_all_children(take, &children);
+	  children.insert(take);
+	  bool any = false;
+	  for (auto osd : placed) {
+	    if (children.count(osd)) {
+	      any = true;
+	      break;
+	    }
+	  }
+	  p = take_hit.emplace(take, any).first;
+	}
+	hit = p->second;
+      }
+      if (hit) {
+	dirty_pools->insert(poolid);
+      }
+    }
+  }
+
+  set<pg_t> pgs = in_flight.pgs;
+  set<int> changed = placed;
+  changed.insert(dropped.begin(), dropped.end());
+  osdmap.get_temp_and_upmap_pgs(changed, &pgs);
+
+  // the rows of the remaining pools tell where the osds that went down or
+  // changed their primary affinity are in use
+  if (!dropped.empty() || !in_flight.affinity_osds.empty()) {
+    enum : uint8_t { IN_ACTING = 1, IN_UP = 2 };
+    int max_osd = osdmap.get_max_osd();
+    if (!dropped.empty()) {
+      max_osd = std::max(max_osd, *dropped.rbegin() + 1);
+    }
+    if (!in_flight.affinity_osds.empty()) {
+      max_osd = std::max(max_osd, *in_flight.affinity_osds.rbegin() + 1);
+    }
+    vector<uint8_t> flags(max_osd, 0);
+    for (auto osd : dropped) {
+      if (osd >= 0) {
+	flags[osd] |= IN_ACTING | IN_UP;
+      }
+    }
+    for (auto osd : in_flight.affinity_osds) {
+      if (osd >= 0) {
+	flags[osd] |= IN_UP;
+      }
+    }
+    auto flagged = [&](int32_t osd, uint8_t what) {
+      return osd >= 0 && osd < max_osd && (flags[osd] & what);
+    };
+    for (auto& [poolid, pm] : pools) {
+      if (dirty_pools->count(poolid)) {
+	continue;
+      }
+      for (unsigned ps = 0; ps < pm.pg_num; ++ps) {
+	const int32_t *row = &pm.table[pm.row_size() * ps];
+	bool hit = false;
+	for (int i = 0; i < row[2] && !hit; ++i) {
+	  hit = flagged(row[4 + i], IN_ACTING);
+	}
+	for (int i = 0; i < row[3] && !hit; ++i) {
+	  hit = flagged(row[4 + pm.size + i], IN_UP);
+	}
+	if (hit) {
+	  pgs.insert(pg_t(ps, poolid));
+	}
+      }
+    }
+  }
+
+  for (auto pgid : pgs) {
+    auto p = pools.find(pgid.pool());
+    if (p == pools.end() ||
+	pgid.ps() >= p->second.pg_num ||
+	dirty_pools->count(pgid.pool())) {
+      continue;
+    }
+    dirty_pgs->push_back(pgid);
+  }
+}
+
+std::unique_ptr<OSDMapMapping::MappingJob> OSDMapMapping::start_update(
+  const OSDMap& map,
+  ParallelPGMapper& mapper,
+  unsigned pgs_per_item)
+{
+  std::unique_ptr<MappingJob> job(new MappingJob(&map, this));
+  // hold the job open while queuing so that it cannot complete early; if
+  // there turns out to be nothing to remap it completes right here.
+  job->start_one();
+  if (job->incremental) {
+    mapper.queue_pools(job.get(), pgs_per_item, job->pools);
+    if (!job->pgs.empty()) {
+      mapper.queue(job.get(), pgs_per_item, job->pgs);
+    }
+  } else {
+    mapper.queue(job.get(), pgs_per_item, {});
+  }
+  job->finish_one();
+  return job;
+}
+
 void OSDMapMapping::_build_rmap(const OSDMap& osdmap)
 {
   acting_rmap.resize(osdmap.get_max_osd());
@@ -91,6 +347,8 @@ void OSDMapMapping::_finish(const OSDMap& osdmap)
 {
   _build_rmap(osdmap);
   epoch = osdmap.get_epoch();
+  in_flight = Changes();
+  complete = true;
 }
 
 void OSDMapMapping::_dump()
@@ -205,3 +463,23 @@ void ParallelPGMapper::queue(
   }
   ceph_assert(any);
 }
+
+void ParallelPGMapper::queue_pools(
+  Job *job,
+  unsigned pgs_per_item,
+  const set<int64_t>& pools)
+{
+  for (auto poolid : pools) {
+    auto pool = job->osdmap->get_pg_pool(poolid);
+    if (!pool) {
+      continue;
+    }
+    for (unsigned ps = 0; ps < pool->get_pg_num(); ps += pgs_per_item) {
+      unsigned ps_end = std::min(ps + pgs_per_item, pool->get_pg_num());
+      job->start_one();
+      wq.queue(new Item(job, poolid, ps, ps_end));
+      ldout(cct, 20) << __func__ << " " << job << " " << poolid << " [" << ps
+		     << "," << ps_end << ")" << dendl;
+    }
+  }
+}
@@ -7,14 +7,14 @@
 
 #include <vector>
 #include <map>
+#include <set>
 
 #include "osd/osd_types.h"
+#include "osd/OSDMap.h"
 #include "common/WorkQueue.h"
 #include "common/Clock.h" // for ceph_clock_now()
 #include "common/Cond.h"
 
-class OSDMap;
-
 /// work queue to perform work on batches of pgids on multiple CPUs
 class ParallelPGMapper {
 public:
@@ -165,6 +165,11 @@ public:
     Job *job,
     unsigned pgs_per_item,
     const std::vector<pg_t>& input_pgs);
+  /// queue every pg of @p pools
+  void queue_pools(
+    Job *job,
+    unsigned pgs_per_item,
+    const std::set<int64_t>& pools);
 
   void drain() {
     wq.drain();
@@ -258,7 +263,26 @@ private:
   epoch_t epoch = 0;
   uint64_t num_pgs = 0;
 
-  void _init_mappings(const OSDMap& osdmap);
+  /// what the incrementals since the last complete mapping touched
+  struct Changes {
+    epoch_t first = 0, last = 0;   ///< incrementals noted, if any
+    bool all = false;              ///< remap everything
+    std::set<int64_t> pools;
+    std::set<pg_t> pgs;
+    std::set<int> osds;            ///< state changes
+    std::set<int> weight_osds;     ///< reweights
+    std::set<int> affinity_osds;   ///< primary affinity changes
+
+    /// append the changes of the epochs following ours
+    void append(Changes&& next);
+  };
+  Changes pending;     ///< noted, not yet picked up by a job
+  Changes in_flight;   ///< picked up by the current (or an aborted) job
+  /// the tables match `epoch` except for what in_flight covers
+  bool complete = false;
+
+  void _init_mappings(const OSDMap& osdmap,
+		      std::set<int64_t> *recreated = nullptr);
   void _update_range(
     const OSDMap& map,
     int64_t pool,
@@ -266,9 +290,12 @@ private:
 
   void _build_rmap(const OSDMap& osdmap);
 
-  void _start(const OSDMap& osdmap) {
-    _init_mappings(osdmap);
-  }
+  bool _start(const OSDMap& osdmap,
+	      std::set<int64_t> *dirty_pools = nullptr,
+	      std::vector<pg_t> *dirty_pgs = nullptr);
+  void _get_dirty(const OSDMap& osdmap,
+		  std::set<int64_t> *dirty_pools,
+		  std::vector<pg_t> *dirty_pgs);
   void _finish(const OSDMap& osdmap);
 
   void _dump();
@@ -277,11 +304,18 @@ private:
 
   struct MappingJob : public ParallelPGMapper::Job {
     OSDMapMapping *mapping;
+    bool incremental;
+    std::set<int64_t> pools;  ///< to remap if incremental
+    std::vector<pg_t> pgs;    ///< to remap if incremental, outside of pools
     MappingJob(const OSDMap *osdmap, OSDMapMapping *m)
       : Job(osdmap), mapping(m) {
-      mapping->_start(*osdmap);
+      incremental = mapping->_start(*osdmap, &pools, &pgs);
+    }
+    void process(const std::vector<pg_t>& pgs) override {
+      for (auto pgid : pgs) {
+	mapping->update(*osdmap, pgid);
+      }
     }
-    void process(const std::vector<pg_t>& pgs) override {}
     void process(int64_t pool, unsigned ps_begin, unsigned ps_end) override {
       mapping->_update_range(*osdmap, pool, ps_begin, ps_end);
     }
@@ -334,14 +368,18 @@ public:
 
   void update(const OSDMap& map, pg_t pgid);
 
+  /**
+   * note an incremental applied to the map we are going to be updated to
+   *
+   * If every incremental since the last complete update is noted, the
+   * next update only recalculates the pools and pgs they can affect.
+   */
+  void note_incremental(const OSDMap::Incremental& inc);
+
   std::unique_ptr<MappingJob> start_update(
     const OSDMap& map,
     ParallelPGMapper& mapper,
-    unsigned pgs_per_item) {
-    std::unique_ptr<MappingJob> job(new MappingJob(&map, this));
-    mapper.queue(job.get(), pgs_per_item, {});
-    return job;
-  }
+    unsigned pgs_per_item);
 
   epoch_t get_epoch() const {
     return epoch;
@@ -0,0 +1,292 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:nil -*-
+// vim: ts=8 sw=2 sts=2 expandtab
+
+#include "ObjectContextCache.h"
+
+#include "common/debug.h"
+#include "common/Formatter.h"
+#include "osd/osd_internal_types.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_osd
+#undef dout_prefix
+#define dout_prefix *_dout << "obc_cache "
+
+// what an unreferenced context costs us: the context itself, its cached
+// attributes and our own bookkeeping (list node, index and key copies)
+static uint64_t estimate_bytes(const hobject_t& oid, const ObjectContext& obc)
+{
+  uint64_t bytes = sizeof(ObjectContext) +
+    3 * (sizeof(hobject_t) + oid.oid.name.size() + oid.nspace.size() +
+         oid.get_key().size()) +
+    sizeof(spg_t) + 128;
+  for (auto& [name, bl] : obc.attr_cache) {
+    bytes += name.size() + bl.length();
+  }
+  return bytes;
+}
+
+ObjectContextCache::ObjectContextCache(CephContext *cct,
+                                       unsigned num_shards,
+                                       uint64_t budget)
+  : cct(cct), budget(budget)
+{
+  for (unsigned i = 0; i < std::max(num_shards, 1u); ++i) {
+    shards.emplace_back(std::make_unique<Shard>());
+  }
+}
+
+ObjectContextCache::~ObjectContextCache()
+{
+  for (auto& s : shards) {
+    // PGs drop their contexts on shutdown
+    ceph_assert(s->index.empty());
+  }
+}
+
+void ObjectContextCache::_remove(Shard& s, entry_list_t::iterator p,
+                                 std::vector<ObjectContextRef> *to_release)
+{
+  auto i = s.index.find(p->pgid);
+  ceph_assert(i != s.index.end());
+  i->second.erase(p->oid);
+  if (i->second.empty()) {
+    s.index.erase(i);
+  }
+  to_release->push_back(std::move(p->obc));
+  if (p->hot) {
+    s.main_bytes -= p->bytes;
+    s.main.erase(p);
+  } else {
+    s.in_bytes -= p->bytes;
+    s.in.erase(p);
+  }
+}
+
+void ObjectContextCache::_add_ghost(Shard& s, const spg_t& pgid,
+                                    const hobject_t& oid)
+{
+  obc_key_t key(pgid, oid);
+  if (s.ghost_index.count(key)) {
+    return;
+  }
+  s.ghosts.push_front(key);
+  s.ghost_index.emplace(std::move(key), s.ghosts.begin());
+}
+
+void ObjectContextCache::_trim(Shard& s, uint64_t limit,
+                               std::vector<ObjectContextRef> *to_release)
+{
+  uint64_t in_limit = limit * IN_RATIO;
+  while (s.in_bytes + s.main_bytes > limit) {
+    if (!s.in.empty() && (s.in_bytes > in_limit || s.main.empty())) {
+      auto p = std::prev(s.in.end());
+      _add_ghost(s, p->pgid, p->oid);
+      _remove(s, p, to_release);
+    } else {
+      _remove(s, std::prev(s.main.end()), to_release);
+    }
+    ++s.evictions;
+  }
+  size_t max_ghosts = std::max(MIN_GHOSTS, (s.in.size() + s.main.size()) / 2);
+  while (s.ghosts.size() > max_ghosts) {
+    s.ghost_index.erase(s.ghosts.back());
+    s.ghosts.pop_back();
+  }
+}
+
+void ObjectContextCache::touch(const spg_t& pgid, const hobject_t& oid,
+                               const ObjectContextRef& obc)
+{
+  if (!obc) {
+    return;
+  }
+  // the caller holds the pg lock, which protects the attr cache
+  uint64_t bytes = estimate_bytes(oid, *obc);
+  std::vector<ObjectContextRef> to_release; // released after unlocking
+  Shard& s = get_shard(oid);
+  std::lock_guard l(s.lock);
+  auto& pg_index = s.index[pgid];
+  if (auto p = pg_index.find(oid); p != pg_index.end()) {
+    auto e = p->second;
+    ++s.hits;
+    if (e->obc != obc) {
+      to_release.push_back(std::move(e->obc));
+      e->obc = obc;
+    }
+    if (e->hot) {
+      s.main_bytes += bytes - e->bytes;
+      s.main.splice(s.main.begin(), s.main, e);
+    } else {
+      // a repeated use while still on the FIFO is not promoted: that is
+      // how a one-off access (e.g. read-modify-write) looks as well
+      s.in_bytes += bytes - e->bytes;
+    }
+    e->bytes = bytes;
+  } else {
+    bool hot = false;
+    if (auto g = s.ghost_index.find(obc_key_t(pgid, oid));
+        g != s.ghost_index.end()) {
+      ++s.ghost_hits;
+      s.ghosts.erase(g->second);
+      s.ghost_index.erase(g);
+      hot = true;
+    } else {
+      ++s.misses;
+    }
+    auto& entries = hot ? s.main : s.in;
+    entries.push_front(Entry{pgid, oid, obc, bytes, hot});
+    (hot ? s.main_bytes : s.in_bytes) += bytes;
+    pg_index.emplace(oid, entries.begin());
+  }
+  _trim(s, get_shard_budget(), &to_release);
+}
+
+void ObjectContextCache::clear_range(const spg_t& pgid,
+                                     const hobject_t& from,
+                                     const hobject_t& to)
+{
+  std::vector<ObjectContextRef> to_release;
+  for (auto& sp : shards) {
+    Shard& s = *sp;
+    std::lock_guard l(s.lock);
+    auto i = s.index.find(pgid);
+    if (i == s.index.end()) {
+      continue;
+    }
+    auto& pg_index = i->second;
+    auto p = pg_index.lower_bound(from);
+    while (p != pg_index.end() && p->first <= to) {
+      auto e = (p++)->second;
+      _remove(s, e, &to_release);
+      if (!s.index.count(pgid)) {
+        break; // pg_index went away with its last entry
+      }
+    }
+  }
+}
+
+void ObjectContextCache::clear_pg(const spg_t& pgid)
+{
+  std::vector<ObjectContextRef> to_release;
+  for (auto& sp : shards) {
+    Shard& s = *sp;
+    std::lock_guard l(s.lock);
+    auto i = s.index.find(pgid);
+    if (i == s.index.end()) {
+      continue;
+    }
+    std::vector<entry_list_t::iterator> entries;
+    entries.reserve(i->second.size());
+    for (auto& [oid, e] : i->second) {
+      entries.push_back(e);
+    }
+    for (auto e : entries) {
+      _remove(s, e, &to_release);
+    }
+  }
+  dout(20) << __func__ << " " << pgid << " dropped " << to_release.size()
+           << dendl;
+}
+
+uint64_t ObjectContextCache::get_pg_count(const spg_t& pgid) const
+{
+  uint64_t count = 0;
+  for (auto& s : shards) {
+    std::lock_guard l(s->lock);
+    if (auto i = s->index.find(pgid); i != s->index.end()) {
+      count += i->second.size();
+    }
+  }
+  return count;
+}
+
+uint64_t ObjectContextCache::get_used_bytes(bool hot_only) const
+{
+  uint64_t bytes = 0;
+  for (auto& s : shards) {
+    std::lock_guard l(s->lock);
+    bytes += s->main_bytes + (hot_only ? 0 : s->in_bytes);
+  }
+  return bytes;
+}
+
+void ObjectContextCache::set_budget(uint64_t bytes)
+{
+  budget = bytes;
+  uint64_t limit = get_shard_budget();
+  for (auto& s : shards) {
+    std::vector<ObjectContextRef> to_release;
+    std::lock_guard l(s->lock);
+    _trim(*s, limit, &to_release);
+  }
+}
+
+void ObjectContextCache::dump(ceph::Formatter *f) const
+{
+  uint64_t in = 0, main = 0, in_bytes = 0, main_bytes = 0, ghosts = 0;
+  uint64_t hits = 0, misses = 0, ghost_hits = 0, evictions = 0;
+  for (auto& s : shards) {
+    std::lock_guard l(s->lock);
+    in += s->in.size();
+    main += s->main.size();
+    in_bytes += s->in_bytes;
+    main_bytes += s->main_bytes;
+    ghosts += s->ghosts.size();
+    hits += s->hits;
+    misses += s->misses;
+    ghost_hits += s->ghost_hits;
+    evictions += s->evictions;
+  }
+  f->dump_unsigned("shards", shards.size());
+  f->dump_unsigned("budget", budget);
+  f->dump_unsigned("in_items", in);
+  f->dump_unsigned("in_bytes", in_bytes);
+  f->dump_unsigned("main_items", main);
+  f->dump_unsigned("main_bytes", main_bytes);
+  f->dump_unsigned("ghosts", ghosts);
+  f->dump_unsigned("hits", hits);
+  f->dump_unsigned("misses", misses);
+  f->dump_unsigned("ghost_hits", ghost_hits);
+  f->dump_unsigned("evictions", evictions);
+}
+
+int64_t ObjectContextCache::request_cache_bytes(
+  PriorityCache::Priority pri, uint64_t total_cache) const
+{
+  int64_t assigned = get_cache_bytes(pri);
+  switch (pri) {
+  // contexts that proved to be reused are worth keeping
+  case PriorityCache::Priority::PRI1:
+    {
+      int64_t request = get_used_bytes(true);
+      return (request > assigned) ? request - assigned : 0;
+    }
+  // the FIFO of contexts used once gets what is left
+  case PriorityCache::Priority::LAST:
+    {
+      int64_t request = get_used_bytes(false) -
+        get_cache_bytes(PriorityCache::Priority::PRI1);
+      return (request > assigned) ? request - assigned : 0;
+    }
+  default:
+    break;
+  }
+  return -EOPNOTSUPP;
+}
+
+int64_t ObjectContextCache::get_cache_bytes() const
+{
+  int64_t total = 0;
+  for (int i = 0; i < PriorityCache::Priority::LAST + 1; i++) {
+    total += get_cache_bytes(static_cast<PriorityCache::Priority>(i));
+  }
+  return total;
+}
+
+int64_t ObjectContextCache::commit_cache_size(uint64_t total_cache)
+{
+  committed_bytes = PriorityCache::get_chunk(get_cache_bytes(), total_cache);
+  set_budget(committed_bytes);
+  return committed_bytes;
+}
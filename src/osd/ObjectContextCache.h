@@ -0,0 +1,160 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:nil -*-
+// vim: ts=8 sw=2 sts=2 expandtab
+
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OSD_OBJECTCONTEXTCACHE_H
+#define CEPH_OSD_OBJECTCONTEXTCACHE_H
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "common/ceph_mutex.h"
+#include "common/hobject.h"
+#include "common/PriorityCache.h"
+#include "osd/osd_types.h"
+
+struct ObjectContext;
+typedef std::shared_ptr<ObjectContext> ObjectContextRef;
+
+/**
+ * OSD-wide cache of object contexts
+ *
+ * Each PrimaryLogPG keeps a SharedLRU of its object contexts, which
+ * guarantees a single ObjectContext per object as long as it is
+ * referenced. This cache decides which contexts stay alive once nobody
+ * references them anymore, across all PGs of the OSD and within a single
+ * memory budget, so busy PGs get more of it than idle ones.
+ *
+ * Eviction follows 2Q: a context is put on the "in" FIFO when first
+ * used and moves to the "main" LRU only if it is used again after it
+ * has been pushed out of the FIFO, which is remembered by a bounded
+ * list of "ghost" keys. A deep scrub or backfill pass touching every
+ * object once thus only cycles the FIFO and leaves hot contexts, e.g.
+ * bucket index objects, alone.
+ *
+ * When the object store runs a PriorityCache::Manager the budget is
+ * assigned by it, otherwise it is set by the OSD from
+ * osd_object_context_cache_size.
+ */
+class ObjectContextCache : public PriorityCache::PriCache {
+public:
+  ObjectContextCache(CephContext *cct, unsigned num_shards, uint64_t budget);
+  ~ObjectContextCache() override;
+
+  /// note a use of @p obc, the context of @p oid in @p pgid
+  void touch(const spg_t& pgid, const hobject_t& oid,
+             const ObjectContextRef& obc);
+  /// drop the contexts of @p pgid for objects in [from, to]
+  void clear_range(const spg_t& pgid, const hobject_t& from,
+                   const hobject_t& to);
+  /// drop all contexts of @p pgid
+  void clear_pg(const spg_t& pgid);
+  uint64_t get_pg_count(const spg_t& pgid) const;
+
+  void set_budget(uint64_t bytes);
+  uint64_t get_budget() const {
+    return budget;
+  }
+  void dump(ceph::Formatter *f) const;
+
+  // PriorityCache::PriCache
+  int64_t request_cache_bytes(PriorityCache::Priority pri,
+                              uint64_t total_cache) const override;
+  int64_t get_cache_bytes(PriorityCache::Priority pri) const override {
+    return cache_bytes[pri];
+  }
+  int64_t get_cache_bytes() const override;
+  void set_cache_bytes(PriorityCache::Priority pri, int64_t bytes) override {
+    cache_bytes[pri] = bytes;
+  }
+  void add_cache_bytes(PriorityCache::Priority pri, int64_t bytes) override {
+    cache_bytes[pri] += bytes;
+  }
+  int64_t commit_cache_size(uint64_t total_cache) override;
+  int64_t get_committed_size() const override {
+    return committed_bytes;
+  }
+  double get_cache_ratio() const override {
+    return cache_ratio;
+  }
+  void set_cache_ratio(double ratio) override {
+    cache_ratio = ratio;
+  }
+  std::string get_cache_name() const override {
+    return "OSD Object Context Cache";
+  }
+  void shift_bins() override {}
+  void import_bins(const std::vector<uint64_t> &bins) override {}
+  void set_bins(PriorityCache::Priority pri, uint64_t end_bin) override {}
+  uint64_t get_bins(PriorityCache::Priority pri) const override {
+    return 0;
+  }
+
+private:
+  /// share of a shard's budget the "in" FIFO may keep for itself
+  static constexpr double IN_RATIO = 0.25;
+  /// minimum number of ghost keys kept per shard
+  static constexpr size_t MIN_GHOSTS = 64;
+
+  struct Entry {
+    spg_t pgid;
+    hobject_t oid;
+    ObjectContextRef obc;
+    uint64_t bytes = 0;
+    bool hot = false;   ///< on the main LRU rather than the "in" FIFO
+  };
+  using entry_list_t = std::list<Entry>;
+  using obc_key_t = std::pair<spg_t, hobject_t>;
+
+  struct Shard {
+    mutable ceph::mutex lock =
+      ceph::make_mutex("ObjectContextCache::Shard::lock");
+    entry_list_t in;     ///< used once, FIFO
+    entry_list_t main;   ///< used again after leaving `in`, LRU
+    uint64_t in_bytes = 0;
+    uint64_t main_bytes = 0;
+    std::map<spg_t, std::map<hobject_t, entry_list_t::iterator>> index;
+    std::list<obc_key_t> ghosts;    ///< keys recently pushed out of `in`
+    std::map<obc_key_t, std::list<obc_key_t>::iterator> ghost_index;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t ghost_hits = 0;
+    uint64_t evictions = 0;
+  };
+
+  CephContext *cct;
+  std::vector<std::unique_ptr<Shard>> shards;
+  std::atomic<uint64_t> budget;
+
+  int64_t cache_bytes[PriorityCache::Priority::LAST+1] = {0};
+  int64_t committed_bytes = 0;
+  double cache_ratio = 0;
+
+  Shard& get_shard(const hobject_t& oid) {
+    return *shards[std::hash<hobject_t>{}(oid) % shards.size()];
+  }
+  uint64_t get_shard_budget() const {
+    return budget / shards.size();
+  }
+  uint64_t get_used_bytes(bool hot_only) const;
+
+  void _remove(Shard& s, entry_list_t::iterator p,
+               std::vector<ObjectContextRef> *to_release);
+  void _add_ghost(Shard& s, const spg_t& pgid, const hobject_t& oid);
+  void _trim(Shard& s, uint64_t limit,
+             std::vector<ObjectContextRef> *to_release);
+};
+
+#endif
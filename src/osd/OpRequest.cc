@@ -67,23 +67,22 @@ void OpRequest::_dump(Formatter *f) const
 
   {
     f->open_array_section("events");
-    std::lock_guard l(lock);
-
-    for (auto i = events.begin(); i != events.end(); ++i) {
+    utime_t prev;
+    for_each_event([&](const utime_t& stamp, std::string_view event) {
       f->open_object_section("event");
-      f->dump_string("event", i->str);
-      f->dump_stream("time") << i->stamp;
+      f->dump_string("event", event);
+      f->dump_stream("time") << stamp;
 
       double duration = 0;
 
-      if (i != events.begin()) {
-        auto i_prev = i - 1;
-        duration = i->stamp - i_prev->stamp;
+      if (prev != utime_t()) {
+        duration = stamp - prev;
       }
+      prev = stamp;
 
       f->dump_float("duration", duration);
       f->close_section();
-    }
+    });
     f->close_section();
   }
 }
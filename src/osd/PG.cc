@@ -2291,6 +2291,10 @@ std::pair<ghobject_t, bool> PG::do_delete_work(
 
   delete_needs_sleep = true;
 
+  // with bulk deletion objects are only visited, paced like regular
+  // deletion, to clean up their snap mappings; the store then releases
+  // them along with the collection and range-deletes the pg's keys
+  bool bulk = cct->_conf.get_val<bool>("osd_delete_bulk");
   ghobject_t next;
 
   vector<ghobject_t> olist;
@@ -2308,7 +2312,7 @@ std::pair<ghobject_t, bool> PG::do_delete_work(
 
   // make sure we've removed everything
   // by one more listing from the beginning
-  if (_next != ghobject_t() && olist.empty()) {
+  if (!bulk && _next != ghobject_t() && olist.empty()) {
     next = ghobject_t();
     osd->store->collection_list(
       ch,
@@ -2342,12 +2346,15 @@ std::pair<ghobject_t, bool> PG::do_delete_work(
     if (r != 0 && r != -ENOENT) {
       ceph_abort();
     }
-    t.remove(coll, oid);
+    if (!bulk) {
+      t.remove(coll, oid);
+    }
     ++num;
   }
   bool running = true;
   if (num) {
-    dout(20) << __func__ << " deleting " << num << " objects" << dendl;
+    dout(20) << __func__ << " deleting " << num << " objects"
+	     << (bulk ? " with the collection" : "") << dendl;
     Context *fin = new C_DeleteMore(this, get_osdmap_epoch(), num);
     t.register_on_commit(fin);
   } else {
@@ -2360,7 +2367,11 @@ std::pair<ghobject_t, bool> PG::do_delete_work(
     {
       PGRef pgref(this);
       PGLog::clear_info_log(info.pgid, &t);
-      t.remove_collection(coll);
+      if (bulk) {
+	t.destroy_collection(coll);
+      } else {
+	t.remove_collection(coll);
+      }
       t.register_on_commit(new ContainerContext<PGRef>(pgref));
       t.register_on_applied(new ContainerContext<PGRef>(pgref));
       osd->store->queue_transaction(ch, std::move(t));
@@ -228,6 +228,16 @@ public:
   void unlock() const;
   bool is_locked() const;
 
+  /// queue work to run once the op being processed has dropped the pg lock
+  void queue_unlocked_work(Context *c) {
+    ceph_assert(is_locked());
+    unlocked_work.push_back(c);
+  }
+  std::vector<Context*> take_unlocked_work() {
+    ceph_assert(is_locked());
+    return std::move(unlocked_work);
+  }
+
   const spg_t& get_pgid() const {
     return pg_id;
   }
@@ -804,6 +814,7 @@ protected:
   mutable std::thread::id locked_by;
 #endif
   std::atomic<unsigned int> ref{0};
+  std::vector<Context*> unlocked_work;  ///< see queue_unlocked_work()
 
 #ifdef PG_DEBUG_REFS
   ceph::mutex _ref_id_lock = ceph::make_mutex("PG::_ref_id_lock");
@@ -57,7 +57,7 @@ void PGLog::IndexedLog::trim(
   CephContext* cct,
   eversion_t s,
   set<eversion_t> *trimmed,
-  set<string>* trimmed_dups,
+  eversion_t *trimmed_dups_to,
   eversion_t *write_from_dups)
 {
   lgeneric_subdout(cct, osd, 10) << "IndexedLog::trim s=" << s << dendl;
@@ -139,16 +139,23 @@ void PGLog::IndexedLog::trim(
   // large amount of tombstones in BlueStore's RocksDB.
   // if trimming immediately is a must, then the ceph-objectstore-tool is
   // the way to go.
+  // dups are trimmed from the front, so the trimmed ones are always the
+  // oldest: the caller can drop them from disk with a single range delete
+  // instead of a key each.
   const size_t max_dups = cct->_conf->osd_pg_log_dups_tracked;
-  for (size_t max_dups_to_trim = cct->_conf->osd_pg_log_trim_max;
-       max_dups_to_trim > 0 && dups.size() > max_dups;
-       max_dups_to_trim--) {
-    const auto& e = *dups.begin();
-    lgeneric_subdout(cct, osd, 20) << "trim dup " << e << dendl;
-    if (trimmed_dups)
-      trimmed_dups->insert(e.get_key_name());
-    unindex(e);
-    dups.pop_front();
+  if (dups.size() > max_dups) {
+    size_t to_trim = std::min<size_t>(dups.size() - max_dups,
+				      cct->_conf->osd_pg_log_trim_max);
+    auto end = dups.begin();
+    for (size_t i = 0; i < to_trim; ++i, ++end) {
+      lgeneric_subdout(cct, osd, 20) << "trim dup " << *end << dendl;
+      unindex(*end);
+    }
+    if (to_trim > 0 && trimmed_dups_to &&
+	std::prev(end)->version > *trimmed_dups_to) {
+      *trimmed_dups_to = std::prev(end)->version;
+    }
+    dups.erase(dups.begin(), end);
   }
 
   // raise tail?
@@ -214,7 +221,7 @@ void PGLog::trim(
       ceph_assert(trim_to <= info.last_complete);
 
     dout(10) << "trim " << log << " to " << trim_to << dendl;
-    log.trim(cct, trim_to, &trimmed, &trimmed_dups, &write_from_dups);
+    log.trim(cct, trim_to, &trimmed, &trimmed_dups_to, &write_from_dups);
     info.log_tail = log.tail;
     if (log.complete_to != log.log.end())
       dout(10) << " after trim complete_to " << log.complete_to->version << dendl;
@@ -674,7 +681,7 @@ void PGLog::write_log_and_missing(
 	     << ", dirty_from: " << dirty_from
 	     << ", writeout_from: " << writeout_from
 	     << ", trimmed: " << trimmed
-	     << ", trimmed_dups: " << trimmed_dups
+	     << ", trimmed_dups_to: " << trimmed_dups_to
 	     << ", clear_divergent_priors: " << clear_divergent_priors
 	     << dendl;
     _write_log_and_missing(
@@ -683,7 +690,7 @@ void PGLog::write_log_and_missing(
       dirty_from,
       writeout_from,
       std::move(trimmed),
-      std::move(trimmed_dups),
+      trimmed_dups_to,
       missing,
       !touched_log,
       require_rollback,
@@ -736,7 +743,7 @@ void PGLog::write_log_and_missing(
     eversion_t(),
     eversion_t(),
     set<eversion_t>(),
-    set<string>(),
+    eversion_t(),
     missing,
     true, require_rollback, false,
     eversion_t::max(),
@@ -886,7 +893,7 @@ void PGLog::_write_log_and_missing(
   eversion_t dirty_from,
   eversion_t writeout_from,
   set<eversion_t> &&trimmed,
-  set<string> &&trimmed_dups,
+  eversion_t trimmed_dups_to,
   const pg_missing_tracker_t &missing,
   bool touch_log,
   bool require_rollback,
@@ -902,9 +909,8 @@ void PGLog::_write_log_and_missing(
 		     << " dirty_to_dups=" << dirty_to_dups
 		     << " dirty_from_dups=" << dirty_from_dups
 		     << " write_from_dups=" << write_from_dups
-		     << " trimmed_dups.size()=" << trimmed_dups.size() << dendl;
+		     << " trimmed_dups_to=" << trimmed_dups_to << dendl;
   set<string> to_remove;
-  to_remove.swap(trimmed_dups);
   for (auto& t : trimmed) {
     string key = t.get_key_name();
     if (log_keys_debug) {
@@ -964,6 +970,17 @@ void PGLog::_write_log_and_missing(
 
   // process dups after log_keys_debug is filled, so dups do not
   // end up in that set
+  if (trimmed_dups_to != eversion_t()) {
+    pg_log_dup_t min, trimmed_end;
+    trimmed_end.version = eversion_t(trimmed_dups_to.epoch,
+				     trimmed_dups_to.version + 1);
+    ldpp_dout(dpp, 10) << __func__ << " remove trimmed dups min="
+		       << min.get_key_name()
+		       << " to " << trimmed_end.get_key_name() << dendl;
+    t.omap_rmkeyrange(
+      coll, log_oid,
+      min.get_key_name(), trimmed_end.get_key_name());
+  }
   if (dirty_to_dups != eversion_t()) {
     pg_log_dup_t min, dirty_to_dup;
     dirty_to_dup.version = dirty_to_dups;
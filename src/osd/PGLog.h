@@ -709,7 +709,7 @@ public:
       CephContext* cct,
       eversion_t s,
       std::set<eversion_t> *trimmed,
-      std::set<std::string>* trimmed_dups,
+      eversion_t *trimmed_dups_to,
       eversion_t *write_from_dups);
 
     std::ostream& print(std::ostream& out) const;
@@ -729,7 +729,7 @@ protected:
   eversion_t dirty_to_dups;    ///< must clear/writeout all dups <= dirty_to_dups
   eversion_t dirty_from_dups;  ///< must clear/writeout all dups >= dirty_from_dups
   eversion_t write_from_dups;  ///< must write keys >= write_from_dups
-  std::set<std::string> trimmed_dups;    ///< must clear keys in trimmed_dups
+  eversion_t trimmed_dups_to;  ///< must clear all dups <= trimmed_dups_to
   CephContext *cct;
   bool pg_log_debug;
   /// Log is clean on [dirty_to, dirty_from)
@@ -770,7 +770,7 @@ public:
       (writeout_from != eversion_t::max()) ||
       !(trimmed.empty()) ||
       !missing.is_clean() ||
-      !(trimmed_dups.empty()) ||
+      (trimmed_dups_to != eversion_t()) ||
       (dirty_to_dups != eversion_t()) ||
       (dirty_from_dups != eversion_t::max()) ||
       (write_from_dups != eversion_t::max()) ||
@@ -813,7 +813,7 @@ protected:
     touched_log = true;
     dirty_log = false;
     trimmed.clear();
-    trimmed_dups.clear();
+    trimmed_dups_to = eversion_t();
     writeout_from = eversion_t::max();
     check();
     missing.flush();
@@ -1549,7 +1549,7 @@ public:
     eversion_t dirty_from,
     eversion_t writeout_from,
     std::set<eversion_t> &&trimmed,
-    std::set<std::string> &&trimmed_dups,
+    eversion_t trimmed_dups_to,
     const pg_missing_tracker_t &missing,
     bool touch_log,
     bool require_rollback,
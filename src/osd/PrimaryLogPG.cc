@@ -560,6 +560,10 @@ void PrimaryLogPG::clear_repop_obc(
     /* Have to blast all clones, they share a snapset */
     object_contexts.clear_range(
       e.soid.get_object_boundary(), e.soid.get_head());
+    if (osd->obc_cache) {
+      osd->obc_cache->clear_range(
+	info.pgid, e.soid.get_object_boundary(), e.soid.get_head());
+    }
     ceph_assert(
       snapset_contexts.find(e.soid.get_head()) ==
       snapset_contexts.end());
@@ -1777,7 +1781,8 @@ PrimaryLogPG::PrimaryLogPG(OSDService *o, OSDMapRef curmap,
   pgbackend(
     PGBackend::build_pg_backend(
       _pool.info, ec_profile, this, coll_t(p), ch, o->store, cct, ec_extent_cache_lru)),
-  object_contexts(o->cct, o->cct->_conf->osd_pg_object_context_cache_count),
+  object_contexts(o->cct, o->obc_cache ? 0 :
+		  o->cct->_conf->osd_pg_object_context_cache_count),
   new_backfill(false),
   temp_seq(0),
   snap_trimmer_machine(this)
@@ -2565,6 +2570,9 @@ void PrimaryLogPG::do_op_impl(OpRequestRef op)
 
   op->mark_started();
 
+  if (start_unlocked_read(ctx)) {
+    return;
+  }
   execute_ctx(ctx);
   utime_t prepare_latency = ceph_clock_now();
   prepare_latency -= op->get_dequeued_time();
@@ -6017,9 +6025,19 @@ int PrimaryLogPG::do_read(OpContext *ctx, OSDOp& osd_op) {
       bytes_read = op.extent.length;
     }
   } else {
-    int r = pgbackend->objects_read_sync(
-      soid, op.extent.offset, op.extent.length, op.flags, &osd_op.outdata,
-      oi.size, ctx->op->coro_handles);
+    int r;
+    if (auto p = ctx->unlocked_reads.find(&osd_op);
+        p != ctx->unlocked_reads.end() &&
+        p->second.off == op.extent.offset &&
+        p->second.len == op.extent.length) {
+      r = p->second.bl.length();
+      osd_op.outdata.claim_append(p->second.bl);
+      ctx->unlocked_reads.erase(p);
+    } else {
+      r = pgbackend->objects_read_sync(
+        soid, op.extent.offset, op.extent.length, op.flags, &osd_op.outdata,
+        oi.size, ctx->op->coro_handles);
+    }
     // whole object?  can we verify the checksum?
     if (r >= 0 && op.extent.offset == 0 &&
         (uint64_t)r == oi.size && oi.is_data_digest()) {
@@ -7994,9 +8012,14 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
       }
       ++ctx->num_read;
       {
-	get_pgbackend()->omap_get_header(ch,
-	  ghobject_t(soid, ghobject_t::NO_GEN, whoami_shard().shard),
-	  &osd_op.outdata, false);
+	if (auto p = ctx->unlocked_reads.find(&osd_op);
+	    p != ctx->unlocked_reads.end()) {
+	  osd_op.outdata.claim_append(p->second.bl);
+	} else {
+	  get_pgbackend()->omap_get_header(ch,
+	    ghobject_t(soid, ghobject_t::NO_GEN, whoami_shard().shard),
+	    &osd_op.outdata, false);
+	}
 	ctx->delta_stats.num_rd_kb += shift_round_up(osd_op.outdata.length(), 10);
 	ctx->delta_stats.num_rd++;
       }
@@ -8015,12 +8038,17 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	  goto fail;
 	}
 	tracepoint(osd, do_osd_op_pre_omapgetvalsbykeys, soid.oid.name.c_str(), soid.snap.val, list_entries(keys_to_get).c_str());
-	map<string, bufferlist> out;
-	if (oi.is_omap()) {
-	  get_pgbackend()->omap_get_values(ch,
-	    ghobject_t(soid, ghobject_t::NO_GEN, whoami_shard().shard), keys_to_get, &out);
-	} // else return empty omap entries
-	encode(out, osd_op.outdata);
+	if (auto p = ctx->unlocked_reads.find(&osd_op);
+	    p != ctx->unlocked_reads.end()) {
+	  osd_op.outdata.claim_append(p->second.bl);
+	} else {
+	  map<string, bufferlist> out;
+	  if (oi.is_omap()) {
+	    get_pgbackend()->omap_get_values(ch,
+	      ghobject_t(soid, ghobject_t::NO_GEN, whoami_shard().shard), keys_to_get, &out);
+	  } // else return empty omap entries
+	  encode(out, osd_op.outdata);
+	}
 	ctx->delta_stats.num_rd_kb += shift_round_up(osd_op.outdata.length(), 10);
 	ctx->delta_stats.num_rd++;
       }
@@ -8876,6 +8904,7 @@ void PrimaryLogPG::make_writeable(OpContext *ctx)
       if (pool.info.is_erasure())
 	ctx->clone_obc->attr_cache = ctx->obc->attr_cache;
       snap_oi = &ctx->clone_obc->obs.oi;
+      touch_object_context(ctx->clone_obc);
       if (ctx->obc->obs.oi.has_manifest()) {
 	if ((ctx->obc->obs.oi.flags & object_info_t::FLAG_REDIRECT_HAS_REFERENCE) &&
 	    ctx->obc->obs.oi.manifest.is_redirect()) {
@@ -9386,6 +9415,184 @@ void PrimaryLogPG::complete_read_ctx(int result, OpContext *ctx)
   close_op_ctx(ctx);
 }
 
+// ========================================================================
+// unlocked reads
+//
+// A plain read of a head object in a replicated pool does its object
+// store I/O after the op has dropped the pg lock.  The op keeps the
+// object's read lock meanwhile, so no write to the object can be applied
+// until it is done.  Once the data is in, the pg lock is taken again and
+// the op runs through execute_ctx() as usual, picking up the buffers
+// read in advance.  As with EC async reads, ops are executed in the order
+// they were started, whichever op worker finishes its reads first.  A
+// change of interval closes the op and requeues it; a change of the object
+// version (which the read lock should rule out) makes it read again under
+// the lock.
+
+struct PrimaryLogPG::C_UnlockedRead : public Context {
+  struct Read {
+    const OSDOp *osd_op;
+    int op;
+    uint64_t off = 0;
+    uint64_t len = 0;
+    uint32_t flags = 0;
+    std::set<std::string> keys;
+    int r = 0;
+    bufferlist bl;
+  };
+
+  PrimaryLogPGRef pg;
+  OpRequestRef op;
+  OpContext *ctx;  ///< only to be used with the pg lock held
+  epoch_t last_peering_reset;
+  ObjectStore *store;
+  ObjectStore::CollectionHandle ch;
+  ghobject_t oid;
+  std::vector<Read> reads;
+
+  C_UnlockedRead(PrimaryLogPG *pg, OpContext *ctx, ObjectStore *store,
+                 ObjectStore::CollectionHandle ch)
+    : pg(pg), op(ctx->op), ctx(ctx),
+      last_peering_reset(pg->get_last_peering_reset()),
+      store(store), ch(ch), oid(ctx->obs->oi.soid) {}
+
+  void finish(int) override {
+    for (auto& read : reads) {
+      switch (read.op) {
+      case CEPH_OSD_OP_READ:
+        read.r = store->read(ch, oid, read.off, read.len, read.bl, read.flags);
+        break;
+      case CEPH_OSD_OP_OMAPGETHEADER:
+        read.r = store->omap_get_header(ch, oid, &read.bl, false);
+        break;
+      case CEPH_OSD_OP_OMAPGETVALSBYKEYS:
+        {
+          map<string, bufferlist> out;
+          read.r = store->omap_get_values(ch, oid, read.keys, &out);
+          encode(out, read.bl);
+        }
+        break;
+      default:
+        ceph_abort_msg("unexpected unlocked read");
+      }
+    }
+    std::scoped_lock l{*pg};
+    pg->finish_unlocked_read(this);
+  }
+};
+
+bool PrimaryLogPG::start_unlocked_read(OpContext *ctx)
+{
+  if (!cct->_conf->osd_read_without_pg_lock ||
+      !pool.info.is_replicated() ||
+      pool.info.is_tier() ||
+      pool.info.has_tiers() ||
+      coro_op_in_flight ||
+      ctx->lock_type != RWState::RWREAD ||
+      ctx->op->may_write() ||
+      ctx->op->may_cache() ||
+      !ctx->obs->oi.soid.is_head()) {
+    return false;
+  }
+  const auto& oi = ctx->obs->oi;
+  auto c = std::make_unique<C_UnlockedRead>(this, ctx, osd->store, ch);
+  for (const auto& osd_op : *ctx->ops) {
+    const auto& op = osd_op.op;
+    switch (op.op) {
+    case CEPH_OSD_OP_READ:
+      {
+        // leave truncation to do_read()
+        if (oi.truncate_seq < op.extent.truncate_seq) {
+          return false;
+        }
+        uint64_t len = op.extent.length ? op.extent.length : oi.size;
+        if (op.extent.offset >= oi.size) {
+          break;
+        }
+        len = std::min(len, oi.size - op.extent.offset);
+        c->reads.push_back({&osd_op, op.op, op.extent.offset, len, op.flags});
+      }
+      break;
+    case CEPH_OSD_OP_OMAPGETHEADER:
+      if (oi.is_omap()) {
+        c->reads.push_back({&osd_op, op.op});
+      }
+      break;
+    case CEPH_OSD_OP_OMAPGETVALSBYKEYS:
+      if (oi.is_omap()) {
+        std::set<std::string> keys;
+        try {
+          auto bp = osd_op.indata.cbegin();
+          decode(keys, bp);
+        } catch (ceph::buffer::error& e) {
+          return false;
+        }
+        c->reads.push_back({&osd_op, op.op});
+        c->reads.back().keys = std::move(keys);
+      }
+      break;
+    // served from the object context
+    case CEPH_OSD_OP_STAT:
+    case CEPH_OSD_OP_GETXATTR:
+    case CEPH_OSD_OP_GETXATTRS:
+    // not worth splitting into an unlocked part
+    case CEPH_OSD_OP_OMAPGETKEYS:
+    case CEPH_OSD_OP_OMAPGETVALS:
+      break;
+    default:
+      return false;
+    }
+  }
+  if (c->reads.empty()) {
+    return false;
+  }
+  dout(20) << __func__ << " " << oi.soid << " " << *ctx->ops << dendl;
+  in_progress_unlocked_reads.push_back({ctx->op, ctx, oi.version});
+  queue_unlocked_work(c.release());
+  return true;
+}
+
+void PrimaryLogPG::finish_unlocked_read(C_UnlockedRead *c)
+{
+  auto p = std::find_if(in_progress_unlocked_reads.begin(),
+                        in_progress_unlocked_reads.end(),
+                        [c](const UnlockedReadInFlight& r) {
+                          return r.op == c->op && r.ctx == c->ctx;
+                        });
+  if (p == in_progress_unlocked_reads.end() ||
+      c->last_peering_reset != get_last_peering_reset()) {
+    // the op was requeued on interval change
+    dout(20) << __func__ << " " << c->oid << " stale" << dendl;
+    return;
+  }
+  for (auto& read : c->reads) {
+    // errors are left to the locked path, which knows how to deal with them
+    if (read.r >= 0) {
+      p->ctx->unlocked_reads[read.osd_op] =
+        OpContext::UnlockedRead{read.off, read.len, std::move(read.bl)};
+    }
+  }
+  p->done = true;
+
+  // reply in the order the ops were started
+  while (!in_progress_unlocked_reads.empty() &&
+         in_progress_unlocked_reads.front().done) {
+    auto r = std::move(in_progress_unlocked_reads.front());
+    in_progress_unlocked_reads.pop_front();
+    OpContext *ctx = r.ctx;
+    if (ctx->obs->oi.version == r.version) {
+      osd->logger->inc(l_osd_op_r_unlocked);
+    } else {
+      dout(10) << __func__ << " " << ctx->obs->oi.soid << " changed from "
+               << r.version << " to " << ctx->obs->oi.version
+               << ", reading again" << dendl;
+      ctx->unlocked_reads.clear();
+      osd->logger->inc(l_osd_op_r_unlocked_retry);
+    }
+    execute_ctx(ctx);
+  }
+}
+
 // ========================================================================
 // copyfrom
 
@@ -12133,6 +12340,7 @@ ObjectContextRef PrimaryLogPG::create_object_context(const object_info_t& oi,
   dout(10) << "create_object_context " << (void*)obc.get() << " " << oi.soid << " " << dendl;
   if (is_active())
     populate_obc_watchers(obc);
+  touch_object_context(obc);
   return obc;
 }
 
@@ -12236,6 +12444,7 @@ ObjectContextRef PrimaryLogPG::get_object_context(
 	   << " oi: " << obc->obs.oi
 	   << " exists: " << (int)obc->obs.exists
 	   << " " << *obc->ssc << dendl;
+  touch_object_context(obc);
   return obc;
 }
 
@@ -13209,11 +13418,15 @@ void PrimaryLogPG::clear_async_reads()
              << dendl;
     close_op_ctx(i.second);
   }
+  for (auto& i : in_progress_unlocked_reads) {
+    close_op_ctx(i.ctx);
+  }
+  in_progress_unlocked_reads.clear();
 }
 
 void PrimaryLogPG::clear_cache()
 {
-  object_contexts.clear();
+  clear_object_contexts();
 }
 
 void PrimaryLogPG::on_shutdown()
@@ -13245,7 +13458,7 @@ void PrimaryLogPG::on_shutdown()
   pgbackend->on_change();
 
   context_registry_on_change();
-  object_contexts.clear();
+  clear_object_contexts();
 
   clear_async_reads();
 
@@ -13430,6 +13643,12 @@ void PrimaryLogPG::on_change(ObjectStore::Transaction &t)
     if (is_primary())
       requeue_op(i->first);
   }
+  for (auto& i : in_progress_unlocked_reads) {
+    close_op_ctx(i.ctx);
+    if (is_primary())
+      requeue_op(i.op);
+  }
+  in_progress_unlocked_reads.clear();
 
   // this will requeue ops we were working on but didn't finish, and
   // any dups
@@ -13453,7 +13672,7 @@ void PrimaryLogPG::on_change(ObjectStore::Transaction &t)
   // we don't want to cache object_contexts through the interval change
   // NOTE: we actually assert that all currently live references are dead
   // by the time the flush for the next interval completes.
-  object_contexts.clear();
+  clear_object_contexts();
 
   // should have been cleared above by finishing all of the degraded objects
   ceph_assert(objects_blocked_on_degraded_snap.empty());
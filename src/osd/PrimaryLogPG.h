@@ -786,6 +786,14 @@ public:
       return inflightreads == 0;
     }
 
+    /// object store reads done without the pg lock, see start_unlocked_read()
+    struct UnlockedRead {
+      uint64_t off = 0;
+      uint64_t len = 0;
+      ceph::buffer::list bl;
+    };
+    std::map<const OSDOp*, UnlockedRead> unlocked_reads;
+
     RWState::State lock_type;
     ObcLockManager lock_manager;
 
@@ -1064,8 +1072,20 @@ protected:
   /// true if we can send an ondisk/commit for v
   bool already_complete(eversion_t v);
 
-  // projected object info
+  // projected object info; which unreferenced contexts are kept is up to
+  // OSDService::obc_cache if there is one
   SharedLRU<hobject_t, ObjectContext> object_contexts;
+  void touch_object_context(const ObjectContextRef& obc) {
+    if (osd->obc_cache) {
+      osd->obc_cache->touch(info.pgid, obc->obs.oi.soid, obc);
+    }
+  }
+  void clear_object_contexts() {
+    object_contexts.clear();
+    if (osd->obc_cache) {
+      osd->obc_cache->clear_pg(info.pgid);
+    }
+  }
   // std::map from oid.snapdir() to SnapSetContext *
   std::map<hobject_t, SnapSetContext*> snapset_contexts;
   ceph::mutex snapset_contexts_lock =
@@ -1315,6 +1335,17 @@ protected:
 
   int prepare_transaction(OpContext *ctx);
   std::list<std::pair<OpRequestRef, OpContext*> > in_progress_async_reads;
+  /// unlocked reads in the order they were started, see start_unlocked_read()
+  struct UnlockedReadInFlight {
+    OpRequestRef op;
+    OpContext *ctx;
+    eversion_t version;  ///< object version the reads were started at
+    bool done = false;   ///< reads are in, waiting for the ones before
+  };
+  std::list<UnlockedReadInFlight> in_progress_unlocked_reads;
+  struct C_UnlockedRead;
+  bool start_unlocked_read(OpContext *ctx);
+  void finish_unlocked_read(C_UnlockedRead *c);
   void complete_read_ctx(int result, OpContext *ctx);
 
   // pg on-disk content
@@ -1562,6 +1593,9 @@ public:
 
   void clear_cache() override;
   int get_cache_obj_count() override {
+    if (osd->obc_cache) {
+      return osd->obc_cache->get_pg_count(info.pgid);
+    }
     return object_contexts.get_count();
   }
   unsigned get_pg_shard() const {
@@ -80,6 +80,12 @@ PerfCounters *build_osd_logger(CephContext *cct) {
   osd_plb.add_time_avg(
     l_osd_op_r_prepare_lat, "op_r_prepare_latency",
     "Latency of read operations (excluding queue time and wait for finished)");
+  osd_plb.add_u64_counter(
+    l_osd_op_r_unlocked, "op_r_unlocked",
+    "Client read operations served without holding the PG lock");
+  osd_plb.add_u64_counter(
+    l_osd_op_r_unlocked_retry, "op_r_unlocked_retry",
+    "Client reads redone under the PG lock after an unlocked read");
   osd_plb.add_u64_counter(
     l_osd_op_w, "op_w", "Client write operations");
   osd_plb.add_u64_counter(
@@ -22,6 +22,8 @@ enum osd_counter_idx_t {
   l_osd_op_r_lat_outb_hist,
   l_osd_op_r_process_lat,
   l_osd_op_r_prepare_lat,
+  l_osd_op_r_unlocked,
+  l_osd_op_r_unlocked_retry,
   l_osd_op_w,
   l_osd_op_w_inb,
   l_osd_op_w_lat,
@@ -27,7 +27,11 @@ void PGOpItem::run(
   ThreadPool::TPHandle &handle)
 {
   osd->dequeue_op(pg, op, handle);
+  auto unlocked_work = pg->take_unlocked_work();
   pg->unlock();
+  for (auto c : unlocked_work) {
+    c->complete(0);
+  }
 }
 
 void PGPeeringItem::run(
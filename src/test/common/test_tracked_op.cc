@@ -0,0 +1,174 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:nil -*-
+// vim: ts=8 sw=2 sts=2 expandtab
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "common/Formatter.h"
+#include "common/histogram.h"
+#include "common/TrackedOp.h"
+#include "global/global_context.h"
+
+class TestOp : public TrackedOp {
+public:
+  TestOp(OpTracker *tracker, utime_t initiated)
+    : TrackedOp(tracker, initiated) {}
+
+  using Ref = boost::intrusive_ptr<TestOp>;
+
+  static Ref create(OpTracker *tracker) {
+    Ref op(new TestOp(tracker, ceph_clock_now()));
+    op->tracking_start();
+    return op;
+  }
+
+protected:
+  void _dump(ceph::Formatter *f) const override {
+    f->open_array_section("events");
+    for_each_event([f](const utime_t& stamp, std::string_view event) {
+      f->dump_object("event", Event(stamp, event));
+    });
+    f->close_section();
+  }
+  void _dump_op_descriptor(std::ostream& stream) const override {
+    stream << "test_op(" << seq << ")";
+  }
+};
+
+static size_t count_substr(const std::string& s, std::string_view sub)
+{
+  size_t n = 0;
+  for (auto p = s.find(sub); p != std::string::npos; p = s.find(sub, p + 1)) {
+    ++n;
+  }
+  return n;
+}
+
+TEST(TrackedOp, SampleRate)
+{
+  OpTracker tracker(g_ceph_context, true, 4);
+  tracker.set_sample_rate(4);
+
+  std::vector<TestOp::Ref> ops;
+  for (unsigned i = 0; i < 16; ++i) {
+    ops.push_back(TestOp::create(&tracker));
+  }
+  ASSERT_EQ(16u, tracker.get_num_ops_in_flight());
+  unsigned sampled = 0;
+  for (auto& op : ops) {
+    op->mark_event("queued_for_pg");
+    if (op->is_sampled()) {
+      ++sampled;
+      ASSERT_EQ("queued_for_pg", op->state_string());
+    } else {
+      ASSERT_EQ("queued_for_pg", op->state_string());
+      op->mark_event("waiting for something unusual");
+      ASSERT_EQ("other", op->state_string());
+    }
+  }
+  ASSERT_EQ(4u, sampled);
+
+  {
+    JSONFormatter f;
+    ASSERT_TRUE(tracker.dump_ops_in_flight(&f));
+    std::ostringstream ss;
+    f.flush(ss);
+    ASSERT_NE(std::string::npos, ss.str().find("\"num_ops\":16"));
+    // one events array per op, sampled or not, and every op has its event
+    ASSERT_EQ(16u, count_substr(ss.str(), "\"events\""));
+    ASSERT_EQ(12u, count_substr(ss.str(), "\"sampled\":false"));
+    ASSERT_EQ(16u, count_substr(ss.str(), "\"event\":\"queued_for_pg\""));
+  }
+
+  // unsampled ops drop events beyond their fixed-size array but keep "done"
+  for (auto& op : ops) {
+    if (op->is_sampled())
+      continue;
+    for (unsigned i = 0; i < 64; ++i) {
+      op->mark_event("started");
+    }
+    op->mark_event("done");
+    ASSERT_EQ("done", op->state_string());
+    double duration = op->get_duration();
+    ASSERT_GE(duration, 0);
+    ASSERT_DOUBLE_EQ(duration, op->get_duration());
+    break;
+  }
+
+  ops.clear();
+  ASSERT_EQ(0u, tracker.get_num_ops_in_flight());
+  tracker.on_shutdown();
+}
+
+TEST(TrackedOp, SlotOverflow)
+{
+  OpTracker tracker(g_ceph_context, true, 1);
+
+  std::vector<TestOp::Ref> ops;
+  for (unsigned i = 0; i < 2 * OPTRACKER_SHARD_SLOTS; ++i) {
+    ops.push_back(TestOp::create(&tracker));
+  }
+  ASSERT_EQ(2u * OPTRACKER_SHARD_SLOTS, tracker.get_num_ops_in_flight());
+
+  unsigned visited = 0;
+  utime_t oldest_secs;
+  utime_t last;
+  tracker.set_complaint_and_threshold(0, 0);
+  tracker.visit_ops_in_flight(&oldest_secs, [&](TrackedOp& op) {
+    // oldest first, whether the op sits in a slot or in the overflow list
+    EXPECT_LE(last, op.get_initiated());
+    last = op.get_initiated();
+    ++visited;
+    return true;
+  });
+  ASSERT_EQ(2u * OPTRACKER_SHARD_SLOTS, visited);
+
+  // free every other op, the freed slots are reused
+  for (unsigned i = 0; i < ops.size(); i += 2) {
+    ops[i].reset();
+  }
+  ASSERT_EQ(OPTRACKER_SHARD_SLOTS, tracker.get_num_ops_in_flight());
+  for (unsigned i = 0; i < ops.size(); i += 2) {
+    ops[i] = TestOp::create(&tracker);
+  }
+  ASSERT_EQ(2u * OPTRACKER_SHARD_SLOTS, tracker.get_num_ops_in_flight());
+
+  ops.clear();
+  ASSERT_EQ(0u, tracker.get_num_ops_in_flight());
+  tracker.on_shutdown();
+}
+
+TEST(TrackedOp, ConcurrentRegister)
+{
+  OpTracker tracker(g_ceph_context, true, 2);
+  tracker.set_sample_rate(8);
+
+  std::atomic<bool> stop = false;
+  std::thread dumper([&] {
+    while (!stop) {
+      JSONFormatter f;
+      tracker.dump_ops_in_flight(&f);
+      pow2_hist_t h;
+      tracker.get_age_ms_histogram(&h);
+    }
+  });
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < 4; ++t) {
+    workers.emplace_back([&] {
+      for (unsigned i = 0; i < 10000; ++i) {
+        auto op = TestOp::create(&tracker);
+        op->mark_event("started");
+        op->mark_event("commit_sent");
+      }
+    });
+  }
+  for (auto& w : workers) {
+    w.join();
+  }
+  stop = true;
+  dumper.join();
+
+  ASSERT_EQ(0u, tracker.get_num_ops_in_flight());
+  tracker.on_shutdown();
+}
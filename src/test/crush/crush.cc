@@ -10,9 +10,11 @@
  */
 
 #include <gtest/gtest.h>
+#include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <random>
 #include <set>
 #include <fmt/ranges.h>
 
@@ -1103,6 +1105,97 @@ TEST_F(CRUSHTest, straw2_reweight) {
   }
 }
 
+TEST_F(CRUSHTest, straw2_hash_batch) {
+  // crush_hash32_3_n must match crush_hash32_3 lane for lane, whatever
+  // the length, alignment and contents of the batch.  straw2 only keeps
+  // the low 16 bits of the hash, so walk every 16-bit x.
+  const unsigned max_n = 40;
+  std::mt19937 rng(0);
+  vector<__u32> b(max_n + 8), out(max_n + 8), expected(max_n + 8);
+  const __u32 edges[] = {0, 1, 0x7fffffff, 0x80000000, 0xffffffff,
+                         (__u32)-2, (__u32)-1000};
+  for (__u32 x = 0; x < 0x10000; ++x) {
+    for (unsigned i = 0; i < b.size(); ++i)
+      b[i] = (x + i) % 3 ? rng() : edges[(x + i) % std::size(edges)];
+    __u32 r = x % 5 ? rng() % 50 : rng();
+    unsigned off = x % 8;
+    for (unsigned i = off; i < off + max_n; ++i)
+      expected[i] = crush_hash32_3(CRUSH_HASH_RJENKINS1, x, b[i], r);
+    for (unsigned n = 0; n <= max_n; ++n) {
+      crush_hash32_3_n(CRUSH_HASH_RJENKINS1, x, b.data() + off, r,
+                       out.data(), n);
+      for (unsigned i = 0; i < n; ++i)
+        ASSERT_EQ(expected[off + i], out[i])
+          << "x " << x << " r " << r << " n " << n << " i " << i;
+    }
+  }
+  // unknown hash types hash to 0
+  std::fill(out.begin(), out.end(), 1);
+  crush_hash32_3_n(CRUSH_HASH_RJENKINS1 + 1, 0, b.data(), 0, out.data(),
+                   max_n);
+  for (unsigned i = 0; i < max_n; ++i)
+    ASSERT_EQ(0u, out[i]);
+}
+
+TEST_F(CRUSHTest, DISABLED_straw2_bench) {
+  const int n = 64;
+  int items[n], weights[n];
+  for (int i = 0; i < n; ++i) {
+    items[i] = i;
+    weights[i] = 0x10000 * (1 + i % 4);
+  }
+
+  std::unique_ptr<CrushWrapper> c(new CrushWrapper);
+  const int ROOT_TYPE = 1;
+  c->set_type_name(ROOT_TYPE, "root");
+  const int OSD_TYPE = 0;
+  c->set_type_name(OSD_TYPE, "osd");
+  c->set_max_devices(n);
+
+  int root;
+  crush_bucket *b = crush_make_bucket(c->get_crush_map(),
+				      CRUSH_BUCKET_STRAW2, CRUSH_HASH_RJENKINS1,
+				      ROOT_TYPE, n, items, weights);
+  EXPECT_EQ(0, crush_add_bucket(c->get_crush_map(), 0, b, &root));
+  EXPECT_EQ(0, c->set_item_name(root, "root"));
+  int rule = c->add_simple_rule("rule", "root", "osd", "",
+				"firstn", pg_pool_t::TYPE_REPLICATED);
+  EXPECT_EQ(0, rule);
+  c->finalize();
+
+  const int total = 1000000;
+  vector<unsigned> reweight(n, 0x10000);
+  vector<int> out;
+  auto start = std::chrono::steady_clock::now();
+  for (int x = 0; x < total; ++x)
+    c->do_rule(rule, x, out, 3, reweight, 0);
+  std::chrono::duration<double, std::nano> elapsed =
+    std::chrono::steady_clock::now() - start;
+  cout << "do_rule, " << n << " item straw2 bucket: "
+       << elapsed.count() / total << " ns/mapping" << std::endl;
+
+  __u32 hashes[n];
+  __u32 sum = 0;
+  start = std::chrono::steady_clock::now();
+  for (int x = 0; x < total; ++x) {
+    for (int i = 0; i < n; ++i)
+      hashes[i] = crush_hash32_3(CRUSH_HASH_RJENKINS1, x, items[i], 0);
+    sum += hashes[x % n];
+  }
+  elapsed = std::chrono::steady_clock::now() - start;
+  cout << "crush_hash32_3:   " << elapsed.count() / total / n
+       << " ns/item" << std::endl;
+  start = std::chrono::steady_clock::now();
+  for (int x = 0; x < total; ++x) {
+    crush_hash32_3_n(CRUSH_HASH_RJENKINS1, x, (const __u32 *)items, 0,
+		     hashes, n);
+    sum += hashes[x % n];
+  }
+  elapsed = std::chrono::steady_clock::now() - start;
+  cout << "crush_hash32_3_n: " << elapsed.count() / total / n
+       << " ns/item (" << sum << ")" << std::endl;
+}
+
 struct cluster_test_spec_t {
   const int num_osds_per_host;
   const int num_hosts;
@@ -1,6 +1,7 @@
 #include <common/dout.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <algorithm>
 #include <deque>
 #include <iostream>
 #include <sstream>
@@ -225,6 +226,71 @@ TEST(LibRadosAio, RoundTripPP) {
   ASSERT_EQ(0, memcmp(buf, bl2.c_str(), sizeof(buf)));
 }
 
+struct UnlockedReadOrder {
+  ceph::mutex lock = ceph::make_mutex("UnlockedReadOrder::lock");
+  std::vector<int> order;
+};
+
+struct UnlockedReadArg {
+  UnlockedReadOrder *o;
+  int i;
+};
+
+static void unlocked_read_complete(rados_completion_t, void *arg)
+{
+  auto a = static_cast<UnlockedReadArg*>(arg);
+  std::scoped_lock l{a->o->lock};
+  a->o->order.push_back(a->i);
+}
+
+TEST(LibRadosAio, UnlockedReadOrderPP) {
+  // reads of one object may finish on different op workers in any order,
+  // but must still be replied to in the order they were sent
+  AioTestDataPP test_data;
+  ASSERT_EQ("", test_data.init());
+  auto set_unlocked = [&](bool on) {
+    return test_data.m_cluster.mon_command(
+      fmt::format(R"({{
+        "prefix": "config set",
+        "who": "osd",
+        "name": "osd_read_without_pg_lock",
+        "value": "{}"
+        }})", on),
+      {}, nullptr, nullptr);
+  };
+  ASSERT_EQ(0, set_unlocked(true));
+  auto reset = make_scope_guard([&] { set_unlocked(false); });
+
+  const unsigned size = 1 << 20;
+  bufferlist bl;
+  bl.append(std::string(size, 'a'));
+  ASSERT_EQ(0, test_data.m_ioctx.write_full(test_data.m_oid, bl));
+
+  const int num = 200;
+  UnlockedReadOrder o;
+  std::vector<UnlockedReadArg> args(num);
+  std::vector<bufferlist> bls(num);
+  std::vector<std::unique_ptr<AioCompletion>> completions;
+  for (int i = 0; i < num; ++i) {
+    args[i] = {&o, i};
+    completions.emplace_back(
+      Rados::aio_create_completion(&args[i], unlocked_read_complete));
+    // alternate large and small reads so that later ones tend to finish first
+    unsigned len = i % 2 ? 4096 : size;
+    ASSERT_EQ(0, test_data.m_ioctx.aio_read(test_data.m_oid,
+                                            completions[i].get(),
+                                            &bls[i], len, 0));
+  }
+  for (int i = 0; i < num; ++i) {
+    TestAlarm alarm;
+    ASSERT_EQ(0, completions[i]->wait_for_complete_and_cb());
+    ASSERT_EQ(i % 2 ? 4096 : (int)size, completions[i]->get_return_value());
+  }
+  std::scoped_lock l{o.lock};
+  ASSERT_EQ(num, (int)o.order.size());
+  ASSERT_TRUE(std::is_sorted(o.order.begin(), o.order.end()));
+}
+
 TEST(LibRadosAio, RoundTripPP2) {
   AioTestDataPP test_data;
   ASSERT_EQ("", test_data.init());
@@ -26,6 +26,7 @@ using namespace std;
 #include "common/ceph_argparse.h"
 #include "common/debug.h"
 #include "common/Cycles.h"
+#include "common/perf_counters_collection.h"
 #include "global/global_init.h"
 #include "msg/Messenger.h"
 #include "messages/MOSDOp.h"
@@ -166,14 +167,30 @@ void MessengerClient::ClientDispatcher::ms_fast_dispatch(Message *m) {
 }
 
 
+// sum of a counter over all messenger workers
+static uint64_t get_msgr_counter(const string &name) {
+  uint64_t sum = 0;
+  g_ceph_context->get_perfcounters_collection()->with_counters(
+    [&](const PerfCountersCollectionImpl::CounterMap &counters) {
+      for (auto& [path, ref] : counters) {
+        if (path.starts_with("AsyncMessenger::Worker-") &&
+            path.ends_with("." + name)) {
+          sum += ref.data->u64;
+        }
+      }
+    });
+  return sum;
+}
+
 void usage(const string &name) {
-  cout << "Usage: " << name << " [server ip:port] [numjobs] [concurrency] [ios] [thinktime us] [msg length]" << std::endl;
+  cout << "Usage: " << name << " [server ip:port] [numjobs] [concurrency] [ios] [thinktime us] [msg length] [zerocopy bytes]" << std::endl;
   cout << "       [server ip:port]: connect to the ip:port pair" << std::endl;
   cout << "       [numjobs]: how much client threads spawned and do benchmark" << std::endl;
   cout << "       [concurrency]: the max inflight messages(like iodepth in fio)" << std::endl;
   cout << "       [ios]: how much messages sent for each client" << std::endl;
   cout << "       [thinktime]: sleep time when do fast dispatching(match client logic)" << std::endl;
   cout << "       [msg length]: message data bytes" << std::endl;
+  cout << "       [zerocopy bytes]: optional, send messages of at least this size with MSG_ZEROCOPY" << std::endl;
 }
 
 int main(int argc, char **argv)
@@ -196,6 +213,10 @@ int main(int argc, char **argv)
   int ios = atoi(args[3]);
   int think_time = atoi(args[4]);
   int len = atoi(args[5]);
+  if (args.size() > 6) {
+    g_ceph_context->_conf.set_val_or_die("ms_tcp_zerocopy_min_bytes", args[6]);
+    g_ceph_context->_conf.apply_changes(nullptr);
+  }
 
   std::string public_msgr_type = g_ceph_context->_conf->ms_public_type.empty() ? g_ceph_context->_conf.get_val<std::string>("ms_type") : g_ceph_context->_conf->ms_public_type;
 
@@ -206,6 +227,9 @@ int main(int argc, char **argv)
   cout << "       ios " << ios << std::endl;
   cout << "       thinktime(us) " << think_time << std::endl;
   cout << "       message data bytes " << len << std::endl;
+  cout << "       zerocopy bytes "
+       << g_ceph_context->_conf.get_val<Option::size_t>("ms_tcp_zerocopy_min_bytes")
+       << std::endl;
 
   MessengerClient client(public_msgr_type, args[0], think_time);
 
@@ -215,6 +239,10 @@ int main(int argc, char **argv)
   client.start();
   uint64_t stop = Cycles::rdtsc();
   cout << " Total op " << (ios * numjobs) << " run time " << Cycles::to_microseconds(stop - start) << "us." << std::endl;
+  cout << " Sent " << get_msgr_counter("msgr_send_bytes") << " bytes, "
+       << get_msgr_counter("msgr_send_zerocopy_bytes") << " zero-copy, "
+       << get_msgr_counter("msgr_send_zerocopy_copied") << " copied by the kernel, "
+       << get_msgr_counter("msgr_send_zerocopy_fallbacks") << " fallbacks" << std::endl;
 
   return 0;
 }
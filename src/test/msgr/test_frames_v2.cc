@@ -26,6 +26,7 @@
 #include "global/global_init.h"
 #include "global/global_context.h"
 #include "include/Context.h"
+#include "common/ceph_time.h"
 
 #include <gtest/gtest.h>
 
@@ -148,6 +149,27 @@ static bufferlist make_bufferlist(size_t len, char c) {
   return bl;
 }
 
+// copy of bl made of frag_len sized buffers, like an encoded message
+static bufferlist fragment(const bufferlist& bl, size_t frag_len) {
+  bufferlist fragmented;
+  for (size_t off = 0; off < bl.length(); off += frag_len) {
+    bufferlist frag;
+    frag.substr_of(bl, off, std::min(frag_len, bl.length() - off));
+    fragmented.append(buffer::ptr(frag.c_str(), frag.length()));
+  }
+  return fragmented;
+}
+
+static AuthConnectionMeta make_secure_auth_meta() {
+  AuthConnectionMeta auth_meta;
+  auth_meta.con_mode = CEPH_CON_MODE_SECURE;
+  // see AuthConnectionMeta::get_connection_secret_length()
+  auth_meta.connection_secret.resize(64);
+  g_ceph_context->random()->get_bytes(auth_meta.connection_secret.data(),
+                                      auth_meta.connection_secret.size());
+  return auth_meta;
+}
+
 bool disassemble_frame(FrameAssembler& frame_asm, bufferlist& frame_bl,
                        Tag& tag, segment_bls_t& segment_bls) {
   bufferlist preamble_bl;
@@ -187,12 +209,7 @@ protected:
         m_data(make_bufferlist(std::get<0>(GetParam()).data_len, 'D')) {
     const auto& m = std::get<1>(GetParam());
     if (m.is_secure) {
-      AuthConnectionMeta auth_meta;
-      auth_meta.con_mode = CEPH_CON_MODE_SECURE;
-      // see AuthConnectionMeta::get_connection_secret_length()
-      auth_meta.connection_secret.resize(64);
-      g_ceph_context->random()->get_bytes(auth_meta.connection_secret.data(),
-                                          auth_meta.connection_secret.size());
+      auto auth_meta = make_secure_auth_meta();
       m_tx_crypto = ceph::crypto::onwire::rxtx_t::create_handler_pair(
           g_ceph_context, auth_meta, /*new_nonce_format=*/m.is_rev1,
           /*crossed=*/false);
@@ -233,8 +250,13 @@ protected:
                       frame_asm.get_frame_onwire_len());
   }
 
-  void test_round_trip() {
-    auto tx_frame = TestFrame::Encode(m_header, m_front, m_middle, m_data);
+  void test_round_trip(size_t frag_len = 0) {
+    auto tx_frame = frag_len ?
+      TestFrame::Encode(fragment(m_header, frag_len),
+                        fragment(m_front, frag_len),
+                        fragment(m_middle, frag_len),
+                        fragment(m_data, frag_len)) :
+      TestFrame::Encode(m_header, m_front, m_middle, m_data);
     auto onwire_bl = tx_frame.get_buffer(m_tx_frame_asm);
     check_frame_assembler(m_tx_frame_asm);
     EXPECT_EQ(m_tx_frame_asm.get_frame_onwire_len(), onwire_bl.length());
@@ -280,6 +302,13 @@ TEST_P(RoundTripTest, Reuse) {
   }
 }
 
+TEST_P(RoundTripTest, Fragmented) {
+  // small fragments are gathered before being encrypted in secure mode
+  for (size_t frag_len : {1, 7, 16, 100, 4096}) {
+    test_round_trip(frag_len);
+  }
+}
+
 static const round_trip_instance_t round_trip_instances[] = {
   // first segment is empty
   { 0,   0,   0,   0, 1, {{32,  0,  17,   0,   0,  0},
@@ -437,6 +466,46 @@ TEST_P(RoundTripPerfTest, DISABLED_Basic) {
   }
 }
 
+// encryption only, each fragment on its own vs. gathered fragments
+TEST_P(RoundTripPerfTest, DISABLED_SecureGather) {
+  const auto& m = std::get<1>(GetParam());
+  if (!m.is_secure || m.is_compress) {
+    GTEST_SKIP();
+  }
+  const size_t frame_len = m_header.length() + m_front.length() +
+    m_middle.length() + m_data.length();
+  const int iterations = std::max<size_t>(1000, (1ull << 31) / frame_len);
+  auto conf_gather_max =
+    g_ceph_context->_conf.get_val<Option::size_t>("ms_crypto_gather_max_fragment");
+  for (size_t frag_len : {size_t(0), size_t(512), size_t(4096)}) {
+    for (uint64_t gather_max : {0, 1024, 4096}) {
+      g_ceph_context->_conf.set_val_or_die("ms_crypto_gather_max_fragment",
+                                           std::to_string(gather_max));
+      auto crypto = ceph::crypto::onwire::rxtx_t::create_handler_pair(
+          g_ceph_context, make_secure_auth_meta(), m.is_rev1, false);
+      FrameAssembler frame_asm(&crypto, m.is_rev1, true, &m_tx_comp);
+      auto header = frag_len ? fragment(m_header, frag_len) : m_header;
+      auto front = frag_len ? fragment(m_front, frag_len) : m_front;
+      auto middle = frag_len ? fragment(m_middle, frag_len) : m_middle;
+      auto data = frag_len ? fragment(m_data, frag_len) : m_data;
+
+      auto start = ceph::mono_clock::now();
+      for (int i = 0; i < iterations; i++) {
+        auto tx_frame = TestFrame::Encode(header, front, middle, data);
+        auto onwire_bl = tx_frame.get_buffer(frame_asm);
+      }
+      auto elapsed = ceph::to_seconds<double>(ceph::mono_clock::now() - start);
+      std::cout << "fragments " << (frag_len ? std::to_string(frag_len) : "whole")
+                << " gather_max " << gather_max << ": "
+                << iterations / elapsed << " frames/s, "
+                << iterations * frame_len / elapsed / (1 << 20) << " MiB/s"
+                << std::endl;
+    }
+  }
+  g_ceph_context->_conf.set_val_or_die("ms_crypto_gather_max_fragment",
+                                       std::to_string(conf_gather_max));
+}
+
 static const round_trip_instance_t round_trip_perf_instances[] = {
   {41, 250, 0,       0, 2, {{32, 41, 250, 17,       0,  0},
                             {32, 48, 256, 32,       0,  0},
@@ -44,6 +44,7 @@
 #include "msg/Message.h"
 #include "msg/Messenger.h"
 #include "msg/msg_types.h"
+#include "msg/async/AsyncConnection.h"
 #include "msg/async/AsyncMessenger.h"
 
 typedef boost::mt11213b gen_type;
@@ -947,6 +948,131 @@ TEST_P(MessengerTest, DumpBasics) {
   client_msgr->wait();
 }
 
+TEST_P(MessengerTest, MigrateConnection) {
+  if (std::strstr(GetParam(), "posix") == nullptr) {
+    GTEST_SKIP() << "skipping as only posix sockets can change workers";
+  }
+  auto stack = static_cast<AsyncMessenger*>(client_msgr)->get_stack();
+  if (stack->get_num_worker() < 2) {
+    GTEST_SKIP() << "skipping as there is only one worker";
+  }
+
+  FakeDispatcher cli_dispatcher(false), srv_dispatcher(true);
+  entity_addr_t bind_addr;
+  bind_addr.parse("v2:127.0.0.1");
+  server_msgr->bind(bind_addr);
+  server_msgr->add_dispatcher_head(&srv_dispatcher);
+  server_msgr->start();
+  client_msgr->add_dispatcher_head(&cli_dispatcher);
+  client_msgr->start();
+
+  ConnectionRef conn = client_msgr->connect_to(server_msgr->get_mytype(),
+					       server_msgr->get_myaddrs());
+  auto round_trip = [&] {
+    ASSERT_EQ(conn->send_message(new MPing()), 0);
+    std::unique_lock l{cli_dispatcher.lock};
+    cli_dispatcher.cond.wait(l, [&] { return cli_dispatcher.got_new; });
+    cli_dispatcher.got_new = false;
+  };
+  round_trip();
+  ASSERT_TRUE(conn->is_connected());
+
+  auto async_conn = static_cast<AsyncConnection*>(conn.get());
+  for (unsigned i = 1; i <= stack->get_num_worker(); ++i) {
+    Worker* from = async_conn->get_worker();
+    Worker* to = stack->get_worker((from->id + 1) % stack->get_num_worker());
+    // messages sent while the connection is on its way are not lost
+    ASSERT_EQ(conn->send_message(new MPing()), 0);
+    async_conn->migrate(to);
+    CHECK_AND_WAIT_TRUE(async_conn->get_worker() == to);
+    ASSERT_EQ(to, async_conn->get_worker());
+    {
+      std::unique_lock l{cli_dispatcher.lock};
+      cli_dispatcher.cond.wait(l, [&] { return cli_dispatcher.got_new; });
+      cli_dispatcher.got_new = false;
+    }
+    round_trip();
+    ASSERT_TRUE(conn->is_connected());
+    ASSERT_EQ(1 + 2 * i,
+	      static_cast<Session*>(conn->get_priv().get())->get_count());
+  }
+
+  auto f = Formatter::create_unique("json");
+  std::ostringstream os;
+  static_cast<AsyncMessenger*>(client_msgr)->dump_workers(f.get());
+  f->flush(os);
+  ASSERT_THAT(os.str(), ::testing::HasSubstr("connections_moved_in"));
+
+  client_msgr->shutdown();
+  client_msgr->wait();
+  server_msgr->shutdown();
+  server_msgr->wait();
+}
+
+TEST_P(MessengerTest, FastDispatchBatch) {
+  struct BatchDispatcher : public FakeDispatcher {
+    std::vector<uint64_t> seqs;
+    std::vector<size_t> batches;
+    BatchDispatcher() : FakeDispatcher(true) {}
+    void ms_fast_dispatch_batch(const std::vector<MessageRef>& ms) override {
+      {
+	std::lock_guard l{lock};
+	batches.push_back(ms.size());
+	for (const auto& m : ms) {
+	  seqs.push_back(m->get_seq());
+	}
+      }
+      FakeDispatcher::ms_fast_dispatch_batch(ms);
+    }
+  } srv_dispatcher;
+  FakeDispatcher cli_dispatcher(false);
+  entity_addr_t bind_addr;
+  bind_addr.parse("v2:127.0.0.1");
+  server_msgr->bind(bind_addr);
+  server_msgr->add_dispatcher_head(&srv_dispatcher);
+  server_msgr->start();
+  client_msgr->add_dispatcher_head(&cli_dispatcher);
+  client_msgr->start();
+
+  ConnectionRef conn = client_msgr->connect_to(server_msgr->get_mytype(),
+					       server_msgr->get_myaddrs());
+  const unsigned num_msgs = 1000;
+  for (unsigned i = 0; i < num_msgs; ++i) {
+    ASSERT_EQ(conn->send_message(new MPing()), 0);
+  }
+  {
+    std::unique_lock l{cli_dispatcher.lock};
+    cli_dispatcher.cond.wait(l, [&] {
+      return static_cast<Session*>(conn->get_priv().get())->get_count() ==
+	num_msgs;
+    });
+  }
+
+  {
+    std::lock_guard l{srv_dispatcher.lock};
+    // batches only ever hold messages read back to back, in order
+    const auto batch_max =
+      g_ceph_context->_conf.get_val<uint64_t>("ms_fast_dispatch_batch");
+    size_t batched = 0;
+    for (auto n : srv_dispatcher.batches) {
+      ASSERT_GT(n, 1u);
+      ASSERT_LE(n, batch_max);
+      batched += n;
+    }
+    ASSERT_EQ(batched, srv_dispatcher.seqs.size());
+    // how many of them are batched depends on how the socket happened to
+    // be read, so there is no lower bound
+    ASSERT_LE(batched, num_msgs);
+    ASSERT_TRUE(std::is_sorted(srv_dispatcher.seqs.begin(),
+			       srv_dispatcher.seqs.end()));
+  }
+
+  client_msgr->shutdown();
+  client_msgr->wait();
+  server_msgr->shutdown();
+  server_msgr->wait();
+}
+
 TEST(MessengerTest, AdminSocketHookLifecycle) {
   DummyAuthClientServer dummy_auth(g_ceph_context);
   Messenger* server_msgr = Messenger::create(
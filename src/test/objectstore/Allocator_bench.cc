@@ -16,6 +16,7 @@
 #include "include/Context.h"
 #include "os/bluestore/Allocator.h"
 #include "os/bluestore/AllocatorBase.h"
+#include "os/bluestore/fastbmap_simd.h"
 
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/uniform_int.hpp>
@@ -851,6 +852,87 @@ TEST_P(AllocTest, mempoolAccounting)
   ASSERT_EQ(mempool::bluestore_alloc::allocated_items(), items);
 }
 
+/*
+* Compares the scalar, AVX2 and AVX-512 slot scanning kernels used by the
+* bitmap allocator. First the raw kernels are timed over a 1TB/4K bitmap,
+* then the same fragmented allocation workload is replayed against a 128GB
+* bitmap allocator with each kernel set.
+*/
+TEST(BitmapKernels, test_bitmap_kernels_bench)
+{
+  using namespace fastbmap_simd;
+  auto saved = active->impl;
+  uint64_t capacity = uint64_t(1024) * 1024 * 1024 * 1024;
+  uint64_t alloc_unit = 4096;
+
+  std::vector<uint64_t> slots(capacity / alloc_unit / 64, ~0ull);
+  slots.back() = 0;
+  for (auto impl : {impl_t::SCALAR, impl_t::AVX2, impl_t::AVX512}) {
+    auto k = get_kernels(impl);
+    if (!k) {
+      continue;
+    }
+    utime_t start = ceph_clock_now();
+    size_t pos = 0;
+    uint64_t bits = 0;
+    for (size_t i = 0; i < 10; i++) {
+      pos += k->find_first_not(slots.data(), slots.size(), ~0ull);
+      bits += k->count_set(slots.data(), slots.size());
+    }
+    std::cout << k->name << " scan+count x10 executed in "
+      << ceph_clock_now() - start << std::endl;
+    EXPECT_EQ(pos, (slots.size() - 1) * 10);
+    EXPECT_EQ(bits, (slots.size() - 1) * 64 * 10);
+  }
+
+  capacity = uint64_t(1024) * 1024 * 1024 * 128;
+  for (auto impl : {impl_t::SCALAR, impl_t::AVX2, impl_t::AVX512}) {
+    if (!select(impl)) {
+      continue;
+    }
+    boost::scoped_ptr<Allocator> alloc(
+      Allocator::create(g_ceph_context, "bitmap", capacity, alloc_unit));
+    alloc->init_add_free(0, capacity);
+
+    // same seed for every kernel set, fragment 90% used space
+    gen_type rng(0);
+    boost::uniform_int<> u1(0, 4); // 4K-64K
+    PExtentVector tmp;
+    AllocTracker at(capacity, alloc_unit);
+    for (uint64_t i = 0; i < capacity - capacity / 10; ) {
+      tmp.clear();
+      auto r = alloc->allocate(alloc_unit << u1(rng), alloc_unit, 0, -1, &tmp);
+      if (r <= 0) {
+        break;
+      }
+      i += r;
+      for (auto& a : tmp) {
+        at.push(a.offset, a.length);
+      }
+      uint64_t o = 0;
+      uint32_t l = 0;
+      if ((i / alloc_unit) % 2 && at.pop_random(rng, &o, &l, alloc_unit)) {
+        interval_set<uint64_t> release_set;
+        release_set.insert(o, l);
+        alloc->release(release_set);
+      }
+    }
+
+    utime_t start = ceph_clock_now();
+    boost::uniform_int<> u2(4, 8); // 64K-1M
+    for (size_t i = 0; i < 100000; i++) {
+      tmp.clear();
+      alloc->allocate(alloc_unit << u2(rng), alloc_unit, 0, -1, &tmp);
+      alloc->release(tmp);
+    }
+    std::cout << active->name << " fragmented alloc/release executed in "
+      << ceph_clock_now() - start
+      << " fragmentation:" << alloc->get_fragmentation_score()
+      << std::endl;
+  }
+  select(saved);
+}
+
 INSTANTIATE_TEST_SUITE_P(
   Allocator,
   AllocTest,
@@ -363,6 +363,13 @@ void ObjectStoreImitator::_add_transaction(Transaction *t) {
         continue;
     } break;
 
+    case Transaction::OP_DESTROY_COLLECTION: {
+      const coll_t &cid = i.get_cid(op->cid);
+      r = _destroy_collection(cid, &c);
+      if (!r)
+        continue;
+    } break;
+
     case Transaction::OP_MKCOLL: {
       ceph_assert(!c);
       const coll_t &cid = i.get_cid(op->cid);
@@ -1105,6 +1112,23 @@ out:
   return r;
 }
 
+int ObjectStoreImitator::_destroy_collection(const coll_t &cid,
+                                             CollectionRef *c) {
+  std::unique_lock l(coll_lock);
+  if (!*c)
+    return -ENOENT;
+
+  ceph_assert((*c)->exists);
+  for (auto &[_, o] : (*c)->objects) {
+    if (o->exists) {
+      _do_truncate(*c, o, 0);
+      o->exists = false;
+    }
+  }
+  _do_remove_collection(c);
+  return 0;
+}
+
 void ObjectStoreImitator::_do_remove_collection(CollectionRef *c) {
   coll_map.erase((*c)->cid);
   (*c)->exists = false;
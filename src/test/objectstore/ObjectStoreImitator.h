@@ -157,6 +157,7 @@ private:
                        std::vector<ghobject_t> *ls, ghobject_t *next);
   int _remove_collection(const coll_t &cid, CollectionRef *c);
   void _do_remove_collection(CollectionRef *c);
+  int _destroy_collection(const coll_t &cid, CollectionRef *c);
   int _create_collection(const coll_t &cid, unsigned bits, CollectionRef *c);
 
   // Transactions
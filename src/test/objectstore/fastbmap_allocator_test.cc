@@ -2,6 +2,7 @@
 // vim: ts=8 sw=2 sts=2 expandtab
 
 #include <iostream>
+#include <random>
 #include <gtest/gtest.h>
 
 #include "os/bluestore/fastbmap_allocator_impl.h"
@@ -1252,3 +1253,35 @@ TEST(TestAllocatorLevel02, test_expand_multiple_times)
   uint64_t free_final = al2.debug_get_free();
   ASSERT_EQ(free_final, 28 * 1024 * 1024); // 128MiB - 100MiB
 }
+
+TEST(TestFastBmapSimd, kernels_match_scalar)
+{
+  using namespace fastbmap_simd;
+  auto scalar = get_kernels(impl_t::SCALAR);
+  ASSERT_NE(scalar, nullptr);
+
+  std::mt19937_64 rng(0);
+  std::vector<uint64_t> slots(67);
+  for (auto impl : {impl_t::AVX2, impl_t::AVX512}) {
+    auto k = get_kernels(impl);
+    if (!k) {
+      std::cout << "skipping unsupported " << int(impl) << std::endl;
+      continue;
+    }
+    for (size_t i = 0; i < 1000; i++) {
+      uint64_t fill = (i & 1) ? all_slot_set : all_slot_clear;
+      std::fill(slots.begin(), slots.end(), fill);
+      auto pos = rng() % (slots.size() + 1);
+      if (pos < slots.size()) {
+        slots[pos] = rng();
+      }
+      for (size_t start = 0; start < slots.size(); start += 5) {
+        auto n = slots.size() - start;
+        ASSERT_EQ(scalar->find_first_not(&slots[start], n, fill),
+                  k->find_first_not(&slots[start], n, fill)) << k->name;
+        ASSERT_EQ(scalar->count_set(&slots[start], n),
+                  k->count_set(&slots[start], n)) << k->name;
+      }
+    }
+  }
+}
@@ -2624,6 +2624,115 @@ TEST_P(StoreTestSpecificAUSize, BluestoreFragmentedBlobTest) {
     ASSERT_EQ( 0u, statfs.data_compressed_allocated);
   }
 }
+
+TEST_P(StoreTestSpecificAUSize, BluestoreDefragRoundTest) {
+  if(string(GetParam()) != "bluestore")
+    return;
+  SetVal(g_conf(), "bluestore_defrag_interval", "3600");
+  SetVal(g_conf(), "bluestore_defrag_min_score", "2");
+  g_conf().apply_changes(nullptr);
+  StartDeferred(0x1000);
+
+  int r;
+  coll_t cid;
+  ghobject_t hoid(hobject_t(sobject_t("Object 1", CEPH_NOSNAP)));
+  ghobject_t hoid2(hobject_t(sobject_t("Object 2", CEPH_NOSNAP)));
+  ghobject_t hoid3(hobject_t(sobject_t("Object 3", CEPH_NOSNAP)));
+  const PerfCounters* logger = store->get_perf_counters();
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // interleave appends to three objects so that none gets a
+  // contiguous allocation; Object 3 has a hole after every chunk
+  const unsigned chunks = 16;
+  bufferlist expected, expected3;
+  for (unsigned i = 0; i < chunks; ++i) {
+    ObjectStore::Transaction t;
+    bufferlist bl, bl2, bl3;
+    bl.append(string(0x1000, 'a' + i));
+    bl2.append(string(0x1000, 'A' + i));
+    bl3.append(string(0x1000, '0' + i));
+    expected.append(bl);
+    expected3.append(bl3);
+    expected3.append_zero(0x1000);
+    t.write(cid, hoid, i * 0x1000, bl.length(), bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+    ObjectStore::Transaction t2;
+    t2.write(cid, hoid2, i * 0x1000, bl2.length(), bl2);
+    r = queue_transaction(store, ch, std::move(t2));
+    ASSERT_EQ(r, 0);
+    ObjectStore::Transaction t3;
+    t3.write(cid, hoid3, i * 0x2000, bl3.length(), bl3);
+    r = queue_transaction(store, ch, std::move(t3));
+    ASSERT_EQ(r, 0);
+  }
+  // drop the trailing hole, the object ends with the last chunk
+  expected3.splice(expected3.length() - 0x1000, 0x1000);
+  const uint64_t size3 = expected3.length();
+  // remount so nothing is in flight, then pull both objects back into
+  // the onode cache where the defragmenter looks for candidates
+  ch.reset();
+  r = store->umount();
+  ASSERT_EQ(r, 0);
+  r = store->mount();
+  ASSERT_EQ(r, 0);
+  ch = store->open_collection(cid);
+  {
+    bufferlist bl;
+    r = store->read(ch, hoid, 0, chunks * 0x1000, bl);
+    ASSERT_EQ(r, (int)(chunks * 0x1000));
+    r = store->read(ch, hoid2, 0, chunks * 0x1000, bl);
+    ASSERT_EQ(r, (int)(chunks * 0x1000));
+    r = store->read(ch, hoid3, 0, size3, bl);
+    ASSERT_EQ(r, (int)size3);
+  }
+  int score_before = get_onode(cid, hoid)->get_fragmentation_score();
+  ASSERT_GE(score_before, 2);
+  ASSERT_GE(get_onode(cid, hoid3)->get_fragmentation_score(), 2);
+
+  BlueStore* bstore = dynamic_cast<BlueStore*> (store.get());
+  auto objects_before = logger->get(l_bluestore_defrag_objects);
+  bstore->debug_defrag_round();
+  ASSERT_GT(logger->get(l_bluestore_defrag_objects), objects_before);
+  ASSERT_LT(get_onode(cid, hoid)->get_fragmentation_score(), score_before);
+  {
+    bufferlist bl;
+    r = store->read(ch, hoid, 0, chunks * 0x1000, bl);
+    ASSERT_EQ(r, (int)(chunks * 0x1000));
+    ASSERT_TRUE(bl_eq(expected, bl));
+  }
+  {
+    // the sparse object keeps its data and its holes
+    bufferlist bl;
+    r = store->read(ch, hoid3, 0, size3, bl);
+    ASSERT_EQ(r, (int)size3);
+    ASSERT_TRUE(bl_eq(expected3, bl));
+    map<uint64_t, uint64_t> m;
+    r = store->fiemap(ch, hoid3, 0, size3, m);
+    ASSERT_EQ(r, 0);
+    uint64_t mapped = 0;
+    for (auto& [off, len] : m) {
+      ASSERT_EQ(off % 0x2000, 0u);
+      ASSERT_EQ(len, 0x1000u);
+      mapped += len;
+    }
+    ASSERT_EQ(mapped, chunks * 0x1000);
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove(cid, hoid2);
+    t.remove(cid, hoid3);
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
 #endif
 
 TEST_P(StoreTest, ManySmallWrite) {
@@ -6996,6 +7105,217 @@ TEST_P(StoreTest, ColSplitTest3) {
 }
 #endif
 
+TEST_P(StoreTest, DestroyCollection) {
+  const int64_t pool = 53;
+  // the two pgs of a pool with pg_num 2, the second one ends where the
+  // keys of the next pool start
+  coll_t acid(spg_t(pg_t(0, pool), shard_id_t::NO_SHARD));
+  coll_t bcid(spg_t(pg_t(1, pool), shard_id_t::NO_SHARD));
+  auto ach = store->create_new_collection(acid);
+  auto bch = store->create_new_collection(bcid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(acid, 1);
+    ASSERT_EQ(0, queue_transaction(store, ach, std::move(t)));
+  }
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(bcid, 1);
+    ASSERT_EQ(0, queue_transaction(store, bch, std::move(t)));
+  }
+  bufferlist data, small;
+  data.append(std::string(0x10000, 'a'));
+  small.append("small");
+  const unsigned num_heads = 50;
+  auto populate = [&](const coll_t& cid, ObjectStore::CollectionHandle& ch,
+		      uint32_t parity, std::vector<ghobject_t>* objs) {
+    for (uint32_t i = 0; i < num_heads; ++i) {
+      ObjectStore::Transaction t;
+      ghobject_t oid(hobject_t("obj" + stringify(i), "", CEPH_NOSNAP,
+			       (i << 1) | parity, pool, ""));
+      t.write(cid, oid, 0, data.length(), data);
+      map<string, bufferlist> km;
+      km["key" + stringify(i)] = small;
+      t.omap_setkeys(cid, oid, km);
+      objs->push_back(oid);
+      if (i % 10 == 0) {
+	ghobject_t clone = oid;
+	clone.hobj.snap = 1;
+	t.clone(cid, oid, clone);
+	objs->push_back(clone);
+      }
+      ASSERT_EQ(0, queue_transaction(store, ch, std::move(t)));
+    }
+    ObjectStore::Transaction t;
+    ghobject_t temp(hobject_t("tmp", "", CEPH_NOSNAP, parity, pool, "")
+		    .make_temp_hobject("tmp"));
+    t.write(cid, temp, 0, data.length(), data);
+    objs->push_back(temp);
+    ASSERT_EQ(0, queue_transaction(store, ch, std::move(t)));
+  };
+  std::vector<ghobject_t> aobjs, bobjs;
+  populate(bcid, bch, 1, &bobjs);
+  bch->flush();
+  struct store_statfs_t before;
+  ASSERT_EQ(0, store->statfs(&before));
+  populate(acid, ach, 0, &aobjs);
+  if (string(GetParam()) == "bluestore") {
+    // destroy a pg whose objects are mostly not in the onode cache
+    ach.reset();
+    bch.reset();
+    EXPECT_EQ(store->umount(), 0);
+    EXPECT_EQ(store->mount(), 0);
+    ach = store->open_collection(acid);
+    bch = store->open_collection(bcid);
+    bufferlist bl;
+    ASSERT_EQ((int)data.length(),
+	      store->read(ach, aobjs.front(), 0, data.length(), bl));
+  }
+
+  {
+    ObjectStore::Transaction t;
+    t.destroy_collection(acid);
+    ASSERT_EQ(0, queue_transaction(store, ach, std::move(t)));
+  }
+  ach->flush();
+  ASSERT_FALSE(store->collection_exists(acid));
+  if (string(GetParam()) == "bluestore") {
+    struct store_statfs_t after;
+    ASSERT_EQ(0, store->statfs(&after));
+    ASSERT_EQ(before.allocated, after.allocated);
+    ASSERT_EQ(before.data_stored, after.data_stored);
+    const PerfCounters* logger = store->get_perf_counters();
+    ASSERT_EQ(logger->get(l_bluestore_destroy_coll_objects), aobjs.size());
+  }
+
+  // the neighbouring pg is untouched
+  {
+    vector<ghobject_t> ls;
+    ASSERT_EQ(0, collection_list(store, bch, ghobject_t(),
+				 ghobject_t::get_max(), INT_MAX, &ls, nullptr));
+    ASSERT_EQ(ls.size(), bobjs.size());
+    for (auto& oid : bobjs) {
+      bufferlist bl;
+      ASSERT_EQ((int)data.length(), store->read(bch, oid, 0, data.length(), bl));
+      ASSERT_TRUE(bl_eq(data, bl));
+    }
+    for (uint32_t i = 0; i < num_heads; ++i) {
+      ghobject_t oid(hobject_t("obj" + stringify(i), "", CEPH_NOSNAP,
+			       (i << 1) | 1, pool, ""));
+      bufferlist h;
+      map<string, bufferlist> out;
+      ASSERT_EQ(0, store->omap_get(bch, oid, &h, &out));
+      ASSERT_EQ(1u, out.size());
+    }
+  }
+
+  if (string(GetParam()) == "bluestore") {
+    ach.reset();
+    bch.reset();
+    EXPECT_EQ(store->umount(), 0);
+    ASSERT_EQ(store->fsck(false), 0);
+    EXPECT_EQ(store->mount(), 0);
+    bch = store->open_collection(bcid);
+  }
+  ach = store->create_new_collection(acid);
+  // nothing of the removed objects shows up in a recreated pg
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(acid, 1);
+    ASSERT_EQ(0, queue_transaction(store, ach, std::move(t)));
+    vector<ghobject_t> ls;
+    ASSERT_EQ(0, collection_list(store, ach, ghobject_t(),
+				 ghobject_t::get_max(), INT_MAX, &ls, nullptr));
+    ASSERT_TRUE(ls.empty());
+    ghobject_t oid(hobject_t("obj0", "", CEPH_NOSNAP, 0, pool, ""));
+    ObjectStore::Transaction t2;
+    t2.touch(acid, oid);
+    ASSERT_EQ(0, queue_transaction(store, ach, std::move(t2)));
+    bufferlist h;
+    map<string, bufferlist> out;
+    ASSERT_EQ(0, store->omap_get(ach, oid, &h, &out));
+    ASSERT_TRUE(out.empty());
+  }
+  {
+    ObjectStore::Transaction t;
+    t.destroy_collection(acid);
+    t.destroy_collection(bcid);
+    ASSERT_EQ(0, queue_transaction(store, ach, std::move(t)));
+  }
+}
+
+TEST_P(StoreTest, DestroyCollectionECShard) {
+  // per-pg omap keys carry no shard: destroying one shard of an EC pg
+  // must leave the omap of the other shards on this OSD alone
+  const int64_t pool = 54;
+  coll_t acid(spg_t(pg_t(0, pool), shard_id_t(0)));
+  coll_t bcid(spg_t(pg_t(0, pool), shard_id_t(1)));
+  auto ach = store->create_new_collection(acid);
+  auto bch = store->create_new_collection(bcid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(acid, 0);
+    ASSERT_EQ(0, queue_transaction(store, ach, std::move(t)));
+  }
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(bcid, 0);
+    ASSERT_EQ(0, queue_transaction(store, bch, std::move(t)));
+  }
+  bufferlist small;
+  small.append("small");
+  const unsigned num_objs = 20;
+  auto make_oid = [&](uint32_t i, shard_id_t shard) {
+    return ghobject_t(hobject_t("obj" + stringify(i), "", CEPH_NOSNAP,
+				i, pool, ""),
+		      ghobject_t::NO_GEN, shard);
+  };
+  auto populate = [&](const coll_t& cid, ObjectStore::CollectionHandle& ch,
+		      shard_id_t shard) {
+    for (uint32_t i = 0; i < num_objs; ++i) {
+      ObjectStore::Transaction t;
+      ghobject_t oid = make_oid(i, shard);
+      t.touch(cid, oid);
+      map<string, bufferlist> km;
+      km["key" + stringify(i)] = small;
+      t.omap_setkeys(cid, oid, km);
+      ASSERT_EQ(0, queue_transaction(store, ch, std::move(t)));
+    }
+  };
+  populate(acid, ach, shard_id_t(0));
+  populate(bcid, bch, shard_id_t(1));
+  {
+    ObjectStore::Transaction t;
+    t.destroy_collection(acid);
+    ASSERT_EQ(0, queue_transaction(store, ach, std::move(t)));
+  }
+  ach->flush();
+  ASSERT_FALSE(store->collection_exists(acid));
+  for (uint32_t i = 0; i < num_objs; ++i) {
+    bufferlist h;
+    map<string, bufferlist> out;
+    ASSERT_EQ(0, store->omap_get(bch, make_oid(i, shard_id_t(1)), &h, &out));
+    ASSERT_EQ(1u, out.size());
+    ASSERT_TRUE(out.count("key" + stringify(i)));
+  }
+  if (string(GetParam()) == "bluestore") {
+    ach.reset();
+    bch.reset();
+    EXPECT_EQ(store->umount(), 0);
+    ASSERT_EQ(store->fsck(false), 0);
+    EXPECT_EQ(store->mount(), 0);
+    bch = store->open_collection(bcid);
+  }
+  {
+    ObjectStore::Transaction t;
+    for (uint32_t i = 0; i < num_objs; ++i) {
+      t.remove(bcid, make_oid(i, shard_id_t(1)));
+    }
+    t.remove_collection(bcid);
+    ASSERT_EQ(0, queue_transaction(store, bch, std::move(t)));
+  }
+}
+
 void test_merge_skewed(ObjectStore *store,
 		       unsigned base, unsigned bits,
 		       unsigned anum, unsigned bnum)
@@ -8409,6 +8729,57 @@ TEST_P(StoreTestSpecificAUSize, BlobReuseOnOverwrite) {
   }
 }
 
+TEST_P(StoreTestSpecificAUSize, OnodeLocklessLookup) {
+
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  StartDeferred(4096);
+
+  int r;
+  coll_t cid;
+  ghobject_t hoid(hobject_t("test_lockless", "", CEPH_NOSNAP, 0, -1, ""));
+  ghobject_t hoid2(hobject_t("test_lockless2", "", CEPH_NOSNAP, 0, -1, ""));
+
+  const PerfCounters* logger = store->get_perf_counters();
+
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    t.touch(cid, hoid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  struct stat st;
+  auto hits = logger->get(l_bluestore_onode_lockless_hits);
+  ASSERT_EQ(store->stat(ch, hoid, &st), 0);
+  ASSERT_EQ(store->stat(ch, hoid, &st), 0);
+  ASSERT_GT(logger->get(l_bluestore_onode_lockless_hits), hits);
+  {
+    // renamed onode must not be found under the old name
+    ObjectStore::Transaction t;
+    t.collection_move_rename(cid, hoid, cid, hoid2);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  ASSERT_EQ(store->stat(ch, hoid, &st), -ENOENT);
+  ASSERT_EQ(store->stat(ch, hoid2, &st), 0);
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid2);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  ASSERT_EQ(store->stat(ch, hoid2, &st), -ENOENT);
+  {
+    ObjectStore::Transaction t;
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTestSpecificAUSize, ManyManyExtents) {
 
   if (string(GetParam()) != "bluestore")
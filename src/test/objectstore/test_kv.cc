@@ -19,6 +19,7 @@
 #include <iostream>
 #include <string>
 #include <random>
+#include <thread>
 #include <time.h>
 #include <sys/mount.h>
 #include "kv/KeyValueDB.h"
@@ -564,6 +565,65 @@ TEST_P(KVTest, RocksDBShardingIteratorTest) {
   fini();
 }
 
+TEST_P(KVTest, RocksDBPooledIteratorTest) {
+  if(string(GetParam()) != "rocksdb")
+    return;
+
+  std::string cfs("cf1");
+  ASSERT_EQ(0, db->set_prefix_bloom("cf1", 4));
+  ASSERT_EQ(0, db->init(g_conf()->bluestore_rocksdb_options));
+  ASSERT_EQ(0, db->create_and_open(cout, cfs));
+  auto write = [&](const std::string& key) {
+    KeyValueDB::Transaction t = db->get_transaction();
+    bufferlist bl;
+    bl.append(key);
+    t->set("cf1", key, bl);
+    ASSERT_EQ(0, db->submit_transaction_sync(t));
+  };
+  auto list = [&](const std::string& lower, const std::string& upper) {
+    std::vector<std::string> res;
+    KeyValueDB::Iterator it = db->get_iterator("cf1", 0,
+      KeyValueDB::IteratorBounds{lower, upper});
+    for (it->lower_bound(lower); it->valid(); it->next()) {
+      res.push_back(it->key());
+    }
+    return res;
+  };
+  write("obj1.a");
+  write("obj1.b");
+  write("obj2.a");
+  ASSERT_EQ(list("obj1.", "obj1/"),
+	    (std::vector<std::string>{"obj1.a", "obj1.b"}));
+  // a reused iterator must see later writes and honour its new bounds
+  write("obj1.c");
+  ASSERT_EQ(list("obj1.", "obj1/"),
+	    (std::vector<std::string>{"obj1.a", "obj1.b", "obj1.c"}));
+  ASSERT_EQ(list("obj2.", "obj2/"),
+	    (std::vector<std::string>{"obj2.a"}));
+  ASSERT_EQ(list("obj3.", "obj3/"), std::vector<std::string>{});
+  // unbounded iterators must walk across prefixes, also once the keys
+  // sit in SST files with prefix blooms
+  db->compact();
+  const std::vector<std::string> all{"obj1.a", "obj1.b", "obj1.c", "obj2.a"};
+  {
+    std::vector<std::string> res;
+    KeyValueDB::Iterator it = db->get_iterator("cf1");
+    for (it->lower_bound("obj1.b"); it->valid(); it->next()) {
+      res.push_back(it->key());
+    }
+    ASSERT_EQ(res, std::vector<std::string>(all.begin() + 1, all.end()));
+  }
+  {
+    std::vector<std::string> res;
+    KeyValueDB::WholeSpaceIterator it = db->get_wholespace_iterator();
+    for (it->lower_bound("cf1", "obj1.b"); it->valid(); it->next()) {
+      res.push_back(it->key());
+    }
+    ASSERT_EQ(res, std::vector<std::string>(all.begin() + 1, all.end()));
+  }
+  fini();
+}
+
 TEST_P(KVTest, RocksDBCFMerge) {
   if(string(GetParam()) != "rocksdb")
     return;
@@ -737,6 +797,129 @@ TEST_P(KVTest, RocksDB_parse_sharding_def) {
   ASSERT_NE(error_msg, "");
 }
 
+TEST_P(KVTest, RocksDB_plan_sharding) {
+  if(string(GetParam()) != "rocksdb")
+    GTEST_SKIP();
+
+  std::vector<RocksDBStore::ColumnFamily> current;
+  ASSERT_TRUE(RocksDBStore::parse_sharding_def(
+		"m(3) p(3,0-12) O(3,0-13)=block_cache={type=binned_lru} L",
+		current));
+  ASSERT_EQ(RocksDBStore::sharding_def_to_string(current),
+	    "m(3) p(3,0-12) O(3,0-13)=block_cache={type=binned_lru} L");
+
+  RocksDBStore::sharding_model_t model;
+  model.level_base = 1 << 20;
+  model.level_multiplier = 10;
+  model.hot_write_share = 0.2;
+  model.shard_target_bytes = 100 << 20;
+  model.max_shards = 4;
+
+  // a churning tree of small keys loses nothing to compaction ...
+  double wa_churn = RocksDBStore::estimate_write_amp(model, 1ull << 30, 1, 1.0);
+  ASSERT_EQ(wa_churn, 2.0);
+  // ... while long lived data pays for every level, fewer when sharded
+  double wa_1 = RocksDBStore::estimate_write_amp(model, 1ull << 30, 1, 0);
+  double wa_4 = RocksDBStore::estimate_write_amp(model, 1ull << 30, 4, 0);
+  ASSERT_GT(wa_1, wa_4);
+  ASSERT_GT(wa_4, wa_churn);
+
+  std::map<std::string, KeyValueAccessStats::prefix_stats_t> stats;
+  stats["m"].sets = 1000;
+  stats["m"].set_bytes = 1000 << 10;
+  stats["X"].sets = 1000;
+  stats["X"].set_bytes = 3000 << 10;
+  stats["X"].rms = 900;
+  stats["S"].sets = 10;
+  stats["S"].set_bytes = 10 << 10;
+  std::map<std::string, uint64_t> live;
+  live["m"] = 1ull << 30;
+  live["X"] = 1 << 20;
+  live["S"] = 300 << 20;
+
+  std::unique_ptr<Formatter> f(Formatter::create("json-pretty"));
+  f->open_object_section("plan");
+  auto proposed = RocksDBStore::plan_sharding(current, stats, live, model,
+					      f.get());
+  f->close_section();
+  f->flush(std::cout);
+  std::cout << std::endl;
+
+  // existing columns are kept, "m" outgrew its shards, hot "X" is
+  // isolated and cold "S" stays in the default column
+  ASSERT_EQ(RocksDBStore::sharding_def_to_string(proposed),
+	    "m(4) p(3,0-12) O(3,0-13)=block_cache={type=binned_lru} L X");
+  std::vector<RocksDBStore::ColumnFamily> parsed;
+  ASSERT_TRUE(RocksDBStore::parse_sharding_def(
+		RocksDBStore::sharding_def_to_string(proposed), parsed));
+  ASSERT_EQ(parsed.size(), proposed.size());
+
+  // nothing to do for an idle db that is small enough
+  stats.clear();
+  live.clear();
+  proposed = RocksDBStore::plan_sharding(current, stats, live, model, nullptr);
+  ASSERT_EQ(RocksDBStore::sharding_def_to_string(proposed),
+	    RocksDBStore::sharding_def_to_string(current));
+}
+
+TEST_P(KVTest, RocksDBAccessStats) {
+  if(string(GetParam()) != "rocksdb")
+    GTEST_SKIP();
+
+  g_ceph_context->_conf.set_val_or_die("rocksdb_access_stats", "true");
+  ASSERT_EQ(0, db->init(g_conf()->bluestore_rocksdb_options));
+  ASSERT_EQ(0, db->create_and_open(cout, "p(2) m"));
+  RocksDBStore* rdb = dynamic_cast<RocksDBStore*>(db.get());
+  ASSERT_NE(rdb, nullptr);
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    bufferlist v;
+    v.append("value");
+    for (int i = 0; i < 100; ++i) {
+      t->set("p", "key" + stringify(i), v);
+    }
+    t->set("m", "a", v);
+    t->rmkey("m", "a");
+    db->submit_transaction_sync(t);
+  }
+  // reads from several threads land in different shards
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      for (int j = 0; j < 10; ++j) {
+        bufferlist v;
+        ASSERT_EQ(0, db->get("p", "key1", &v));
+      }
+      auto it = db->get_iterator("m");
+      it->seek_to_first();
+    });
+  }
+  for (auto& t : readers) {
+    t.join();
+  }
+  {
+    auto stats = rdb->get_access_stats(false);
+    const auto& p = stats.prefixes["p"];
+    ASSERT_EQ(100u, p.sets);
+    ASSERT_EQ(0u, p.rms);
+    ASSERT_EQ(40u, p.gets);
+    const auto& m = stats.prefixes["m"];
+    ASSERT_EQ(1u, m.sets);
+    ASSERT_EQ(1u, m.rms);
+    ASSERT_EQ(0u, m.gets);
+    ASSERT_EQ(4u, m.iterators);
+  }
+  std::unique_ptr<Formatter> f(Formatter::create("json-pretty"));
+  f->open_object_section("advice");
+  ASSERT_EQ(0, rdb->advise_sharding(f.get(), 0.1, true));
+  f->close_section();
+  f->flush(std::cout);
+  std::cout << std::endl;
+  // reset
+  ASSERT_TRUE(rdb->get_access_stats(false).empty());
+  fini();
+  g_ceph_context->_conf.set_val_or_die("rocksdb_access_stats", "false");
+}
 
 
 class RocksDBShardingTest : public ::testing::TestWithParam<const char*> {
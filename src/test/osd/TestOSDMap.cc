@@ -702,6 +702,251 @@ TEST_F(OSDMapTest, KeepsNecessaryTemps) {
   EXPECT_FALSE(pending_inc.new_primary_temp.count(pgid));
 }
 
+TEST_F(OSDMapTest, SharedTablesAcrossEpochs) {
+  set_up_map(300);
+
+  // give the map some bulk, as a large cluster would have
+  {
+    OSDMap::Incremental pending_inc(osdmap.get_epoch() + 1);
+    for (unsigned ps = 0; ps < 4096; ++ps) {
+      pending_inc.new_pg_upmap_items[pg_t(ps, my_rep_pool)] =
+        mempool::osdmap::vector<pair<int32_t,int32_t>>(
+          {{(int)ps % 300, (int)(ps + 1) % 300}});
+    }
+    osdmap.apply_incremental(pending_inc);
+  }
+  pg_t pgid = osdmap.raw_pg_to_pg(pg_t(0, my_rep_pool));
+  ASSERT_TRUE(osdmap.have_pg_upmaps(pgid));
+
+  // what a map costs when nothing is shared with other epochs
+  size_t full_bytes;
+  {
+    bufferlist bl;
+    osdmap.encode(bl, CEPH_FEATURES_SUPPORTED_DEFAULT | CEPH_FEATURE_RESERVED);
+    size_t before = mempool::osdmap::allocated_bytes();
+    OSDMap full;
+    full.decode(bl);
+    full_bytes = mempool::osdmap::allocated_bytes() - before;
+  }
+
+  // next epoch: a new pg_temp and up_thru only
+  size_t before = mempool::osdmap::allocated_bytes();
+  OSDMap next;
+  next.deepish_copy_from(osdmap);
+  {
+    OSDMap::Incremental pending_inc(next.get_epoch() + 1);
+    pending_inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>({1, 2, 3});
+    pending_inc.new_up_thru[1] = next.get_epoch();
+    next.apply_incremental(pending_inc);
+  }
+  size_t next_bytes = mempool::osdmap::allocated_bytes() - before;
+  std::cout << "full map " << full_bytes << " bytes, next epoch "
+            << next_bytes << " bytes" << std::endl;
+  EXPECT_LT(next_bytes * 4, full_bytes);
+
+  // tables the incremental did not touch are shared...
+  EXPECT_EQ(&osdmap.get_xinfo(0), &next.get_xinfo(0));
+  EXPECT_EQ(&osdmap.get_addrs(0), &next.get_addrs(0));
+  EXPECT_EQ(&osdmap.get_uuid(0), &next.get_uuid(0));
+  // ...and those it did are not
+  EXPECT_FALSE(osdmap.has_pgtemp(pgid));
+  EXPECT_TRUE(next.has_pgtemp(pgid));
+
+  // marking an osd down copies xinfo, the older epoch keeps its view
+  {
+    OSDMap::Incremental pending_inc(next.get_epoch() + 1);
+    pending_inc.new_state[1] = CEPH_OSD_UP;
+    pending_inc.modified = ceph_clock_now();
+    next.apply_incremental(pending_inc);
+  }
+  EXPECT_TRUE(osdmap.is_up(1));
+  EXPECT_FALSE(next.is_up(1));
+  EXPECT_NE(&osdmap.get_xinfo(0), &next.get_xinfo(0));
+  EXPECT_EQ(utime_t(), osdmap.get_xinfo(1).down_stamp);
+  EXPECT_NE(utime_t(), next.get_xinfo(1).down_stamp);
+
+  // removing an upmap copies the upmaps only
+  {
+    OSDMap::Incremental pending_inc(next.get_epoch() + 1);
+    pending_inc.old_pg_upmap_items.insert(pgid);
+    next.apply_incremental(pending_inc);
+  }
+  EXPECT_TRUE(osdmap.have_pg_upmaps(pgid));
+  EXPECT_FALSE(next.have_pg_upmaps(pgid));
+  EXPECT_EQ(&osdmap.get_addrs(0), &next.get_addrs(0));
+
+  // dedup finds equal tables of separately decoded maps
+  {
+    bufferlist bl;
+    osdmap.encode(bl, CEPH_FEATURES_SUPPORTED_DEFAULT | CEPH_FEATURE_RESERVED);
+    OSDMap *other = new OSDMap;
+    other->decode(bl);
+    other->inc_epoch();
+    EXPECT_NE(&osdmap.get_xinfo(0), &other->get_xinfo(0));
+    OSDMap::dedup(&osdmap, other);
+    EXPECT_EQ(&osdmap.get_xinfo(0), &other->get_xinfo(0));
+    EXPECT_EQ(&osdmap.get_addrs(0), &other->get_addrs(0));
+    EXPECT_TRUE(other->have_pg_upmaps(pgid));
+    delete other;
+  }
+}
+
+TEST_F(OSDMapTest, IncrementalMapping) {
+  set_up_map(20);
+  mapping.update(osdmap);
+
+  auto apply = [&](OSDMap::Incremental& inc) {
+    osdmap.apply_incremental(inc);
+    mapping.note_incremental(inc);
+  };
+  // what the next update will remap, if it can do so incrementally
+  auto probe = [&](set<int64_t> *pools, vector<pg_t> *pgs) {
+    OSDMapMapping m = mapping;
+    return m._start(osdmap, pools, pgs);
+  };
+  // update and compare with a mapping calculated from scratch
+  auto verify = [&]() {
+    mapping.update(osdmap);
+    OSDMapMapping full;
+    full.update(osdmap);
+    for (auto& [poolid, pool] : osdmap.get_pools()) {
+      for (unsigned ps = 0; ps < pool.get_pg_num(); ++ps) {
+        pg_t pgid(ps, poolid);
+        vector<int> up, acting, up2, acting2;
+        int up_primary, acting_primary, up_primary2, acting_primary2;
+        full.get(pgid, &up, &up_primary, &acting, &acting_primary);
+        mapping.get(pgid, &up2, &up_primary2, &acting2, &acting_primary2);
+        ASSERT_EQ(up, up2) << pgid;
+        ASSERT_EQ(up_primary, up_primary2) << pgid;
+        ASSERT_EQ(acting, acting2) << pgid;
+        ASSERT_EQ(acting_primary, acting_primary2) << pgid;
+      }
+    }
+    for (int osd = 0; osd < osdmap.get_max_osd(); ++osd) {
+      ASSERT_EQ(full.get_osd_acting_pgs(osd), mapping.get_osd_acting_pgs(osd));
+    }
+  };
+  unsigned num_pgs = mapping.get_num_pgs();
+
+  // an osd going down only remaps the pgs it is in
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[3] = CEPH_OSD_UP;
+    apply(inc);
+    set<int64_t> pools;
+    vector<pg_t> pgs;
+    ASSERT_TRUE(probe(&pools, &pgs));
+    EXPECT_TRUE(pools.empty());
+    EXPECT_LT(0u, pgs.size());
+    EXPECT_GT(num_pgs, pgs.size());
+    verify();
+  }
+  // coming back up may take pgs from anywhere under the rules' roots
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[3] = CEPH_OSD_UP;
+    apply(inc);
+    set<int64_t> pools;
+    vector<pg_t> pgs;
+    ASSERT_TRUE(probe(&pools, &pgs));
+    EXPECT_EQ(2u, pools.size());
+    verify();
+  }
+  // so may marking one out
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_weight[5] = CEPH_OSD_OUT;
+    apply(inc);
+    set<int64_t> pools;
+    vector<pg_t> pgs;
+    ASSERT_TRUE(probe(&pools, &pgs));
+    EXPECT_EQ(2u, pools.size());
+    verify();
+  }
+  // pg_temp and upmaps only remap their pgs
+  {
+    pg_t temp_pg(0, my_rep_pool), upmap_pg(1, my_rep_pool);
+    vector<int> up;
+    int primary;
+    osdmap.pg_to_raw_up(temp_pg, &up, &primary);
+    ASSERT_EQ(3u, up.size());
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pg_temp[temp_pg] =
+      mempool::osdmap::vector<int>({up[2], up[1], up[0]});
+    osdmap.pg_to_raw_up(upmap_pg, &up, &primary);
+    int to = 0;
+    while (std::find(up.begin(), up.end(), to) != up.end() || to == 5) {
+      ++to;
+    }
+    inc.new_pg_upmap_items[upmap_pg] =
+      mempool::osdmap::vector<pair<int32_t,int32_t>>({{up[0], to}});
+    apply(inc);
+    set<int64_t> pools;
+    vector<pg_t> pgs;
+    ASSERT_TRUE(probe(&pools, &pgs));
+    EXPECT_TRUE(pools.empty());
+    EXPECT_EQ(vector<pg_t>({temp_pg, upmap_pg}), pgs);
+    verify();
+  }
+  // primary affinity, then several epochs noted between updates
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_primary_affinity[7] = 0;
+    apply(inc);
+    set<int64_t> pools;
+    vector<pg_t> pgs;
+    ASSERT_TRUE(probe(&pools, &pgs));
+    EXPECT_TRUE(pools.empty());
+    EXPECT_LT(0u, pgs.size());
+  }
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[8] = CEPH_OSD_UP;
+    pg_pool_t *p = inc.get_new_pool(my_ec_pool,
+                                    osdmap.get_pg_pool(my_ec_pool));
+    p->set_pgp_num(p->get_pgp_num() / 2);
+    apply(inc);
+    set<int64_t> pools;
+    vector<pg_t> pgs;
+    ASSERT_TRUE(probe(&pools, &pgs));
+    EXPECT_EQ(set<int64_t>({(int64_t)my_ec_pool}), pools);
+    verify();
+  }
+  // a new crush map remaps everything
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    osdmap.crush->encode(inc.crush, CEPH_FEATURES_SUPPORTED_DEFAULT);
+    apply(inc);
+    set<int64_t> pools;
+    vector<pg_t> pgs;
+    ASSERT_FALSE(probe(&pools, &pgs));
+    verify();
+  }
+  // and so does an epoch we were not told about
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[3] = CEPH_OSD_UP;
+    osdmap.apply_incremental(inc);
+    OSDMap::Incremental inc2(osdmap.get_epoch() + 1);
+    inc2.new_state[3] = CEPH_OSD_UP;
+    apply(inc2);
+    set<int64_t> pools;
+    vector<pg_t> pgs;
+    ASSERT_FALSE(probe(&pools, &pgs));
+    verify();
+  }
+  // as long as the next one is noted, we are back on track
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[4] = CEPH_OSD_UP;
+    apply(inc);
+    set<int64_t> pools;
+    vector<pg_t> pgs;
+    ASSERT_TRUE(probe(&pools, &pgs));
+    verify();
+  }
+}
+
 TEST_F(OSDMapTest, PrimaryAffinity) {
   set_up_map();
 
@@ -0,0 +1,128 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:nil -*-
+// vim: ts=8 sw=2 sts=2 expandtab
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "common/ceph_json.h"
+#include "global/global_context.h"
+#include "osd/ObjectContextCache.h"
+#include "osd/osd_internal_types.h"
+
+static const spg_t pgid(pg_t(1, 1), shard_id_t::NO_SHARD);
+
+static hobject_t make_oid(const std::string& name)
+{
+  return hobject_t(object_t(name), "", CEPH_NOSNAP, 0x1234, 1, "");
+}
+
+static uint64_t get_stat(ObjectContextCache& cache, const char *name)
+{
+  JSONFormatter f;
+  f.open_object_section("cache");
+  cache.dump(&f);
+  f.close_section();
+  std::ostringstream ss;
+  f.flush(ss);
+  JSONParser p;
+  EXPECT_TRUE(p.parse(ss.str().c_str(), ss.str().size()));
+  uint64_t v = 0;
+  JSONDecoder::decode_json(name, v, p.find_obj("cache"));
+  return v;
+}
+
+struct Objects {
+  std::vector<hobject_t> oids;
+  std::vector<std::weak_ptr<ObjectContext>> refs;
+
+  Objects(const std::string& prefix, unsigned n) {
+    for (unsigned i = 0; i < n; ++i) {
+      // same name length, so every context costs the same
+      char name[32];
+      snprintf(name, sizeof(name), "%s%06u", prefix.c_str(), i);
+      oids.push_back(make_oid(name));
+    }
+    refs.resize(n);
+  }
+  void touch(ObjectContextCache& cache) {
+    for (unsigned i = 0; i < oids.size(); ++i) {
+      ObjectContextRef obc = refs[i].lock();
+      if (!obc) {
+        obc = std::make_shared<ObjectContext>();
+        obc->obs.oi.soid = oids[i];
+        refs[i] = obc;
+      }
+      cache.touch(pgid, oids[i], obc);
+    }
+  }
+  unsigned cached() const {
+    unsigned n = 0;
+    for (auto& r : refs) {
+      n += !r.expired();
+    }
+    return n;
+  }
+};
+
+TEST(ObjectContextCache, ScanResistance)
+{
+  ObjectContextCache cache(g_ceph_context, 1, 1 << 30);
+  Objects probe("p", 1);
+  probe.touch(cache);
+  uint64_t entry_bytes = get_stat(cache, "in_bytes");
+  ASSERT_GT(entry_bytes, 0u);
+  cache.clear_pg(pgid);
+  ASSERT_EQ(0u, probe.cached());
+
+  cache.set_budget(40 * entry_bytes);
+  Objects hot("h", 10);
+  Objects warmup("w", 60);
+  Objects scan("s", 1000);
+
+  // the hot objects are used, pushed out by other ones and used again
+  hot.touch(cache);
+  warmup.touch(cache);
+  ASSERT_EQ(0u, hot.cached());
+  hot.touch(cache);
+  ASSERT_EQ(10u, get_stat(cache, "ghost_hits"));
+  ASSERT_EQ(10u, get_stat(cache, "main_items"));
+
+  // a long scan only cycles the FIFO
+  scan.touch(cache);
+  ASSERT_EQ(10u, hot.cached());
+  ASSERT_LE(scan.cached(), 30u);
+  ASSERT_LE(get_stat(cache, "in_bytes") + get_stat(cache, "main_bytes"),
+            40 * entry_bytes);
+  ASSERT_EQ(40u, cache.get_pg_count(pgid));
+
+  cache.clear_pg(pgid);
+  ASSERT_EQ(0u, cache.get_pg_count(pgid));
+  ASSERT_EQ(0u, hot.cached());
+  ASSERT_EQ(0u, scan.cached());
+}
+
+TEST(ObjectContextCache, ClearRange)
+{
+  ObjectContextCache cache(g_ceph_context, 4, 1 << 30);
+  Objects objs("o", 100);
+  objs.touch(cache);
+  ASSERT_EQ(100u, cache.get_pg_count(pgid));
+  // another pg is not affected
+  spg_t other(pg_t(2, 1), shard_id_t::NO_SHARD);
+  auto obc = std::make_shared<ObjectContext>();
+  cache.touch(other, objs.oids[0], obc);
+  ASSERT_EQ(1u, cache.get_pg_count(other));
+
+  cache.clear_range(pgid, objs.oids[10], objs.oids[19]);
+  ASSERT_EQ(90u, cache.get_pg_count(pgid));
+  for (unsigned i = 0; i < objs.oids.size(); ++i) {
+    ASSERT_EQ(i < 10 || i >= 20, !objs.refs[i].expired()) << i;
+  }
+
+  // shrinking the budget trims right away
+  cache.set_budget(0);
+  ASSERT_EQ(0u, cache.get_pg_count(pgid));
+  ASSERT_EQ(0u, cache.get_pg_count(other));
+  ASSERT_EQ(0u, objs.cached());
+  obc.reset();
+}
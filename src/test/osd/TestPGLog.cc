@@ -2750,30 +2750,30 @@ TEST_F(PGLogTrimTest, TestPartialTrim)
   log.add(mk_ple_dt_rb(mk_obj(5), mk_evt(21, 167), mk_evt(31, 166)));
 
   std::set<eversion_t> trimmed;
-  std::set<std::string> trimmed_dups;
+  eversion_t trimmed_dups_to;
   eversion_t write_from_dups = eversion_t::max();
 
-  log.trim(cct, mk_evt(19, 157), &trimmed, &trimmed_dups, &write_from_dups);
+  log.trim(cct, mk_evt(19, 157), &trimmed, &trimmed_dups_to, &write_from_dups);
 
   EXPECT_EQ(eversion_t(15, 150), write_from_dups);
   EXPECT_EQ(3u, log.log.size());
   EXPECT_EQ(3u, trimmed.size());
   EXPECT_EQ(2u, log.dups.size());
-  EXPECT_EQ(0u, trimmed_dups.size());
+  EXPECT_EQ(eversion_t(), trimmed_dups_to);
 
   SetUp(15);
 
   std::set<eversion_t> trimmed2;
-  std::set<std::string> trimmed_dups2;
+  eversion_t trimmed_dups_to2;
   eversion_t write_from_dups2 = eversion_t::max();
 
-  log.trim(cct, mk_evt(20, 164), &trimmed2, &trimmed_dups2, &write_from_dups2);
+  log.trim(cct, mk_evt(20, 164), &trimmed2, &trimmed_dups_to2, &write_from_dups2);
 
   EXPECT_EQ(eversion_t(19, 160), write_from_dups2);
   EXPECT_EQ(2u, log.log.size());
   EXPECT_EQ(1u, trimmed2.size());
   EXPECT_EQ(3u, log.dups.size());
-  EXPECT_EQ(0u, trimmed_dups2.size());
+  EXPECT_EQ(eversion_t(), trimmed_dups_to2);
 }
 
 
@@ -2817,16 +2817,16 @@ TEST_F(PGLogTrimTest, TestTrimNoDups)
   log.add(mk_ple_dt_rb(mk_obj(5), mk_evt(21, 167), mk_evt(31, 166)));
 
   std::set<eversion_t> trimmed;
-  std::set<std::string> trimmed_dups;
+  eversion_t trimmed_dups_to;
   eversion_t write_from_dups = eversion_t::max();
 
-  log.trim(cct, mk_evt(19, 157), &trimmed, &trimmed_dups, &write_from_dups);
+  log.trim(cct, mk_evt(19, 157), &trimmed, &trimmed_dups_to, &write_from_dups);
 
   EXPECT_EQ(eversion_t::max(), write_from_dups);
   EXPECT_EQ(3u, log.log.size());
   EXPECT_EQ(3u, trimmed.size());
   EXPECT_EQ(0u, log.dups.size());
-  EXPECT_EQ(0u, trimmed_dups.size());
+  EXPECT_EQ(eversion_t(), trimmed_dups_to);
 }
 
 TEST_F(PGLogTrimTest, TestNoTrim)
@@ -2845,16 +2845,16 @@ TEST_F(PGLogTrimTest, TestNoTrim)
   log.add(mk_ple_dt_rb(mk_obj(5), mk_evt(21, 167), mk_evt(31, 166)));
 
   std::set<eversion_t> trimmed;
-  std::set<std::string> trimmed_dups;
+  eversion_t trimmed_dups_to;
   eversion_t write_from_dups = eversion_t::max();
 
-  log.trim(cct, mk_evt(9, 99), &trimmed, &trimmed_dups, &write_from_dups);
+  log.trim(cct, mk_evt(9, 99), &trimmed, &trimmed_dups_to, &write_from_dups);
 
   EXPECT_EQ(eversion_t::max(), write_from_dups);
   EXPECT_EQ(6u, log.log.size());
   EXPECT_EQ(0u, trimmed.size());
   EXPECT_EQ(0u, log.dups.size());
-  EXPECT_EQ(0u, trimmed_dups.size());
+  EXPECT_EQ(eversion_t(), trimmed_dups_to);
 }
 
 TEST_F(PGLogTrimTest, TestTrimAll)
@@ -2874,16 +2874,16 @@ TEST_F(PGLogTrimTest, TestTrimAll)
   log.add(mk_ple_dt_rb(mk_obj(5), mk_evt(21, 167), mk_evt(31, 166)));
 
   std::set<eversion_t> trimmed;
-  std::set<std::string> trimmed_dups;
+  eversion_t trimmed_dups_to;
   eversion_t write_from_dups = eversion_t::max();
 
-  log.trim(cct, mk_evt(22, 180), &trimmed, &trimmed_dups, &write_from_dups);
+  log.trim(cct, mk_evt(22, 180), &trimmed, &trimmed_dups_to, &write_from_dups);
 
   EXPECT_EQ(eversion_t(15, 150), write_from_dups);
   EXPECT_EQ(0u, log.log.size());
   EXPECT_EQ(6u, trimmed.size());
   EXPECT_EQ(5u, log.dups.size());
-  EXPECT_EQ(0u, trimmed_dups.size());
+  EXPECT_EQ(eversion_t(), trimmed_dups_to);
   EXPECT_EQ(0u, log.dup_index.size()); // dup_index entry should be trimmed
 }
 
@@ -3633,6 +3633,56 @@ TEST_F(PGLogTrimTest, TestTrimDups2) {
   EXPECT_EQ(6u, log.dups.size()) << log;
 }
 
+// This tests that trim() drops the oldest dups osd_pg_log_trim_max at a
+// time and reports them as a range to be removed with one omap op.
+TEST_F(PGLogTrimTest, TestTrimDupsBatch) {
+  SetUp(3);
+  auto trim_max = cct->_conf.get_val<uint64_t>("osd_pg_log_trim_max");
+  cct->_conf.set_val_or_die("osd_pg_log_trim_max", "4");
+  PGLog::IndexedLog log;
+  log.head = mk_evt(21, 107);
+  log.skip_can_rollback_to_to_head();
+  log.tail = mk_evt(9, 99);
+  log.head = mk_evt(9, 99);
+
+  entity_name_t client = entity_name_t::CLIENT(777);
+
+  for (unsigned v = 90; v < 100; ++v) {
+    log.dups.push_back(pg_log_dup_t(mk_ple_mod(mk_obj(1),
+	    mk_evt(9, v), mk_evt(9, v - 1), osd_reqid_t(client, 8, v))));
+    log.index(log.dups.back());
+  }
+  log.add(mk_ple_mod(mk_obj(1), mk_evt(10, 100), mk_evt(9, 99),
+		     osd_reqid_t(client, 8, 100)));
+
+  eversion_t trimmed_dups_to;
+  eversion_t write_from_dups = eversion_t::max();
+  log.trim(cct, mk_evt(9, 99), nullptr, &trimmed_dups_to, &write_from_dups);
+
+  EXPECT_EQ(eversion_t(9, 93), trimmed_dups_to) << log;
+  EXPECT_EQ(6u, log.dups.size()) << log;
+  EXPECT_EQ(eversion_t(9, 94), log.dups.front().version) << log;
+  eversion_t version;
+  version_t user_version;
+  int return_code;
+  std::vector<pg_log_op_return_item_t> op_returns;
+  EXPECT_FALSE(log.get_request(osd_reqid_t(client, 8, 93), &version,
+			       &user_version, &return_code, &op_returns));
+  EXPECT_TRUE(log.get_request(osd_reqid_t(client, 8, 94), &version,
+			      &user_version, &return_code, &op_returns));
+  EXPECT_EQ(eversion_t(9, 94), version);
+
+  // the range only grows until the log is written out
+  log.trim(cct, mk_evt(9, 99), nullptr, &trimmed_dups_to, &write_from_dups);
+
+  EXPECT_EQ(eversion_t(9, 96), trimmed_dups_to) << log;
+  EXPECT_EQ(3u, log.dups.size()) << log;
+  EXPECT_EQ(eversion_t(9, 97), log.dups.front().version) << log;
+  EXPECT_EQ(1u, log.log.size()) << log;
+
+  cct->_conf.set_val_or_die("osd_pg_log_trim_max", std::to_string(trim_max));
+}
+
 // This tests copy_up_to() to make copies of
 // 2 log entries (107, 106) and 3 additional for a total
 // of 5 dups.  Nothing from the original dups is copied.
@@ -56,6 +56,7 @@ void usage(const char *pname)
     << "  destructive-repair  (use only as last resort! may corrupt healthy data)\n"
     << "  stats\n"
     << "  histogram [prefix]\n"
+    << "  bench-range-read <prefix> [num-reads] [keys-per-read]\n"
     << std::endl;
 }
 
@@ -151,7 +152,8 @@ int main(int argc, const char *argv[])
     cmd == "get-size" ||
     cmd == "store-crc" ||
     cmd == "stats" ||
-    cmd == "histogram";
+    cmd == "histogram" ||
+    cmd == "bench-range-read";
   bool to_repair = (cmd == "destructive-repair");
   bool need_stats = (cmd == "stats");
   StoreTool st(type, path, read_only, to_repair, need_stats);
@@ -449,6 +451,17 @@ int main(int argc, const char *argv[])
     if (argc > 4)
       prefix = url_unescape(argv[4]);
     st.build_size_histogram(prefix);
+  } else if (cmd == "bench-range-read") {
+    if (argc < 5) {
+      usage(argv[0]);
+      return 1;
+    }
+    string prefix(url_unescape(argv[4]));
+    uint64_t num_reads = argc > 5 ? std::stoull(argv[5]) : 10000;
+    uint64_t keys_per_read = argc > 6 ? std::stoull(argv[6]) : 16;
+    if (st.bench_range_read(prefix, num_reads, keys_per_read) < 0) {
+      return 1;
+    }
   } else {
     std::cerr << "Unrecognized command: " << cmd << std::endl;
     return 1;
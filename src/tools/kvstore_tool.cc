@@ -4,9 +4,11 @@
 #include "kvstore_tool.h"
 
 #include <iostream>
+#include <random>
 
 #include "common/config_proxy.h" // for class ConfigProxy
 #include "common/errno.h"
+#include "common/perf_counters.h"
 #include "common/url_escape.h"
 #include "common/pretty_binary.h"
 #include "global/global_context.h" // for g_conf()
@@ -320,6 +322,71 @@ int StoreTool::build_size_histogram(const string& prefix0) const
   return 0;
 }
 
+// Times short bounded range reads, the access pattern of omap listings:
+// seek to a random existing key and read up to keys_per_read keys before
+// an upper bound taken from the same sample.
+int StoreTool::bench_range_read(const string& prefix,
+				uint64_t num_reads,
+				uint64_t keys_per_read) const
+{
+  const size_t MAX_SAMPLE = 1000000;
+  vector<string> keys;
+  {
+    auto iter = db->get_iterator(prefix, KeyValueDB::ITERATOR_NOCACHE);
+    for (iter->seek_to_first(); iter->valid() && keys.size() < MAX_SAMPLE;
+	 iter->next()) {
+      keys.push_back(iter->key());
+    }
+  }
+  if (keys.empty()) {
+    std::cerr << "no keys under prefix " << url_escape(prefix) << std::endl;
+    return -ENOENT;
+  }
+
+  std::mt19937_64 rng(0);
+  std::uniform_int_distribution<size_t> pick(0, keys.size() - 1);
+  uint64_t keys_read = 0;
+  uint64_t bytes_read = 0;
+
+  auto start = mono_clock::now();
+  for (uint64_t i = 0; i < num_reads; i++) {
+    auto pos = pick(rng);
+    KeyValueDB::IteratorBounds bounds;
+    bounds.lower_bound = keys[pos];
+    if (pos + keys_per_read < keys.size()) {
+      bounds.upper_bound = keys[pos + keys_per_read];
+    }
+    auto iter = db->get_iterator(prefix, 0, std::move(bounds));
+    iter->lower_bound(keys[pos]);
+    for (uint64_t k = 0; k < keys_per_read && iter->valid(); k++) {
+      bytes_read += iter->value_as_sv().size();
+      keys_read++;
+      iter->next();
+    }
+  }
+  ceph::timespan duration = mono_clock::now() - start;
+  double secs = std::max(std::chrono::duration<double>(duration).count(), 1e-9);
+
+  std::unique_ptr<Formatter> f(
+    Formatter::create("json-pretty", "json-pretty", "json-pretty"));
+  f->open_object_section("bench_range_read");
+  f->dump_string("prefix", url_escape(prefix));
+  f->dump_unsigned("sampled_keys", keys.size());
+  f->dump_unsigned("reads", num_reads);
+  f->dump_unsigned("keys_read", keys_read);
+  f->dump_unsigned("bytes_read", bytes_read);
+  f->dump_float("seconds", secs);
+  f->dump_float("reads_per_sec", num_reads / secs);
+  f->dump_float("avg_read_usec", secs * 1000000 / std::max<uint64_t>(num_reads, 1));
+  if (auto pc = db->get_perf_counters(); pc) {
+    pc->dump_formatted(f.get(), false, select_labeled_t::unlabeled);
+  }
+  f->close_section();
+  f->flush(std::cout);
+  std::cout << std::endl;
+  return 0;
+}
+
 int StoreTool::copy_store_to(const string& type, const string& other_path,
                              const int num_keys_per_tx,
                              const string& other_type)
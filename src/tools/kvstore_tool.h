@@ -74,6 +74,9 @@ public:
 
   int print_stats() const;
   int build_size_histogram(const std::string& prefix) const;
+  int bench_range_read(const std::string& prefix,
+		       uint64_t num_reads,
+		       uint64_t keys_per_read) const;
 
 private:
   int load_bluestore(const std::string& path, bool read_only, bool need_open_db);